@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace UniDx
+{
+
+// 成分の型（値は glTF の componentType と同じ）
+enum VertexComponent
+{
+    VertexComponent_Byte = 5120,
+    VertexComponent_UnsignedByte = 5121,
+    VertexComponent_Short = 5122,
+    VertexComponent_UnsignedShort = 5123,
+    VertexComponent_UnsignedInt = 5125,
+    VertexComponent_Float = 5126,
+};
+
+
+// --------------------
+// AccessorDecoder
+//
+// 頂点属性の配列を float の配列に変換する
+// 要素の間隔（stride）が空いていてもよく、正規化された 8/16bit の整数（KHR_mesh_quantization）も扱う
+// SSE2 が使えれば 4 要素ずつまとめて広げて変換する（使えなければ 1 成分ずつ）
+// --------------------
+class AccessorDecoder
+{
+public:
+    // 1 成分のバイト数。対応していない型なら 0
+    static size_t ComponentSize(int componentType);
+
+    // src から count 個の要素を読み、dst に dstComponents 個ずつの float で書き込む
+    // stride は要素の先頭の間隔のバイト数（詰めて並んでいるなら成分のバイト数 * components）
+    // 要素の成分が dstComponents より少なければ、残りは fill の値で埋める
+    static void Decode(const void* src, size_t stride, size_t count,
+        int componentType, bool normalized, int components,
+        float* dst, int dstComponents, const float* fill = nullptr);
+
+    // Decode と同じ変換を SSE2 を使わずに 1 成分ずつ行う（結果の確認用）
+    static void DecodeScalar(const void* src, size_t stride, size_t count,
+        int componentType, bool normalized, int components,
+        float* dst, int dstComponents, const float* fill = nullptr);
+};
+
+} // namespace UniDx
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <typeindex>
+#include <unordered_map>
+#include <d3d11.h>
+
+#include "Singleton.h"
+
+namespace DirectX
+{
+class ScratchImage;
+}
+
+namespace UniDx
+{
+
+class Texture;
+class Font;
+
+// --------------------
+// AssetDatabase
+//
+// 読み込んだアセットを、型と正規化したパスと読み込みの設定をキーにして共有する
+// 同じキーで要求されると読み込み済みのものを返すので、デコードと GPU への転送は一度だけになる
+// 保持するのは weak_ptr なので、使っている側がすべて手放すとアセットは解放される
+// GPU のリソースはデバイスごとなので、EngineContext ごとにひとつ
+// --------------------
+class AssetDatabase : public Singleton<AssetDatabase>
+{
+public:
+    // 統計
+    struct Stats
+    {
+        uint64_t hits = 0;      // 読み込み済みのものを返した回数
+        uint64_t misses = 0;    // 新しく読み込んだ回数
+        size_t liveCount = 0;   // 使われているアセットの数
+    };
+
+    // 画像ファイルを読み込んだテクスチャ（サンプラのラップモードもキーに含む）
+    std::shared_ptr<Texture> LoadTexture(const std::wstring& path,
+        D3D11_TEXTURE_ADDRESS_MODE wrapModeU = D3D11_TEXTURE_ADDRESS_CLAMP,
+        D3D11_TEXTURE_ADDRESS_MODE wrapModeV = D3D11_TEXTURE_ADDRESS_CLAMP);
+
+    // デコード済みの画像から作る（読み込み済みなら image は使わない）
+    std::shared_ptr<Texture> LoadTexture(const std::wstring& path, const DirectX::ScratchImage& image,
+        D3D11_TEXTURE_ADDRESS_MODE wrapModeU, D3D11_TEXTURE_ADDRESS_MODE wrapModeV);
+
+    // フォント
+    std::shared_ptr<Font> LoadFont(const std::wstring& path);
+
+    // 読み込み済みのファイルの内容から作る（読み込み済みなら data は使わない）
+    std::shared_ptr<Font> LoadFont(const std::wstring& path, const std::vector<uint8_t>& data);
+
+    // 任意の型のアセット
+    // 読み込み済みでなければ load() で読み込んで登録する。load() が nullptr を返したら登録しない
+    // params には頂点レイアウトなど、同じファイルでも結果が変わる設定を入れる
+    template<typename T>
+    std::shared_ptr<T> Load(const std::wstring& path, uint64_t params, const std::function<std::shared_ptr<T>()>& load)
+    {
+        return std::static_pointer_cast<T>(findOrLoad(typeid(T), path, params,
+            [&load]() -> std::shared_ptr<void> { return load(); }));
+    }
+
+    // 読み込み済みなら返す。なければ nullptr（統計には数えない）
+    template<typename T>
+    std::shared_ptr<T> Find(const std::wstring& path, uint64_t params = 0)
+    {
+        return std::static_pointer_cast<T>(find(typeid(T), NormalizePath(path), params));
+    }
+
+    // 解放されたアセットのエントリを取り除く
+    void Collect();
+
+    Stats getStats();
+    void resetStats() { hits_ = 0; misses_ = 0; }
+
+    // 統計をログに出す
+    void LogStats();
+
+    // キーに使うパス（絶対パスにして . と .. を取り除き、区切りと大文字小文字をそろえる）
+    static std::wstring NormalizePath(const std::wstring& path);
+
+private:
+    struct Key
+    {
+        std::type_index type;
+        std::wstring path;
+        uint64_t params;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    std::unordered_map<Key, std::weak_ptr<void>, KeyHash> entries_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    std::shared_ptr<void> find(std::type_index type, const std::wstring& normalizedPath, uint64_t params);
+    std::shared_ptr<void> findOrLoad(std::type_index type, const std::wstring& path, uint64_t params,
+        const std::function<std::shared_ptr<void>()>& load);
+};
+
+} // namespace UniDx
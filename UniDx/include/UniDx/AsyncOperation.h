@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <functional>
+
+#include "Property.h"
+
+namespace UniDx
+{
+
+// シーンの読み込み方
+enum LoadSceneMode
+{
+    LoadSceneMode_Single,   // 今のシーンを破棄して置き換える
+    LoadSceneMode_Additive, // 今のシーンに追加する
+};
+
+
+// --------------------
+// AsyncOperation
+//
+// 非同期処理の進み具合
+// 値はメインスレッドで更新されるので、メインスレッドから参照する
+// コルーチンでは co_await WaitUntil([op]() { return op->isDone.get(); }) で完了を待てる
+// --------------------
+class AsyncOperation
+{
+public:
+    AsyncOperation() :
+        progress([this]() { return progress_; }),
+        isDone([this]() { return done_; }),
+        allowSceneActivation(
+            [this]() { return allowSceneActivation_; },
+            [this](const bool& value) { allowSceneActivation_ = value; })
+    {
+    }
+
+    AsyncOperation(const AsyncOperation&) = delete;
+    AsyncOperation& operator=(const AsyncOperation&) = delete;
+
+    // 進み具合（0～1）
+    // シーンの読み込みでは、有効にする準備ができた時点で 0.9 になり、有効にすると 1 になる
+    ReadOnlyProperty<float> progress;
+
+    // 完了したか（失敗したときも true になる）
+    ReadOnlyProperty<bool> isDone;
+
+    // false の間は、読み込みが終わってもシーンを有効にしないで待つ
+    Property<bool> allowSceneActivation;
+
+    // 失敗したか
+    bool hasFailed() const { return failed_; }
+
+    // 完了したときにメインスレッドで呼ばれる
+    std::function<void(AsyncOperation&)> completed;
+
+private:
+    friend class SceneManager;
+
+    float progress_ = 0.0f;
+    bool done_ = false;
+    bool failed_ = false;
+    bool allowSceneActivation_ = true;
+
+    void complete(bool failed)
+    {
+        progress_ = 1.0f;
+        done_ = true;
+        failed_ = failed;
+        if (completed)
+        {
+            completed(*this);
+        }
+    }
+};
+
+} // namespace UniDx
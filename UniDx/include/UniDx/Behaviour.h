@@ -3,18 +3,52 @@
 
 #include "Component.h"
 #include "Transform.h"
+#include "Coroutine.h"
 
 namespace UniDx {
 
 class Collider;
 struct Collision;
 
+// Update() を呼ぶ頻度
+enum UpdateRate
+{
+    UpdateRate_EveryFrame,  // 毎フレーム
+    UpdateRate_Interval,    // interval フレームごと
+    UpdateRate_Distance,    // Camera::main からの距離に応じて間隔を広げる
+};
+
+// Update() の優先度
+// Engine の Update の予算を超えたフレームでは、Low のものは次のフレームに回される
+enum UpdatePriority
+{
+    UpdatePriority_High,
+    UpdatePriority_Low,
+};
+
+// --------------------
+// UpdatePolicy
+// Update() の呼び出し方の設定
+// 間隔が同じものはフレームをずらして呼ばれるので、同じフレームに集中しない
+// --------------------
+struct UpdatePolicy
+{
+    UpdateRate rate = UpdateRate_EveryFrame;
+    UpdatePriority priority = UpdatePriority_High;
+    int interval = 1;               // UpdateRate_Interval のときの間隔
+    float nearDistance = 20.0f;     // UpdateRate_Distance でこれより近ければ毎フレーム
+    float farDistance = 80.0f;      // UpdateRate_Distance でこれより遠ければ farInterval ごと
+    int farInterval = 8;
+};
+
 // --------------------
 // Behaviour基底クラス
 // --------------------
 class Behaviour : public Component
 {
 public:
+    UpdatePolicy updatePolicy;
+
     virtual void FixedUpdate() {}
     virtual void Update() {}
     virtual void LateUpdate() {}
@@ -25,7 +59,24 @@ public:
     virtual void OnCollisionStay(const Collision& collision) {}
     virtual void OnCollisionExit(const Collision& collision) {}
 
-    virtual ~Behaviour() = default;
+    virtual ~Behaviour();
+
+    // コルーチンを開始する。最初の co_await まではこの中で実行される
+    CoroutineHandle StartCoroutine(Coroutine&& coroutine);
+
+    // コルーチンを止める
+    void StopCoroutine(CoroutineHandle handle);
+
+    // このコンポーネントが開始したコルーチンをすべて止める
+    void StopAllCoroutines();
+
+    // 前回の Update() からの経過時間
+    // updatePolicy で毎フレーム呼ばれないときは Time::deltaTime の代わりに使う
+    float getUpdateDeltaTime() const { return updateDeltaTime_; }
+
+    // updatePolicy を書き出す。派生クラスでは最初に呼ぶ
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
 
     template<typename T>
     T* GetComponent(bool includeInactive = false) const { return gameObject->GetComponent<T>(includeInactive); }
@@ -37,6 +88,19 @@ public:
         if (c != nullptr || transform->parent == nullptr) return c;
         return transform->parent->gameObject->GetComponent<T>(includeInactive);
     }
+
+private:
+    friend class CoroutineScheduler;
+    friend class Engine;
+
+    uint32_t runningCoroutines_ = 0;
+
+    // Update() の頻度制御（Engine が使う）
+    int updatePhase_ = -1;
+    int deferredFrames_ = 0;
+    bool updatePending_ = false;
+    float lastUpdateTime_ = -1.0f;
+    float updateDeltaTime_ = 0.0f;
 };
 
 
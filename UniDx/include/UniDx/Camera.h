@@ -2,6 +2,7 @@
 #include <SimpleMath.h>
 
 #include "Behaviour.h"
+#include "EngineContext.h"
 
 
 namespace UniDx {
@@ -12,7 +13,8 @@ namespace UniDx {
 class Camera : public Behaviour
 {
 public:
-    static Camera* main;
+    // メインカメラ（現在の EngineContext ごと）
+    static Property<Camera*> main;
 
     float fov = 60.0f;
     float nearClip = 0.1f;
@@ -25,6 +27,9 @@ public:
         return XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(fov), aspect, nearClip, farClip);
     }
 
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
 protected:
     virtual void OnEnable() override;
     virtual void OnDisable() override;
@@ -20,6 +20,9 @@ public:
 
 	void LoadDefaultMaterial(const wchar_t* assetPath);
 
+	virtual void Serialize(SceneWriter& writer) const override;
+	virtual void Deserialize(SceneReader& reader) override;
+
 	void registerUI(UIBehaviour* e);
 	void unregisterUI(UIBehaviour* e);
 
@@ -30,6 +33,7 @@ public:
 
 private:
 	std::vector<UIBehaviour*> elements_;
+	std::wstring assetPath_;							// LoadDefaultMaterial Ŏw肵tH_
 	std::unique_ptr<Material> defaultMaterial;			// _VertexPC
 	std::unique_ptr<Material> defaultTextureMaterial;	// _VertexPTC
 };
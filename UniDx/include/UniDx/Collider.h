@@ -35,9 +35,16 @@ namespace UniDx
             Physics::getInstance()->unregister3d(this);
         }
 
+        virtual void Serialize(SceneWriter& writer) const override;
+        virtual void Deserialize(SceneReader& reader) override;
+
         // ワールド空間における空間境界を取得
         virtual Bounds getBounds() const = 0;
 
+        // Transform を掛ける前の形（中心と大きさ）
+        // 静的なコライダーの境界のキャッシュがパラメータの変更に気づくために使う
+        virtual Bounds getShapeBounds() const = 0;
+
         // レイキャストチェック
         // 始点が内部のときは false を返す
         virtual bool Raycast(Vector3 origin, Vector3 direction, float maxDistance, RaycastHit* hitInfo = nullptr) = 0;
@@ -69,8 +76,12 @@ namespace UniDx
 
         AABBCollider(Vector3 c = Vector3::Zero) : center(c), size(Vector3(0.5f, 0.5f, 0.5f)) {}
 
+        virtual void Serialize(SceneWriter& writer) const override;
+        virtual void Deserialize(SceneReader& reader) override;
+
         // ワールド空間における空間境界を取得
         virtual Bounds getBounds() const override;
+        virtual Bounds getShapeBounds() const override { return Bounds(center, size); }
 
         // レイキャストチェック
         // 始点が内部のときは false を返す
@@ -100,8 +111,12 @@ namespace UniDx
 
         SphereCollider(Vector3 c = Vector3::Zero, float r = 0.5) : center(c), radius(r) {}
 
+        virtual void Serialize(SceneWriter& writer) const override;
+        virtual void Deserialize(SceneReader& reader) override;
+
         // ワールド空間における空間境界を取得
         virtual Bounds getBounds() const override;
+        virtual Bounds getShapeBounds() const override { return Bounds(center, Vector3(radius, radius, radius)); }
 
         // レイキャストチェック
         // 始点が内部のときは false を返す
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <span>
+
 #include "UniDxDefine.h"
 
 
@@ -27,7 +29,7 @@ struct Collision
 {
 public:
     Collider* collider;                 // 衝突した相手側のコライダー
-    std::vector<ContactPoint> contacts;
+    std::span<const ContactPoint> contacts;  // FrameMemory::fixedStep() 上にあり、次の固定時間更新の終わりまで有効
 };
 
 
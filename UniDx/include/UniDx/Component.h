@@ -10,6 +10,8 @@ namespace UniDx {
 // 前方宣言
 class Behaviour;
 class GameObject;
+class SceneWriter;
+class SceneReader;
 
 
 // --------------------
@@ -47,7 +49,15 @@ public:
 
     virtual ~Component();
 
+    // シーンファイルへの書き出しと読み込み（SceneSerializer から呼ばれる）
+    // 書き出すには SceneSerializer::registerComponent で型を登録しておく
+    virtual void Serialize(SceneWriter& writer) const {}
+    virtual void Deserialize(SceneReader& reader) {}
+
 protected:
+    friend class GameObject;
+    friend class SceneWriter;
+
     virtual void Awake() {}
     virtual void Start() {}
     virtual void OnEnable() {}
@@ -0,0 +1,234 @@
+﻿#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <queue>
+#include <cstdint>
+
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+class Behaviour;
+
+// --------------------
+// Coroutine
+//
+// Behaviour::StartCoroutine() に渡すコルーチンの戻り値の型
+//
+//  Coroutine Enemy::blink()
+//  {
+//      while (true)
+//      {
+//          co_await WaitForSeconds(0.5f);
+//          ...
+//      }
+//  }
+//
+// コルーチンのフレームはプールから確保する
+// --------------------
+class Coroutine
+{
+public:
+    struct promise_type
+    {
+        uint64_t id = 0;
+        Behaviour* owner = nullptr;
+        bool stopRequested = false;
+
+        Coroutine get_return_object() { return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+        // 開始と終了はスケジューラが行う
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        // フレームの確保・解放
+        static void* operator new(size_t size);
+        static void operator delete(void* p, size_t size);
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Coroutine(Coroutine&& other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+
+    // StartCoroutine() に渡されなかったときはここで破棄
+    ~Coroutine()
+    {
+        if (handle_) handle_.destroy();
+    }
+
+private:
+    friend class CoroutineScheduler;
+
+    explicit Coroutine(Handle h) : handle_(h) {}
+
+    // 所有権をスケジューラに渡す
+    Handle release()
+    {
+        Handle h = handle_;
+        handle_ = nullptr;
+        return h;
+    }
+
+    Handle handle_;
+};
+
+
+// --------------------
+// CoroutineHandle
+// StartCoroutine() が返す、実行中のコルーチンを指す値
+// --------------------
+struct CoroutineHandle
+{
+    uint64_t id = 0;
+
+    bool operator==(const CoroutineHandle&) const = default;
+};
+
+
+// --------------------
+// CoroutineScheduler
+//
+// 中断中のコルーチンを待ち方ごとに保持し、再開できるものだけを再開する
+// 時間待ちは再開時刻の最小ヒープなので、眠っているコルーチンはフレームごとのコストがかからない
+// 次のフレーム待ちと時間待ちは、待ち始めたフレームのうちには再開しない
+// --------------------
+class CoroutineScheduler : public Singleton<CoroutineScheduler>
+{
+public:
+    virtual ~CoroutineScheduler();
+
+    // コルーチンを開始する。最初の中断まではこの中で実行される
+    CoroutineHandle start(Behaviour* owner, Coroutine&& coroutine);
+
+    // コルーチンを止める
+    void stop(CoroutineHandle handle);
+
+    // owner が開始したコルーチンをすべて止める
+    void stopAll(const Behaviour* owner);
+
+    // 実行中（中断中を含む）か
+    bool isRunning(CoroutineHandle handle) const { return running_.contains(handle.id); }
+
+    // 実行中のコルーチンの数
+    size_t getRunningCount() const { return running_.size(); }
+
+    // フレームの始め（FixedUpdate の前）に Engine から呼ばれる。time は Time::time
+    // ここまでに次のフレーム待ちをしたものが、このフレームの update() で再開される
+    void beginFrame(float time);
+
+    // FixedUpdate と物理計算の後に Engine から呼ばれる
+    void fixedUpdate();
+
+    // Update の後に Engine から呼ばれる
+    void update();
+
+    // 待ちの登録（各 Wait～ から呼ばれる）
+    void waitNextFrame(uint64_t id);
+    void waitFixedUpdate(uint64_t id);
+    void waitUntilTime(uint64_t id, float time);
+    void waitUntil(uint64_t id, std::function<bool()> predicate);
+
+    // 現在時刻（Time::time）
+    float getTime() const { return time_; }
+
+private:
+    struct Timer
+    {
+        float time;
+        uint64_t id;
+        uint64_t frame;     // 待ち始めたフレーム
+
+        bool operator>(const Timer& other) const { return time > other.time; }
+    };
+
+    struct Predicate
+    {
+        uint64_t id;
+        std::function<bool()> func;
+    };
+
+    std::unordered_map<uint64_t, Coroutine::Handle> running_;
+
+    // 止めたコルーチンの id は再開時に見つからないので読み飛ばされる
+    std::vector<uint64_t> nextFrame_;       // このフレームで次のフレーム待ちをしたもの
+    std::vector<uint64_t> thisFrame_;       // 前のフレームまでに次のフレーム待ちをしたもの（このフレームで再開）
+    std::vector<uint64_t> fixedUpdate_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::vector<Predicate> predicates_;
+
+    // 再開処理で使い回すバッファ
+    std::vector<uint64_t> resumeList_;
+    std::vector<Predicate> predicateList_;
+    std::vector<Timer> deferredTimers_;
+
+    // 実行中のコルーチン（コルーチンの中で別のコルーチンを開始すると積まれる）
+    std::vector<uint64_t> resumingStack_;
+
+    uint64_t nextId_ = 1;
+    uint64_t frame_ = 0;
+    float time_ = 0.0f;
+
+    void resume(uint64_t id);
+    void finish(uint64_t id);
+    void resumeAll(std::vector<uint64_t>& list);
+};
+
+
+// --------------------
+// 待ち
+// co_await で使う
+// --------------------
+
+// 次のフレームの Update の後まで待つ
+struct WaitForNextFrame
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle h) const { CoroutineScheduler::getInstance()->waitNextFrame(h.promise().id); }
+    void await_resume() const noexcept {}
+};
+
+// 次の FixedUpdate と物理計算の後まで待つ
+struct WaitForFixedUpdate
+{
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle h) const { CoroutineScheduler::getInstance()->waitFixedUpdate(h.promise().id); }
+    void await_resume() const noexcept {}
+};
+
+// 指定の秒数（Time::timeScale の影響を受ける）だけ待つ
+struct WaitForSeconds
+{
+    float seconds;
+
+    explicit WaitForSeconds(float s) : seconds(s) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Coroutine::Handle h) const
+    {
+        auto scheduler = CoroutineScheduler::getInstance();
+        scheduler->waitUntilTime(h.promise().id, scheduler->getTime() + seconds);
+    }
+    void await_resume() const noexcept {}
+};
+
+// 条件が true になるまで待つ。条件は毎フレーム Update の後に評価される
+struct WaitUntil
+{
+    std::function<bool()> predicate;
+
+    explicit WaitUntil(std::function<bool()> p) : predicate(std::move(p)) {}
+
+    bool await_ready() const { return predicate(); }
+    void await_suspend(Coroutine::Handle h) { CoroutineScheduler::getInstance()->waitUntil(h.promise().id, std::move(predicate)); }
+    void await_resume() const noexcept {}
+};
+
+} // namespace UniDx
@@ -19,6 +19,28 @@ constexpr UINT UNIDX_PS_SLOT_NORMAL = 5;  // t5
 namespace UniDx{
 
 
+// ----------------------------------------------------------
+// 1フレーム分の描画の統計
+// ----------------------------------------------------------
+struct RenderStats
+{
+	uint32_t drawCalls = 0;			// Draw / DrawIndexed の回数（UIを含む）
+	uint32_t indexedDrawCalls = 0;	// そのうち DrawIndexed の回数
+	uint64_t primitives = 0;		// 描画した頂点数またはインデックス数
+	uint32_t shaderBinds = 0;		// シェーダの設定回数
+	uint32_t textureBinds = 0;		// テクスチャの設定回数
+	uint32_t stateChanges = 0;		// デプス・ブレンドステートの設定回数
+	uint32_t bufferUploads = 0;		// UpdateSubresource / Map の回数
+	uint64_t uploadBytes = 0;		// 転送したバイト数
+
+	void addUpload(size_t bytes)
+	{
+		bufferUploads++;
+		uploadBytes += bytes;
+	}
+};
+
+
 // ----------------------------------------------------------
 // D3DManagerクラス
 // ----------------------------------------------------------
@@ -34,6 +56,9 @@ public:
 	//--------------------------------------------
 	bool Initialize(HWND hWnd, int width, int height);
 
+	// グラフィックスデバイスが使えるか（ヘッドレスモードでは false）
+	static bool isAvailable() { return getInstance() != nullptr; }
+
 	const ComPtr<ID3D11Device>&			GetDevice() const { return m_device; }
 	const ComPtr<ID3D11DeviceContext>&	GetContext() const { return m_context; }
 
@@ -44,8 +69,18 @@ public:
 	void Present()
 	{
 		m_swapChain->Present(1, 0);
+
+		// 描画の統計を確定して次のフレームの集計を始める
+		lastFrameStats_ = frameStats_;
+		frameStats_ = RenderStats();
 	}
 
+	// 集計中のフレームの描画の統計（描画処理から加算する）
+	RenderStats& getFrameStats() { return frameStats_; }
+
+	// 直前に表示したフレームの描画の統計
+	const RenderStats& getLastFrameStats() const { return lastFrameStats_; }
+
 	const Vector2& getScreenSize() const { return screenSize; }
 	RenderingMode getCurrentRenderingMode() const { return currentRenderingMode; }
 	void setCurrentCurrentRenderingMode(RenderingMode r) { currentRenderingMode = r; }
@@ -53,6 +88,8 @@ public:
 private:
 	Vector2                         screenSize;
 	RenderingMode                   currentRenderingMode;
+	RenderStats						frameStats_;
+	RenderStats						lastFrameStats_;
 	ComPtr<ID3D11Device>			m_device; // Direct3Dデバイス
 	ComPtr<ID3D11DeviceContext>		m_context; // Direct3Dデバイスコンテキスト
 	ComPtr<IDXGISwapChain>			m_swapChain; // スワップチェイン
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <windows.h>
+#include <chrono>
 #include <Keyboard.h>
 
 #include "Singleton.h"
@@ -9,6 +10,7 @@ namespace UniDx
 {
 
 class GameObject;
+class Behaviour;
 class Camera;
 class Canvas;
 
@@ -19,6 +21,50 @@ public:
     virtual void Initialize(HWND hWnd);
     virtual int PlayerLoop();
 
+    // ウィンドウとDirect3Dを使わないヘッドレスモードで初期化
+    // 描画系のコンポーネントは何もしなくなる
+    virtual void InitializeHeadless();
+
+    // ヘッドレスモードのループ
+    // frameRate      : 1秒あたりのフレーム数
+    // fastAsPossible : true なら待たずに次のフレームを実行する（時間は 1/frameRate ずつ進める）
+    // maxFrames      : 実行するフレーム数。0 なら Quit() されるまで続ける
+    virtual int HeadlessLoop(double frameRate = 60.0, bool fastAsPossible = false, uint64_t maxFrames = 0);
+
+    // HeadlessLoop() で計測した値
+    struct HeadlessStats
+    {
+        uint64_t frames = 0;                // 実行したフレーム数
+        double updateMilliseconds = 0.0;    // updateFrame() にかかった時間の合計
+        double maxUpdateMilliseconds = 0.0; // 1フレームの updateFrame() の最大
+        double wallSeconds = 0.0;           // シーンの作成から終了処理までの実時間（待ち時間を含む）
+        double sceneBuildMilliseconds = 0.0;    // シーンの構築にかかった時間
+        double sceneDestroyMilliseconds = 0.0;  // シーンの破棄にかかった時間
+    };
+    const HeadlessStats& getHeadlessStats() const { return headlessStats_; }
+
+    // ループの終了を要求
+    void Quit() { quit_ = true; }
+
+    bool isHeadless() const { return headless_; }
+
+    // Update() の1フレームあたりの予算（ミリ秒）。0 なら無制限
+    // 超えると UpdatePriority_Low の Behaviour は次のフレームに回される
+    void setUpdateBudget(double milliseconds) { updateBudget_ = milliseconds; }
+    double getUpdateBudget() const { return updateBudget_; }
+
+    // 前のフレームで予算超過のため後回しにした Update() の数
+    uint32_t getDeferredUpdateCount() const { return lastDeferredUpdates_; }
+
+    // 前のフレームにメインスレッドで operator new が呼ばれた回数
+    // 定常状態では 0 になるのが望ましい（AllocationCounter が無効なら常に 0）
+    uint64_t getFrameAllocationCount() const { return lastFrameAllocations_; }
+
+    // 固定時間更新（FixedUpdate、物理、イベント配信、コルーチン）の中で operator new が呼ばれた回数の合計
+    // 開始直後の warmupFrames フレームは数えない。AllocationCounter が無効なら常に 0
+    void setFixedStepAllocationWarmup(uint64_t warmupFrames) { fixedStepAllocationWarmup_ = warmupFrames; }
+    uint64_t getFixedStepAllocationCount() const { return fixedStepAllocations_; }
+
     void ProcessKeyboardMessage(UINT message, WPARAM wParam, LPARAM lParam)
     {
         DirectX::Keyboard::ProcessMessage(message, wParam, lParam);
@@ -45,8 +91,37 @@ protected:
 
 private:
     std::vector<Canvas*> canvas_;
+    double restFixedUpdateTime_ = 0.0;
+    bool headless_ = false;
+    bool quit_ = false;
+    bool ownsJobSystem_ = false;
+    HeadlessStats headlessStats_;
+
+    // Update() の頻度制御
+    // 後回しがこのフレーム数続いたら予算を超えていても呼ぶ
+    static constexpr int MaxDeferredFrames = 4;
+    double updateBudget_ = 0.0;
+    int nextUpdatePhase_ = 0;
+    int updateFrameCount_ = 0;
+    bool hasUpdateCamera_ = false;
+    Vector3 updateCameraPosition_;
+    std::chrono::steady_clock::time_point updateStart_;
+    uint32_t deferredUpdates_ = 0;
+    uint32_t lastDeferredUpdates_ = 0;
+
+    // ヒープ確保回数の計測
+    uint64_t frameAllocationMark_ = 0;
+    uint64_t lastFrameAllocations_ = 0;
+    uint64_t frameIndex_ = 0;
+    uint64_t fixedStepAllocationWarmup_ = 0;
+    uint64_t fixedStepAllocations_ = 0;
+
+    bool shouldUpdate(Behaviour* behaviour);
 
+    void initializeSubsystems();
     void createScene();
+    void updateFrame();
+    void flushObjects();
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "Time.h"
+
+namespace UniDx
+{
+
+class Camera;
+
+
+// --------------------
+// SingletonBase
+// EngineContext が型を問わずシングルトンを破棄できるようにするための基底
+// --------------------
+class SingletonBase
+{
+public:
+    virtual ~SingletonBase() {}
+};
+
+
+// --------------------
+// EngineContext
+//
+// エンジンひとつ分の状態（各シングルトン、時間、メインカメラ）を持つ
+// Singleton::getInstance() や Time、Camera::main はスレッドごとの現在のコンテキストを参照する
+// 現在のコンテキストを設定していないスレッドはプロセス既定のコンテキストを使う
+// --------------------
+class EngineContext
+{
+public:
+    EngineContext() = default;
+    EngineContext(const EngineContext&) = delete;
+    EngineContext& operator=(const EngineContext&) = delete;
+
+    // 作成の逆順でシングルトンを破棄する
+    ~EngineContext();
+
+    // 現在のスレッドのコンテキスト
+    static EngineContext* current();
+
+    // 現在のスレッドのコンテキストを設定。nullptr でプロセス既定に戻す
+    static void setCurrent(EngineContext* context);
+
+    // プロセス既定のコンテキスト
+    static EngineContext* getDefault();
+
+    // スコープの間だけ現在のスレッドのコンテキストを切り替える
+    class Scope
+    {
+    public:
+        explicit Scope(EngineContext* context) : prev_(current_) { setCurrent(context); }
+        ~Scope() { current_ = prev_; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        EngineContext* prev_;
+    };
+
+    // 時間の状態
+    TimeState time;
+
+    // メインカメラ
+    Camera* mainCamera = nullptr;
+
+    // シングルトンのスロット
+    SingletonBase* getSlot(size_t index) const { return index < slots_.size() ? slots_[index].get() : nullptr; }
+    void setSlot(size_t index, std::unique_ptr<SingletonBase> instance);
+
+    // シングルトンの型ごとにスロット番号を割り当てる
+    static size_t allocateSlot();
+
+private:
+    std::vector<std::unique_ptr<SingletonBase>> slots_;
+    std::vector<size_t> creationOrder_;
+
+    static thread_local EngineContext* current_;
+};
+
+} // namespace UniDx
@@ -0,0 +1,297 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// EventListenerHandle
+// EventBus::subscribe() が返す、登録したリスナーを指す値
+// --------------------
+struct EventListenerHandle
+{
+    size_t type = 0;
+    uint32_t id = 0;
+
+    bool isValid() const { return id != 0; }
+};
+
+
+// --------------------
+// EventChannelBase
+// イベントの型ごとのチャンネルの基底
+// --------------------
+class EventChannelBase
+{
+public:
+    virtual ~EventChannelBase() = default;
+
+    // たまっているイベントをリスナーに配る。配ったイベントがあれば true
+    virtual bool dispatch() = 0;
+    virtual void unsubscribe(uint32_t id) = 0;
+
+    // イベントを発行したスレッドごとのキューの番号
+    // 番号はスレッドの終了時に返され、後から作られたスレッドが使い回す
+    // 同時に MaxPublisherThreads を超えるスレッドが発行したときだけ、超えた分はロック付きの共有キューを使う
+    static constexpr size_t MaxPublisherThreads = 64;
+    static size_t threadSlot();
+};
+
+
+// --------------------
+// EventChannel
+//
+// 発行されたイベントはスレッドごとの連続した配列にためておき、dispatch() でまとめて配る
+// リスナーは密な配列で保持する
+// --------------------
+template<class E>
+class EventChannel : public EventChannelBase
+{
+public:
+    using Listener = std::function<void(const E&)>;
+
+    virtual ~EventChannel()
+    {
+        for (auto& q : queues_)
+        {
+            delete q.load();
+        }
+    }
+
+    void subscribe(uint32_t id, Listener listener)
+    {
+        if (dispatching_)
+        {
+            // 配っている最中はリスナー配列を動かさない
+            added_.push_back({ id, std::move(listener) });
+            return;
+        }
+        ids_.push_back(id);
+        listeners_.push_back(std::move(listener));
+    }
+
+    virtual void unsubscribe(uint32_t id) override
+    {
+        for (size_t i = 0; i < ids_.size(); ++i)
+        {
+            if (ids_[i] == id)
+            {
+                if (dispatching_)
+                {
+                    // 配り終わってから詰める
+                    ids_[i] = 0;
+                    removed_ = true;
+                }
+                else
+                {
+                    removeAt(i);
+                }
+                return;
+            }
+        }
+        for (size_t i = 0; i < added_.size(); ++i)
+        {
+            if (added_[i].first == id)
+            {
+                added_.erase(added_.begin() + i);
+                return;
+            }
+        }
+    }
+
+    // 発行。キューの容量が足りていればメモリの確保はしない
+    void publish(const E& e)
+    {
+        size_t slot = threadSlot();
+        if (slot >= MaxPublisherThreads)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            overflow_.push_back(e);
+            return;
+        }
+
+        std::vector<E>* queue = queues_[slot].load(std::memory_order_acquire);
+        if (queue == nullptr)
+        {
+            // このスレッドで初めての発行
+            queue = new std::vector<E>();
+            queues_[slot].store(queue, std::memory_order_release);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            usedSlots_.push_back(slot);
+        }
+        queue->push_back(e);
+    }
+
+    virtual bool dispatch() override
+    {
+        bool dispatched = false;
+        dispatching_ = true;
+
+        // 発行したスレッドのキューごとにまとめて配る。同じスレッドから発行したものは発行順
+        for (size_t slot : usedSlots_)
+        {
+            std::vector<E>* queue = queues_[slot].load(std::memory_order_acquire);
+            if (queue->empty()) continue;
+
+            // 配っている間に発行されたものは次の dispatch() に回す
+            batch_.swap(*queue);
+            deliver();
+            dispatched = true;
+        }
+        if (!overflow_.empty())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                batch_.swap(overflow_);
+            }
+            deliver();
+            dispatched = true;
+        }
+
+        dispatching_ = false;
+
+        // 配っている間に変わったリスナーの反映
+        if (removed_)
+        {
+            for (size_t i = ids_.size(); i-- > 0;)
+            {
+                if (ids_[i] == 0) removeAt(i);
+            }
+            removed_ = false;
+        }
+        for (auto& it : added_)
+        {
+            ids_.push_back(it.first);
+            listeners_.push_back(std::move(it.second));
+        }
+        added_.clear();
+
+        return dispatched;
+    }
+
+private:
+    std::vector<uint32_t> ids_;
+    std::vector<Listener> listeners_;
+    std::vector<std::pair<uint32_t, Listener>> added_;
+    bool dispatching_ = false;
+    bool removed_ = false;
+
+    std::array<std::atomic<std::vector<E>*>, MaxPublisherThreads> queues_ = {};
+    std::vector<size_t> usedSlots_;
+    std::vector<E> overflow_;
+    std::vector<E> batch_;
+    std::mutex mutex_;
+
+    void deliver()
+    {
+        const size_t count = listeners_.size();
+        for (const E& e : batch_)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (ids_[i] != 0) listeners_[i](e);
+            }
+        }
+        batch_.clear();
+    }
+
+    // 末尾と入れ替えて削除
+    void removeAt(size_t i)
+    {
+        ids_[i] = ids_.back();
+        ids_.pop_back();
+        listeners_[i] = std::move(listeners_.back());
+        listeners_.pop_back();
+    }
+};
+
+
+// --------------------
+// EventBus
+//
+// 型付きのイベントを発行・購読する
+//
+//  struct EnemyKilled { GameObject* enemy; int score; };
+//
+//  EventBus::getInstance()->subscribe<EnemyKilled>([](const EnemyKilled& e) { ... });
+//  EventBus::getInstance()->publish(EnemyKilled{ enemy, 100 });
+//
+// 発行したイベントはすぐには配られず、Engine が決まった同期点で dispatch() したときにまとめて配られる
+// （固定時間更新と物理計算の後、Update の後、LateUpdate の後）
+// publish() はワーカースレッドから呼んでもよいが、同期点までにジョブを終わらせておくこと
+// subscribe() / unsubscribe() / dispatch() はメインスレッドから呼ぶ
+// --------------------
+class EventBus : public Singleton<EventBus>
+{
+public:
+    static constexpr size_t MaxEventTypes = 256;
+
+    virtual ~EventBus();
+
+    template<class E>
+    EventListenerHandle subscribe(std::function<void(const E&)> listener)
+    {
+        EventListenerHandle handle{ typeIndex<E>(), nextListenerId_++ };
+        channel<E>()->subscribe(handle.id, std::move(listener));
+        return handle;
+    }
+
+    void unsubscribe(EventListenerHandle handle);
+
+    template<class E>
+    void publish(const E& e)
+    {
+        channel<E>()->publish(e);
+    }
+
+    // たまっているイベントをすべて配る
+    // 配っている間に発行されたイベントも、続けて配る
+    void dispatch();
+
+private:
+    std::array<std::atomic<EventChannelBase*>, MaxEventTypes> channels_ = {};
+    std::vector<size_t> usedTypes_;
+    std::mutex mutex_;
+    uint32_t nextListenerId_ = 1;
+
+    static size_t allocateTypeIndex();
+
+    template<class E>
+    static size_t typeIndex()
+    {
+        static const size_t index = allocateTypeIndex();
+        return index;
+    }
+
+    template<class E>
+    EventChannel<E>* channel()
+    {
+        size_t index = typeIndex<E>();
+        EventChannelBase* c = channels_[index].load(std::memory_order_acquire);
+        if (c == nullptr)
+        {
+            // 初めて使う型。ワーカースレッドからの発行と競合しないようにロックして作る
+            std::lock_guard<std::mutex> lock(mutex_);
+            c = channels_[index].load(std::memory_order_relaxed);
+            if (c == nullptr)
+            {
+                c = new EventChannel<E>();
+                channels_[index].store(c, std::memory_order_release);
+                usedTypes_.push_back(index);
+            }
+        }
+        return static_cast<EventChannel<E>*>(c);
+    }
+};
+
+} // namespace UniDx
@@ -2,6 +2,7 @@
 
 #include "Object.h"
 
+#include <vector>
 #include <SpriteFont.h>
 
 namespace UniDx {
@@ -13,11 +14,14 @@ public:
 
 	bool Load(const wchar_t* filePath);
 	bool Load(const wstring& filePath) { return Load(filePath.c_str()); }
+	bool Create(const wstring& filePath, const std::vector<uint8_t>& data);
 
 	DirectX::SpriteFont* getSpriteFont() const;
+	const wstring& getFilePath() const { return filePath; }
 
 private:
 	wstring fileName;
+	wstring filePath;
 	unique_ptr<DirectX::SpriteFont> spriteFont;
 };
 
@@ -16,6 +16,8 @@ class Component;
 class Behaviour;
 class Transform;
 class Collider;
+class Prefab;
+class SceneManager;
 
 
 // --------------------
@@ -26,13 +28,19 @@ class GameObject : public Object
 public:
     Transform* transform;
 
+    // 自身のアクティブ状態
+    ReadOnlyProperty<bool> activeSelf;
+
     const std::vector<std::unique_ptr<Component>>& GetComponents() { return components; }
 
-    GameObject(wstring_view n = L"GameObject") : Object([this](){return wstring_view(name_);}), name_(n)
+    GameObject(wstring_view n = L"GameObject") : Object([this](){return wstring_view(name_);}),
+        activeSelf([this]() { return active_; }),
+        name_(n)
     {
         // デフォルトでTransformを追加
         transform = AddComponent<Transform>();
     }
+    virtual ~GameObject();
     // 可変長引数でunique_ptr<Component>を受け取るコンストラクタ
     template<typename First, typename... ComponentPtrs>
         requires (!std::same_as<std::remove_cvref_t<First>, Vector3>)
@@ -85,6 +93,16 @@ public:
 
     void SetName(const wstring& n) { name_ = n; }
 
+    // アクティブ状態の変更
+    // 非アクティブの間は子も含めて更新・描画されず、有効なコンポーネントには OnDisable() が呼ばれる
+    void SetActive(bool value);
+
+    // 親も含めてアクティブか
+    bool activeInHierarchy() const { return activeInHierarchy_; }
+
+    // 親の変更などで、親を含めたアクティブ状態を計算し直す
+    void updateActiveInHierarchy();
+
     virtual void onTriggerEnter(Collider* other);
     virtual void onTriggerStay(Collider* other);
     virtual void onTriggerExit(Collider* other);
@@ -94,7 +112,19 @@ public:
 
 protected:
     wstring name_;
+    bool active_ = true;
+    bool activeInHierarchy_ = true;
     std::vector<std::unique_ptr<Component>> components;
+
+private:
+    friend class SceneManager;
+    friend class Prefab;
+
+    // Destroy() の予約済みか
+    bool destroyQueued_ = false;
+
+    // プールから作られた場合の元の Prefab
+    std::weak_ptr<Prefab> prefab_;
 };
 
 } // namespace UniDx
@@ -1,12 +1,110 @@
 ﻿#pragma once
 
-#include <tiny_gltf.h>
-
 #include "Renderer.h"
+#include "Bounds.h"
+#include "AssetDatabase.h"
+#include "SceneSerializer.h"
 
 
 namespace UniDx {
 
+// --------------------
+// GltfModelAsset
+//
+// glTF ファイルから作る、変更しないモデルのテンプレート
+// ノードの階層、サブメッシュ（頂点バッファ作成済み）、テクスチャのラップモードを持つ
+// 同じファイルと頂点の型の GltfModel で共有し、インスタンスごとに作るのは GameObject の階層だけ
+// 読み込みが終わると glTF のデータ（バイナリと画像）は手放す
+// GLB はファイルをマップしたまま持ち、サブメッシュは可能ならマップした BIN チャンクを直接参照する
+// 読み込んだモデルは MeshCache に書き出し、次からは変換済みのファイルから作る
+// --------------------
+class GltfModelAsset
+{
+public:
+    struct Node
+    {
+        std::wstring name;
+        Vector3 position;
+        Quaternion rotation;
+        Vector3 scale;
+        int parent;         // nodes の番号。ルートなら -1
+        int mesh;           // meshes の番号。なければ -1
+    };
+
+    // glTF のメッシュが使うサブメッシュの範囲（プリミティブごとにひとつ）
+    struct MeshRange
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // 読み込む。同じファイルと頂点の型で読み込み済みなら共有する
+    template<typename TVertex>
+    static std::shared_ptr<const GltfModelAsset> Load(const std::wstring& filePath)
+    {
+        static const SceneVertexType vertex = SceneVertexType::Create<TVertex>(L"");
+        return Load(filePath, vertex);
+    }
+    static std::shared_ptr<const GltfModelAsset> Load(const std::wstring& filePath, const SceneVertexType& vertex);
+
+    // 頂点バッファを作らずに読み込む。GPU も AssetDatabase も使わないので、ワーカースレッドで呼べる
+    // 結果は共有されないので、メインスレッドで Register() してから使う
+    static std::shared_ptr<GltfModelAsset> Decode(const std::wstring& filePath, const SceneVertexType& vertex);
+
+    // Decode() したものの頂点バッファを作って共有に加える
+    // 同じファイルと頂点の型で読み込み済みなら、decoded は使わずにそちらを返す
+    static std::shared_ptr<const GltfModelAsset> Register(std::shared_ptr<GltfModelAsset> decoded);
+
+    // false にするとプリミティブを JobSystem で並列にデコードしない（比較用）
+    static void setParallelDecode(bool enabled);
+    static bool isParallelDecode();
+
+    const std::wstring& getFilePath() const { return filePath_; }
+    const D3D11_INPUT_ELEMENT_DESC* getVertexLayout() const { return layout_; }
+
+    // 親が子より先に並ぶ
+    const std::vector<Node>& getNodes() const { return nodes_; }
+    const std::vector<MeshRange>& getMeshes() const { return meshes_; }
+    const std::vector<std::shared_ptr<SubMesh>>& getSubMeshes() const { return submesh_; }
+
+    // サブメッシュごとの頂点の範囲（ローカル座標）
+    const std::vector<Bounds>& getSubMeshBounds() const { return bounds_; }
+
+    // テクスチャのサンプラのラップモード。範囲外なら false
+    bool getAddressModeUV(int texIndex, D3D11_TEXTURE_ADDRESS_MODE& u, D3D11_TEXTURE_ADDRESS_MODE& v) const;
+
+    // ノードの階層を parent の子として作る
+    // 作ったルートのノードを roots に、メッシュを持つノードの MeshRenderer を renderers に追加する
+    void Instantiate(GameObject* parent, std::vector<GameObject*>& roots, std::vector<MeshRenderer*>& renderers) const;
+
+private:
+    friend class MeshCache;
+
+    struct TextureWrap
+    {
+        D3D11_TEXTURE_ADDRESS_MODE u;
+        D3D11_TEXTURE_ADDRESS_MODE v;
+    };
+
+    std::wstring filePath_;
+    const D3D11_INPUT_ELEMENT_DESC* layout_ = nullptr;
+    std::vector<Node> nodes_;
+    std::vector<MeshRange> meshes_;
+    std::vector<std::shared_ptr<SubMesh>> submesh_;
+    std::vector<Bounds> bounds_;
+    std::vector<TextureWrap> textureWraps_;
+
+    // createBuffers() で使う
+    void (*createBuffer_)(SubMesh*) = nullptr;
+    std::vector<const std::byte*> packedVertices_;  // MeshCache から作ったときの、サブメッシュごとの詰めた頂点
+
+    static std::shared_ptr<GltfModelAsset> parse(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout);
+
+    // サブメッシュの頂点バッファとインデックスバッファを作る（メインスレッド）
+    void createBuffers();
+};
+
+
 // --------------------
 // GltfModelクラス
 // --------------------
@@ -17,31 +115,38 @@ public:
 
     // glTF形式のモデルファイルを読み込む（モデル、シェーダ、テクスチャ1枚を指定）
     // 内部で階層構造を構築するので、あらかじめ GameObject にアタッチしておく必要がある
+    // テクスチャのラップモードがモデルの指定と違えば、同じ画像をモデルのラップモードで読み込んだものを使う
+    // （渡されたテクスチャは共有されているかもしれないので書き換えない）
     template<typename TVertex>
     bool Load(const std::wstring& modelPath, const std::wstring& shaderPath, std::shared_ptr<Texture> texture)
     {
         // モデル
         if (!Load<TVertex>(modelPath)) return false;
 
-        // マテリアルとシェーダー
-        auto material = std::make_shared<Material>();
-        if (!material->shader.compile<TVertex>(shaderPath)) return false;
-
         // テクスチャ
-        SetAddressModeUV(texture.get(), 0);     // モデルで指定されたラップモード
-        material->AddTexture(texture);
-
-        AddMaterial(material);
-        return true;
+        D3D11_TEXTURE_ADDRESS_MODE u, v;
+        GetAddressModeUV(0, u, v);     // モデルで指定されたラップモード
+        if ((texture->wrapModeU != u || texture->wrapModeV != v) && !texture->getFilePath().empty())
+        {
+            auto wrapped = AssetDatabase::getInstance()->LoadTexture(texture->getFilePath(), u, v);
+            if (wrapped == nullptr) return false;
+            texture = wrapped;
+        }
+        return AddMaterial<TVertex>(shaderPath, texture);
     }
     template<typename TVertex>
     bool Load(const std::wstring& modelPath, const std::wstring& shaderPath, const std::wstring& texturePath)
     {
-        // テクスチャ読み込み
-        auto tex = std::make_shared<Texture>();
-        if (!tex->Load(texturePath)) return false;
+        // モデル
+        if (!Load<TVertex>(modelPath)) return false;
+
+        // テクスチャ読み込み（モデルで指定されたラップモードごとに共有）
+        D3D11_TEXTURE_ADDRESS_MODE u, v;
+        GetAddressModeUV(0, u, v);
+        auto tex = AssetDatabase::getInstance()->LoadTexture(texturePath, u, v);
+        if (tex == nullptr) return false;
 
-        return Load<TVertex>(modelPath, shaderPath, tex);
+        return AddMaterial<TVertex>(shaderPath, tex);
     }
 
     // glTF形式のモデルファイルを読み込む（モデル、シェーダを指定）
@@ -63,15 +168,7 @@ public:
     template<typename TVertex>
     bool Load(const std::wstring& filePath)
     {
-        if (load_(filePath))
-        {
-            for (auto& sub : submesh)
-            {
-                sub->createBuffer<TVertex>();
-            }
-            return true;
-        }
-        return false;
+        return Load(GltfModelAsset::Load<TVertex>(filePath));
     }
 
     // 生成した全ての Renderer にマテリアルを追加
@@ -84,17 +181,41 @@ public:
         materials.push_back(material);
     }
 
+    // シェーダとテクスチャ1枚のマテリアルを作って追加
+    template<typename TVertex>
+    bool AddMaterial(const std::wstring& shaderPath, std::shared_ptr<Texture> texture)
+    {
+        auto material = std::make_shared<Material>();
+        if (!material->shader.compile<TVertex>(shaderPath)) return false;
+        material->AddTexture(texture);
+
+        AddMaterial(material);
+        return true;
+    }
+
+    // 読み込み済みのモデルからノードを作る
+    bool Load(std::shared_ptr<const GltfModelAsset> asset);
+
+    // 使っているモデル（読み込んでいなければ nullptr）
+    const std::shared_ptr<const GltfModelAsset>& GetAsset() const { return model; }
+
+    // このモデルの指定インデクスのテクスチャのラップモード（指定がなければ WRAP）
+    void GetAddressModeUV(int texIndex, D3D11_TEXTURE_ADDRESS_MODE& u, D3D11_TEXTURE_ADDRESS_MODE& v) const;
+
     // Textureのラップモードをこのモデルの指定インデクスのテクスチャ設定に合わせる
     void SetAddressModeUV(Texture* texture, int texIndex) const;
 
+    // モデルのパス、頂点の型、マテリアルを書き出す
+    // ノードの GameObject は読み込み時にモデルから作り直すので書き出さない
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
 protected:
     std::vector<MeshRenderer*> renderer;
     std::vector<std::shared_ptr<Material>> materials;
-    std::unique_ptr< tinygltf::Model> model;
-    std::vector< std::shared_ptr<SubMesh> > submesh;
+    std::shared_ptr<const GltfModelAsset> model;
 
-    bool load_(const std::wstring& filePath);
-    void createNodeRecursive(const tinygltf::Model& model, int nodeIndex, GameObject* parentGO);
+    std::vector<GameObject*> nodes_;    // モデルから作ったルートのノード
 };
 
 
@@ -2,45 +2,47 @@
 
 #include <Keyboard.h>
 #include "UniDxDefine.h"
+#include "Singleton.h"
 
 
 namespace UniDx
 {
 
 // Input
-class Input
+// L[̏Ԃ EngineContext ƂɎ̂ŁÃGWʃXbhœĂ݂ɉeȂ
+class Input : public Singleton<Input>
 {
 public:
-    static void initialize()
-    {
-        keyboard = std::make_unique< DirectX::Keyboard>();
-    }
+    // DirectX::Keyboard ̓vZXłЂƂȂ̂ŁAuseKeyboard ̍ŏ̌Ăяo쐬
+    // wbhX[hł̓L[{[hgȂiL[ׂ͂ėĂ鈵ɂȂj
+    static void initialize(bool useKeyboard);
 
-    static void update()
-    {
-        prevKeyState = nowKeyState;
-        nowKeyState = keyboard->GetState();
-    }
+    static void update();
 
     static bool GetKey(DirectX::Keyboard::Keys key)
     {
-        return nowKeyState.IsKeyDown(key);
+        Input* input = getInstance();
+        return input != nullptr && input->nowKeyState.IsKeyDown(key);
     }
 
     static bool GetKeyDown(DirectX::Keyboard::Keys key)
     {
-        return prevKeyState.IsKeyUp(key) && nowKeyState.IsKeyDown(key);
+        Input* input = getInstance();
+        return input != nullptr && input->prevKeyState.IsKeyUp(key) && input->nowKeyState.IsKeyDown(key);
     }
 
     static bool GetKeyUp(DirectX::Keyboard::Keys key)
     {
-        return prevKeyState.IsKeyDown(key) && nowKeyState.IsKeyUp(key);
+        Input* input = getInstance();
+        return input != nullptr && input->prevKeyState.IsKeyDown(key) && input->nowKeyState.IsKeyUp(key);
     }
 
 protected:
     static std::unique_ptr<DirectX::Keyboard> keyboard;
-    static DirectX::Keyboard::State nowKeyState;
-    static DirectX::Keyboard::State prevKeyState;
+
+    bool useKeyboard_ = false;
+    DirectX::Keyboard::State nowKeyState{};
+    DirectX::Keyboard::State prevKeyState{};
 };
 
 }
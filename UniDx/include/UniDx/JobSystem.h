@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// JobCounter
+// 投入したジョブの完了待ちに使うカウンタ
+// --------------------
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    // 登録されたジョブがすべて完了したか
+    bool isDone() const { return count_.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    // 下位ビットが未完了のジョブの数、WaitingBit はこのカウンタを待って止めているジョブがあること
+    // 止めているジョブをキューに入れ終わるまで isDone() にならないよう、ひとつの値にまとめている
+    static constexpr int WaitingBit = 1 << 30;
+    mutable std::atomic<int> count_ = 0;
+};
+
+
+// --------------------
+// JobSystem
+//
+// ワークスティーリング方式のジョブシステム
+// ワーカーごとに両端キューを持ち、自分のキューは末尾から、他のキューは先頭から盗んで実行する
+// ワーカー数 0 のときは schedule() の中で即座に実行する（デバッグ用）
+// 複数の EngineContext から共有するため、プロセスでひとつ
+// --------------------
+class JobSystem : public Singleton<JobSystem, SingletonScope_Process>
+{
+public:
+    using JobFunc = std::function<void()>;
+    using RangeFunc = std::function<void(size_t begin, size_t end)>;
+
+    virtual ~JobSystem();
+
+    // ワーカースレッドを起動
+    // workerCount が負ならコア数 - 1、0 ならワーカーを作らずインラインで実行
+    void Initialize(int workerCount = -1);
+
+    // ワーカースレッドを停止。残っているジョブは呼び出したスレッドで実行してから止める
+    void Finalize();
+
+    // ワーカースレッドの数
+    size_t getWorkerCount() const { return workers_.size(); }
+
+    // ジョブを投入
+    // counter は投入時に加算され、ジョブの完了時に減算される
+    // dependency を指定すると、そのカウンタが完了するまでキューに入れずに止めておき、
+    // 完了したときにキューへ入れる
+    void schedule(JobFunc job, JobCounter* counter = nullptr, const JobCounter* dependency = nullptr);
+
+    // カウンタが完了するまで待つ
+    // 待っている間は呼び出したスレッドもジョブを実行する
+    void wait(const JobCounter& counter);
+
+    // [begin, end) を分割して並列に実行し、すべて終わるまで待つ
+    // chunkSize が 0 のときはワーカー数から自動で決める
+    void parallelFor(size_t begin, size_t end, const RangeFunc& func, size_t chunkSize = 0);
+
+private:
+    struct Job
+    {
+        JobFunc func;
+        JobCounter* counter;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    // キュー 0 はワーカー以外のスレッド（メインスレッド）用、1～ がワーカー用
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::atomic<bool> running_ = false;
+    std::atomic<int> queuedJobs_ = 0;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeUp_;
+
+    // 依存先のカウンタが完了するのを待っているジョブ
+    std::mutex waitingMutex_;
+    std::unordered_multimap<const JobCounter*, Job> waiting_;
+
+    // このスレッドが使うキューの番号
+    static thread_local size_t queueIndex_;
+
+    void push(size_t queueIndex, Job&& job);
+    bool popLocal(size_t queueIndex, Job& job);
+    bool steal(size_t queueIndex, Job& job);
+    bool tryRunOne();
+    void execute(Job& job);
+    bool parkUntilDone(const JobCounter* dependency, Job& job);
+    void resumeWaiting(const JobCounter* counter);
+    void workerMain(size_t queueIndex);
+};
+
+} // namespace UniDx
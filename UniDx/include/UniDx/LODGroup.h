@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <vector>
+#include <SimpleMath.h>
+
+#include "Component.h"
+
+namespace UniDx
+{
+
+class Camera;
+class MeshRenderer;
+
+
+// --------------------
+// LODGroup
+//
+// 自身と子の MeshRenderer が描くサブメッシュの LOD を、Camera::main から見た大きさで選ぶ
+// 大きさは、まとめた範囲の高さが画面の高さに占める割合で測る
+// 選ぶのは LODManager がフレームごとにすべての LODGroup をまとめて行う
+// --------------------
+class LODGroup : public Component
+{
+public:
+    // 画面の高さに対する割合の境目（大きい順）。下回った数だけ粗い LOD を使う
+    std::vector<float> screenRelativeHeights = { 0.5f, 0.25f, 0.1f };
+
+    // 切り替えのちらつきを抑える幅（境目に対する割合）
+    float hysteresis = 0.1f;
+
+    ~LODGroup();
+
+    // 自身と子の MeshRenderer を集め、まとめた範囲を計算し直す
+    // 子を追加したり、メッシュを差し替えたりしたら呼ぶ
+    void RecalculateBounds();
+
+    // 今使っている LOD（0 が元のメッシュ）
+    int getCurrentLOD() const { return currentLOD_; }
+
+    // 強制的に LOD を指定する。負なら見た大きさで選ぶ
+    void ForceLOD(int lod);
+
+    // カメラから見た大きさで LOD を選び、MeshRenderer に設定する（LODManager から呼ばれる）
+    void updateLOD(const Vector3& cameraPosition, float screenScale);
+
+    // 子の MeshRenderer が破棄されたときに呼ばれる
+    void removeRenderer(MeshRenderer* renderer);
+
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
+protected:
+    virtual void OnEnable() override;
+    virtual void OnDisable() override;
+
+private:
+    std::vector<MeshRenderer*> renderers_;
+    Vector3 localReferencePoint_ = Vector3::Zero;   // まとめた範囲の中心（ローカル座標）
+    float size_ = 0.0f;                             // まとめた範囲の大きさ（ローカル座標）
+    bool boundsValid_ = false;
+    int currentLOD_ = 0;
+    int forcedLOD_ = -1;
+
+    void collectRenderers(GameObject* object);
+    void applyLOD(int lod);
+};
+
+} // namespace UniDx
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "UniDxDefine.h"
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+class Camera;
+class LODGroup;
+
+
+// --------------------
+// LODManager
+//
+// 有効な LODGroup を集めておき、フレームごとに一度、すべての LOD をまとめて選ぶ
+// --------------------
+class LODManager : public Singleton<LODManager>
+{
+public:
+    void registerGroup(LODGroup* group);
+    void unregisterGroup(LODGroup* group);
+
+    // camera から見た大きさで、すべての LODGroup の LOD を選ぶ
+    void updateLODs(const Camera& camera);
+
+    size_t getGroupCount() const { return groups_.size(); }
+
+private:
+    std::vector<LODGroup*> groups_;
+};
+
+} // namespace UniDx
@@ -32,9 +32,20 @@ public:
 
     Light() : color(1,1,1,1), type(LightType_Directional), intensity(1), range(180), spotAngle(180){}
 
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
 protected:
     virtual void OnEnable() override;
     virtual void OnDisable() override;
+
+private:
+    friend class LightManager;
+
+    // LightManagerが使うワールド空間の姿勢キャッシュ
+    uint64_t transformVersion_ = 0;
+    Vector3 positionWS_;
+    Vector3 directionWS_;
 };
 
 } // namespace UniDx
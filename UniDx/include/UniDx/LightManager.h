@@ -43,7 +43,7 @@ private:
     std::vector<Light*> lights_;
     size_t              capacity_ = 0;
 
-    std::vector<GPULight> gpuLights_;
+    std::vector<GPULight> uploadedLights_;  // 前回バッファに書き込んだ内容
     Microsoft::WRL::ComPtr<ID3D11Buffer>           lightBuf_;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>lightSRV_;
 //    Microsoft::WRL::ComPtr<ID3D11Buffer>           metaCB_;
@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Singleton.h"
+
+namespace UniDx
+{
+
+// --------------------
+// LinearAllocator
+//
+// ポインタを進めるだけで確保し、reset() でまとめて解放するアロケータ
+// 個別の解放はしない
+// 容量が足りないときは一時的にヒープから追加で確保し、次の reset() で
+// それまでの使用量が入る大きさに作り直す。以降は同じ使い方ならヒープを使わない
+// --------------------
+class LinearAllocator
+{
+public:
+    explicit LinearAllocator(size_t capacity = 64 * 1024);
+    ~LinearAllocator();
+
+    LinearAllocator(const LinearAllocator&) = delete;
+    LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template<class T>
+    T* allocateArray(size_t count) { return static_cast<T*>(allocate(sizeof(T) * count, alignof(T))); }
+
+    // 確保したものをすべて解放する
+    void reset();
+
+    // 現在使っているバイト数
+    size_t getUsedBytes() const { return offset_ + overflowBytes_; }
+
+    size_t getCapacity() const { return capacity_; }
+
+    // 容量が足りずにヒープから追加で確保した回数（累計）
+    uint64_t getOverflowCount() const { return overflowCount_; }
+
+private:
+    std::byte* buffer_ = nullptr;
+    size_t capacity_ = 0;
+    size_t offset_ = 0;
+
+    std::vector<std::byte*> overflow_;
+    size_t overflowBytes_ = 0;
+    uint64_t overflowCount_ = 0;
+};
+
+
+// --------------------
+// LinearAllocatorAdapter
+// LinearAllocator から確保する STL 用のアロケータ
+// deallocate では何もしない
+// --------------------
+template<class T>
+class LinearAllocatorAdapter
+{
+public:
+    using value_type = T;
+
+    LinearAllocatorAdapter(LinearAllocator& allocator) noexcept : allocator_(&allocator) {}
+
+    template<class U>
+    LinearAllocatorAdapter(const LinearAllocatorAdapter<U>& other) noexcept : allocator_(other.allocator_) {}
+
+    T* allocate(size_t n) { return allocator_->allocateArray<T>(n); }
+    void deallocate(T*, size_t) noexcept {}
+
+    template<class U>
+    bool operator==(const LinearAllocatorAdapter<U>& other) const noexcept { return allocator_ == other.allocator_; }
+
+private:
+    template<class U> friend class LinearAllocatorAdapter;
+    LinearAllocator* allocator_;
+};
+
+
+// 一時的な配列
+// 確保元の LinearAllocator が reset() されるまでに使い終わること
+template<class T>
+using TransientVector = std::vector<T, LinearAllocatorAdapter<T>>;
+
+
+// --------------------
+// FrameMemory
+//
+// フレームの間だけ使うデータ用のアロケータ
+// frame()     : フレームの始め（updateFrame の先頭）で解放される。描画の終わりまで使える
+// fixedStep() : 固定時間更新の始めで解放される
+//               2つを交互に使うので、確保したものは次の固定時間更新の終わりまで使える
+// --------------------
+class FrameMemory : public Singleton<FrameMemory>
+{
+public:
+    static constexpr size_t FrameCapacity = 256 * 1024;
+    static constexpr size_t FixedStepCapacity = 64 * 1024;
+
+    FrameMemory();
+
+    LinearAllocator& frame() { return frame_; }
+    LinearAllocator& fixedStep() { return fixedStep_[fixedStepIndex_]; }
+
+    // Engine から呼ばれる
+    void beginFrame();
+    void beginFixedStep();
+
+private:
+    LinearAllocator frame_;
+    LinearAllocator fixedStep_[2];
+    int fixedStepIndex_ = 0;
+};
+
+
+// --------------------
+// AllocationCounter
+//
+// グローバルな operator new の呼び出し回数をスレッドごとに数える
+// 定常状態のフレームでヒープ確保が起きていないかの確認用
+// ライブラリ自体は operator new を置き換えない
+// 計測したい実行ファイルが自分で置き換えて recordAllocation() を呼び、setEnabled(true) する
+// --------------------
+class AllocationCounter
+{
+public:
+    // 数えているか
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    // 置き換えた operator new から確保のたびに呼ぶ
+    static void recordAllocation() noexcept;
+
+    // 現在のスレッドで operator new が呼ばれた回数（累計）
+    static uint64_t getThreadCount();
+};
+
+} // namespace UniDx
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <string>
+#include <cstddef>
+#include <windows.h>
+
+namespace UniDx
+{
+
+// --------------------
+// MappedFile
+// ファイルを読み取り専用でメモリにマップする
+// data() はマップを閉じるまで有効
+// --------------------
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::wstring& path);
+    void close();
+
+    bool isOpen() const { return data_ != nullptr; }
+    const std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace UniDx
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <deque>
 #include <memory>
 #include <span>
 #include <vector>
@@ -16,6 +17,21 @@ namespace UniDx {
 
 class Camera;
 class Texture;
+class MappedFile;
+
+// --------------------
+// SubMeshLOD構造体
+// 簡略化した詳細度。頂点バッファは元のサブメッシュのものを使い、インデックスだけを持つ
+// --------------------
+struct SubMeshLOD
+{
+    std::span<const uint32_t> indices;
+    float error = 0.0f;     // 元の形からの誤差（メッシュの大きさに対する割合）
+
+    ComPtr<ID3D11Buffer> indexBuffer;
+    DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+};
+
 
 // --------------------
 // SubMesh構造体
@@ -33,10 +49,18 @@ struct SubMesh
     std::span<const Vector2> uv4;
     std::span<const uint32_t> indices;
 
+    // 粗くしていく順の LOD（lods[0] が詳細度 1）
+    std::vector<SubMeshLOD> lods;
+
+    // 上の span がマップしたファイルを直接指しているときのファイル
+    // SubMesh が生きている間はマップを閉じない
+    std::shared_ptr<const MappedFile> mappedFile;
+
     ComPtr<ID3D11Buffer> vertexBuffer;
     ComPtr<ID3D11Buffer> indexBuffer;
 
     UINT stride;
+    DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT; // createIndexBuffer で 16bit に縮められれば R16_UINT
 
     template<typename TVertex>
     size_t copyTo(std::span<TVertex> vertex)
@@ -113,10 +137,15 @@ struct SubMesh
 
     // GPUにバッファを作成
     void createVertexBuffer(void* data);
-    void createIndexBuffer();
+    void createIndexBuffer();   // LOD のインデックスバッファも作る
+    static void createIndexBuffer(std::span<const uint32_t> src, ComPtr<ID3D11Buffer>& buffer, DXGI_FORMAT& format);
 
-    // 描画
-    void Render() const;
+    // すべてのインデックスが 16bit に収まれば dst に詰め直して true を返す
+    // 0xFFFF はストリップの区切りとして扱われるので使わない
+    static bool narrowIndices(std::span<const uint32_t> src, std::vector<uint16_t>& dst);
+
+    // 描画。lod が 1 以上なら、その詳細度の LOD（なければ最も粗いもの）のインデックスで描く
+    void Render(int lod = 0) const;
 
     // 法線のコピー
     template<typename TVertex>
@@ -182,6 +211,12 @@ struct OwnedSubMesh : public SubMesh
     const std::vector<Vector2>& mutableUV4() { return uv4_data; }
     const std::vector<uint32_t>& mutableIndices() { return indices_data; }
 
+    // LOD を追加
+    void addLOD(std::vector<uint32_t> lodIndices, float error) {
+        lod_data.push_back(std::move(lodIndices));
+        lods.push_back(SubMeshLOD{ std::span<const uint32_t>(lod_data.back().data(), lod_data.back().size()), error });
+    }
+
     // 必要なサイズだけ確保し、spanを設定
     void resizePositions(size_t n) {
         positions_data.resize(n);
@@ -225,6 +260,7 @@ protected:
     std::vector<Vector2> uv3_data;
     std::vector<Vector2> uv4_data;
     std::vector<uint32_t> indices_data;
+    std::deque<std::vector<uint32_t>> lod_data;     // 追加しても要素のアドレスが変わらないように deque
 };
 
 
@@ -239,11 +275,11 @@ public:
     Mesh() : Object([this]() {return name_;}) {}
     virtual ~Mesh() {}
 
-    void Render() const
+    void Render(int lod = 0) const
     {
         for (auto& sub : submesh)
         {
-            sub->Render();
+            sub->Render(lod);
         }
     }
 
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Mesh.h"
+#include "Bounds.h"
+
+namespace UniDx
+{
+
+class GltfModelAsset;
+struct SceneVertexType;
+
+//
+// 変換済みメッシュのファイルの形式
+//
+// ヘッダ、各テーブル、文字、データの順に並ぶ。オフセットはファイル先頭からのバイト数
+// データには頂点の型に合わせて詰めた頂点（そのまま頂点バッファに転送する）、属性ごとの配列、インデックスが入る
+// 属性ごとの配列はマップしたまま SubMesh のスパンから参照する
+//
+namespace CookedMeshFile
+{
+    constexpr uint32_t Magic = 'U' | ('D' << 8) | ('X' << 16) | ('M' << 24);
+    constexpr uint16_t Version = 2;
+    constexpr uint32_t DataAlignment = 16;
+
+    enum Attribute : uint32_t
+    {
+        Attribute_Position,
+        Attribute_Normal,
+        Attribute_Color,
+        Attribute_UV,
+        Attribute_UV2,
+        Attribute_UV3,
+        Attribute_UV4,
+        Attribute_Count
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t charSize;          // 文字列の1文字のバイト数（sizeof(wchar_t)）
+        uint64_t sourceSize;        // 元のファイルのサイズ
+        int64_t sourceTime;         // 元のファイルの更新日時
+        uint64_t sourceHash;        // 元のファイルの内容のハッシュ
+        uint64_t layoutHash;        // 頂点の型のハッシュ
+        uint32_t stride;            // 頂点のバイト数
+        uint32_t nodeCount;
+        uint32_t meshCount;
+        uint32_t subMeshCount;
+        uint32_t textureCount;
+        uint32_t lodCount;
+        uint32_t nodeOffset;
+        uint32_t meshOffset;
+        uint32_t subMeshOffset;
+        uint32_t textureOffset;
+        uint32_t lodOffset;
+        uint32_t charOffset;
+        uint64_t fileSize;
+    };
+
+    struct NodeRecord
+    {
+        uint32_t nameOffset;        // 文字領域の先頭からの文字数
+        uint32_t nameLength;
+        int32_t parent;
+        int32_t mesh;
+        Vector3 position;
+        Quaternion rotation;
+        Vector3 scale;
+    };
+
+    struct MeshRecord
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    struct SubMeshRecord
+    {
+        uint32_t topology;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t attributes;        // 持っている属性のビット
+        uint64_t vertexOffset;      // 詰めた頂点（stride * vertexCount バイト）
+        uint64_t attributeOffset[Attribute_Count];
+        uint64_t indexOffset;       // 32bit のインデックス
+        Bounds bounds;
+        uint32_t lodFirst;          // LODRecord の範囲
+        uint32_t lodCount;
+    };
+
+    struct LODRecord
+    {
+        uint32_t indexCount;
+        float error;
+        uint64_t indexOffset;       // 32bit のインデックス
+    };
+
+    struct TextureRecord
+    {
+        int32_t wrapU;
+        int32_t wrapV;
+    };
+}
+
+
+// --------------------
+// MeshCache
+//
+// glTF から作ったモデルを、元のファイルと頂点の型の組ごとに変換済みのファイルとして保存する
+// 元のファイルが変わっていなければ、次からは glTF の解析と頂点の詰め直しをせずに
+// 変換済みのファイルをマップして頂点バッファを作るだけになる
+// 元のファイルはサイズと更新日時で比べ、日時だけが違う場合は内容のハッシュで比べる
+// --------------------
+class MeshCache
+{
+public:
+    // 変換済みのファイルを置くディレクトリ（既定は "Cache/Mesh"）。空にするとキャッシュを使わない
+    static void SetDirectory(const std::wstring& directory);
+    static std::wstring GetDirectory();
+
+    // 元のファイルと頂点の型に対応する変換済みのファイルのパス
+    static std::wstring GetCookedPath(const std::wstring& sourcePath, const SceneVertexType& vertex);
+
+    // 新しい変換済みのファイルがあれば、そこからモデルを作る。なければ nullptr
+    static std::shared_ptr<GltfModelAsset> Load(const std::wstring& sourcePath, const SceneVertexType& vertex);
+
+    // モデルを変換済みのファイルに書き出す
+    static bool Save(const GltfModelAsset& asset, const SceneVertexType& vertex);
+};
+
+} // namespace UniDx
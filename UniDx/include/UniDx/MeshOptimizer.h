@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+namespace UniDx
+{
+
+// 頂点キャッシュの効率
+struct VertexCacheStatistics
+{
+    size_t vertexCount = 0;         // インデックスから参照されている頂点の数
+    size_t triangleCount = 0;
+    size_t transformedCount = 0;    // キャッシュに無く、頂点シェーダを実行した回数
+    float acmr = 0.0f;              // 三角形あたりの頂点シェーダの実行回数（0.5 に近いほど良い）
+    float atvr = 0.0f;              // 頂点あたりの頂点シェーダの実行回数（1.0 に近いほど良い）
+};
+
+
+// --------------------
+// MeshOptimizer
+//
+// 三角形リストのインデックスと頂点を GPU で効率よく描けるように並べ替える
+// 1. 頂点キャッシュ（Tipsify）: 変換済みの頂点を使い回せるように三角形を並べる
+// 2. オーバードロー: キャッシュの効率を大きく落とさない範囲で三角形をまとめ、外を向いたまとまりから描く
+// 3. 頂点フェッチ: インデックスで最初に使われる順に頂点を並べ替え、使われない頂点を除く
+// どれも CPU だけで動くので、ヘッドレスでも使える
+// --------------------
+class MeshOptimizer
+{
+public:
+    // シミュレーションする頂点キャッシュの大きさ（FIFO）
+    static constexpr int DefaultCacheSize = 16;
+
+    // オーバードローの並べ替えで許す ACMR の悪化の割合
+    static constexpr float DefaultOverdrawThreshold = 1.05f;
+
+    // サブメッシュに 1～3 をすべてかける。マップしたファイルを参照している属性はコピーしてから並べ替える
+    static void Optimize(OwnedSubMesh& sub);
+
+    // 頂点キャッシュの効率が良くなるように三角形を並べ替える
+    static void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, int cacheSize = DefaultCacheSize);
+
+    // OptimizeVertexCache 済みのインデックスを、手前にきやすい三角形から描くように並べ替える
+    static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vector3> positions,
+        float threshold = DefaultOverdrawThreshold, int cacheSize = DefaultCacheSize);
+
+    // 頂点をインデックスで使われる順に並べ替える。並べ替えた後の頂点の数を返す
+    static size_t OptimizeVertexFetch(OwnedSubMesh& sub);
+
+    // FIFO の頂点キャッシュで描いたときの効率を求める
+    static VertexCacheStatistics AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+        int cacheSize = DefaultCacheSize);
+
+    // true にすると glTF の読み込みで Optimize をかける（読み込む前に設定する）
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+};
+
+} // namespace UniDx
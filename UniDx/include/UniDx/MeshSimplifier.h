@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include "Mesh.h"
+
+namespace UniDx
+{
+
+// --------------------
+// MeshSimplifier
+//
+// 二次誤差（Garland & Heckbert 1997 "Surface Simplification Using Quadric Error Metrics"）で
+// 誤差の小さい辺から潰して、三角形リストの三角形を減らす
+// 頂点は元のものから選ぶので、簡略化したメッシュは元の頂点バッファをそのまま使え、インデックスだけが変わる
+// 同じ位置に UV や法線の違う頂点がある継ぎ目は、継ぎ目に沿ってだけ潰し、開いた縁の頂点は動かさない
+// --------------------
+class MeshSimplifier
+{
+public:
+    // LOD を作るときの、ひとつ粗くするごとのインデックスの数の割合
+    static constexpr float DefaultLODRatio = 0.5f;
+
+    // LOD を作るときに許す誤差（メッシュの大きさに対する割合）
+    static constexpr float DefaultLODError = 0.05f;
+
+    // インデックスが targetIndexCount 個以下になるまで簡略化したインデックスを返す
+    // 誤差（メッシュの大きさに対する割合）が targetError を超える辺は潰さない
+    // resultError には潰した辺のうち最大の誤差が入る
+    static std::vector<uint32_t> Simplify(std::span<const uint32_t> indices, std::span<const Vector3> positions,
+        size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+    // サブメッシュに levelCount 段までの LOD を追加する
+    // 段ごとに三角形を ratio 倍に減らし、あまり減らなくなったらそこで止める
+    static void GenerateLODs(OwnedSubMesh& sub, int levelCount,
+        float ratio = DefaultLODRatio, float targetError = DefaultLODError);
+
+    // glTF の読み込みで作る LOD の段数（既定は 0 で作らない。読み込む前に設定する）
+    static void setImportLODCount(int count);
+    static int getImportLODCount();
+};
+
+} // namespace UniDx
@@ -16,6 +16,10 @@ public:
 
     ReadOnlyProperty<wstring_view> name;
 
+    // シーンの構築中（SceneArena::Scope の間）はシーンのアリーナから確保する
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
     Object(ReadOnlyProperty<wstring_view>::Getter nameGet) : name(nameGet) {}
 };
 
@@ -106,9 +106,17 @@ public:
     void addTrigger(Collider* other) { triggersNew_.push_back(other); }
     void collideCallback();
 
+    // ワールド空間における空間境界を取得
+    // Rigidbodyのないコライダーは Transform の変更バージョンかコライダーの形が変わったときだけ再計算する
+    Bounds getBounds();
+
 private:
     Collider* collider_;
 
+    Bounds bounds_;
+    Bounds shapeBounds_;
+    uint64_t boundsVersion_ = 0;
+
     std::vector<Collision> collisions_;
     std::vector<Collision> collisionsNew_;
     std::vector<Collider*> triggers_;
@@ -138,14 +146,11 @@ public:
         RaycastHit* hitInfo = nullptr, std::function<bool(const Collider*)> filter = nullptr);
 
 private:
+    // 当たりそうなペアや接触情報は固定時間更新ごとに作り直すので、FrameMemory::fixedStep() に置く
     struct PotentialPair {
         PhysicsShape* a;
         PhysicsShape* b;
     };
-    std::vector<PotentialPair> potentialPairs;
-    std::vector<PotentialPair> potentialPairsTrigger;
-
-    std::vector<ContactManifold> manifolds;
 
     std::map<Rigidbody*, PhysicsActor> physicsActors;
     std::vector<PhysicsShape> physicsShapes;
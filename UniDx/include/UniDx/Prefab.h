@@ -0,0 +1,75 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include <SimpleMath.h>
+
+#include "UniDxDefine.h"
+
+namespace UniDx
+{
+
+class GameObject;
+class Transform;
+
+// --------------------
+// Prefab
+//
+// GameObject を作る関数を持ち、Instantiate() で何度でも同じものを作る
+// プールを使うと、Destroy() されたインスタンスを解放せずに非アクティブにして保持し、
+// 次の Instantiate() ではメモリを確保せずに再利用する
+//
+//  auto bullet = std::make_shared<Prefab>([]() {
+//      return std::make_unique<GameObject>(L"弾", ...);
+//  }, 64);
+//  GameObject* b = Instantiate(bullet, position, rotation);
+//  Destroy(b, 2.0f);
+// --------------------
+class Prefab : public std::enable_shared_from_this<Prefab>
+{
+public:
+    using Factory = std::function<unique_ptr<GameObject>()>;
+
+    // poolCapacity が 0 より大きければ、その数までインスタンスをプールに保持する
+    explicit Prefab(Factory factory, size_t poolCapacity = 0);
+    ~Prefab();
+
+    void setPoolCapacity(size_t capacity);
+    size_t getPoolCapacity() const { return poolCapacity_; }
+
+    // プールで待機しているインスタンスの数
+    size_t getPooledCount() const { return pool_.size(); }
+
+    // プールにあらかじめインスタンスを作っておく
+    void Prewarm(size_t count);
+
+private:
+    friend class SceneManager;
+    friend GameObject* Instantiate(const std::shared_ptr<Prefab>&, const Vector3&, const Quaternion&, Transform*);
+
+    Factory factory_;
+    size_t poolCapacity_;
+    std::vector<unique_ptr<GameObject>> pool_;
+
+    // プールから取り出すか、新しく作る
+    unique_ptr<GameObject> create(bool& fromPool);
+
+    // プールに戻す。戻せたら true
+    bool release(unique_ptr<GameObject>& object);
+};
+
+
+// プレハブからインスタンスを作る
+// position と rotation は parent があれば parent からの相対
+// シーンへの追加はフレームの終わりに行われ、そのときに Awake() が呼ばれる
+GameObject* Instantiate(const std::shared_ptr<Prefab>& prefab, const Vector3& position, const Quaternion& rotation, Transform* parent = nullptr);
+
+// 作った GameObject をシーンに追加する（フレームの終わりに追加される）
+GameObject* Instantiate(unique_ptr<GameObject> object, Transform* parent = nullptr);
+
+// delay 秒後（Time::time）のフレームの終わりに GameObject を破棄する
+// プールを使うプレハブから作ったものは、破棄せずにプールに戻す
+void Destroy(GameObject* object, float delay = 0.0f);
+
+} // namespace UniDx
@@ -39,12 +39,19 @@ public:
     void setCreateBudderType()
     {
         createBufer_ = [](SubMesh* submesh) { submesh->createBuffer<TVertex>(); };
+        vertexLayout_ = TVertex::layout.data();
     }
 
+    virtual void createMesh() override;
+
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
 protected:
     virtual void OnEnable() override;
 
     std::function<void(SubMesh*)> createBufer_;
+    const D3D11_INPUT_ELEMENT_DESC* vertexLayout_ = nullptr;   // シーンファイルに頂点の型を記録するため
 };
 
 
@@ -82,8 +89,14 @@ public:
     void setCreateBudderType()
     {
         createBufer_ = [](SubMesh* submesh) { submesh->createBuffer<TVertex>(); };
+        vertexLayout_ = TVertex::layout.data();
     }
 
+    virtual void createMesh() override;
+
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
 protected:
     static std::vector<Vector3> positions;
     static std::vector<Vector3> normals;
@@ -94,6 +107,7 @@ protected:
     virtual void OnEnable() override;
 
     std::function<void(SubMesh*)> createBufer_;
+    const D3D11_INPUT_ELEMENT_DESC* vertexLayout_ = nullptr;   // シーンファイルに頂点の型を記録するため
 };
 
 
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <string>
+#include <cstdint>
+
+//
+// CPUプロファイラ
+//
+// UNIDX_PROFILE_SCOPE("名前") でスコープの開始から終了までを計測する
+// 計測結果はスレッドごとのリングバッファに書き込まれ、Chrome / Perfetto のトレース形式で出力できる
+// UNIDX_DISABLE_PROFILER を定義するとマーカーはすべてコンパイルされなくなる
+//
+namespace UniDx
+{
+
+// --------------------
+// Profiler
+// --------------------
+class Profiler
+{
+public:
+    // 1スレッドあたりに保持するイベント数（古いものから上書きされる）
+    static constexpr size_t EventCapacity = 1 << 17;
+
+    // 計測を開始する
+    // durationSeconds が正なら、その時間が経過した後の endFrame() で outputPath にトレースを書き出して終了する
+    static void BeginCapture(double durationSeconds = 0.0, const std::wstring& outputPath = L"trace.json");
+
+    // 計測を終了する
+    static void EndCapture();
+
+    // 計測中か
+    static bool isCapturing();
+
+    // 計測したイベントを Chrome トレース形式 (JSON) で書き出す
+    // リングバッファの上書きで失われたイベントの数は、スレッドごとの "dropped_events" と otherData.droppedEvents に入る
+    static bool WriteChromeTrace(const std::wstring& path);
+
+    // フレームの終わりに Engine から呼ばれる。時間指定の計測の終了を処理する
+    static void endFrame();
+
+    // 現在のスレッドの名前を設定（トレースビューアに表示される）
+    static void setThreadName(const char* name);
+
+    // マーカーの記録（ProfileScope から呼ばれる）
+    static uint64_t now();
+    static void record(const char* name, uint64_t begin, uint64_t end);
+};
+
+
+// --------------------
+// ProfileScope
+// 生成から破棄までの時間を記録する
+// --------------------
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name) : name_(name), begin_(Profiler::isCapturing() ? Profiler::now() : 0) {}
+    ~ProfileScope()
+    {
+        if (begin_ != 0)
+        {
+            Profiler::record(name_, begin_, Profiler::now());
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t begin_;
+};
+
+} // namespace UniDx
+
+
+#define UNIDX_PROFILE_CONCAT_INNER(a, b) a##b
+#define UNIDX_PROFILE_CONCAT(a, b) UNIDX_PROFILE_CONCAT_INNER(a, b)
+
+#ifndef UNIDX_DISABLE_PROFILER
+// name は文字列リテラルなど、トレースを書き出すまで有効な文字列を指定する
+#define UNIDX_PROFILE_SCOPE(name) ::UniDx::ProfileScope UNIDX_PROFILE_CONCAT(unidxProfileScope_, __LINE__)(name)
+#define UNIDX_PROFILE_FUNCTION() UNIDX_PROFILE_SCOPE(__FUNCTION__)
+#else
+#define UNIDX_PROFILE_SCOPE(name) ((void)0)
+#define UNIDX_PROFILE_FUNCTION() ((void)0)
+#endif
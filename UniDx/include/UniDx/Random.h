@@ -12,9 +12,10 @@ class Random
 {
 public:
     // シングルトン的に使う場合のグローバルインスタンス
+    // 複数のエンジンを別スレッドで動かせるようにスレッドごとに持つ
     static Random& global()
     {
-        static Random inst;
+        static thread_local Random inst;
         return inst;
     }
 
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <Keyboard.h>
+
+#include "Behaviour.h"
+
+
+namespace UniDx
+{
+
+class TextMesh;
+
+// --------------------
+// RenderStatsViewクラス
+// 同じ GameObject の TextMesh に前フレームの描画の統計を表示する
+// toggleKey で表示を切り替える。最初は隠しておく
+// --------------------
+class RenderStatsView : public Behaviour
+{
+public:
+    DirectX::Keyboard::Keys toggleKey = DirectX::Keyboard::F3;
+    bool visible = isVisibleByDefault();
+
+    // 新しく作る RenderStatsView を最初から表示するか（既定は隠す）
+    static void setVisibleByDefault(bool visible);
+    static bool isVisibleByDefault();
+
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
+protected:
+    virtual void Start() override;
+    virtual void LateUpdate() override;
+
+private:
+    TextMesh* textMesh = nullptr;
+};
+
+} // namespace UniDx
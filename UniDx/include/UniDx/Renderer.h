@@ -11,12 +11,14 @@
 #include "Texture.h"
 #include "Material.h"
 #include "ConstantBuffer.h"
+#include "AssetDatabase.h"
 
 
 namespace UniDx {
 
 class Camera;
 class Material;
+class LODGroup;
 
 
 // --------------------
@@ -52,10 +54,11 @@ public:
     {
         AddMaterial<TVertex>(shaderPath);
 
-        // テクスチャを読み込んでマテリアルに追加
-        std::unique_ptr<Texture> t = std::make_unique<Texture>();
-        t->Load(textuePath);
-        materials.back()->AddTexture(std::move(t));
+        // テクスチャを読み込んでマテリアルに追加（読み込み済みなら共有）
+        if (auto t = AssetDatabase::getInstance()->LoadTexture(textuePath))
+        {
+            materials.back()->AddTexture(std::move(t));
+        }
     }
 
 protected:
@@ -64,6 +67,10 @@ protected:
     virtual void OnEnable() override;
     virtual void updatePositionCameraCBuffer(const UniDx::Camera& camera) const;
     virtual bool setMaterialForRender() const;
+
+    // materials をシーンファイルに書き出す・読み込む
+    void serializeMaterials(SceneWriter& writer) const;
+    void deserializeMaterials(SceneReader& reader);
 };
 
 
@@ -75,8 +82,21 @@ class MeshRenderer : public Renderer
 public:
     Mesh mesh;
 
+    // 描画するサブメッシュの LOD（0 が元のメッシュ）。LODGroup があればフレームごとに設定される
+    int lodLevel = 0;
+
+    ~MeshRenderer();
+
+    // mesh の頂点データだけを用意する（GPU のバッファは作らない）
+    // 有効になる前にメッシュを読むとき（StaticBatching など）に呼ぶ
+    virtual void createMesh() {}
+
     // メッシュを使って描画
     virtual void Render(const Camera& camera) const override;
+
+private:
+    friend class LODGroup;
+    LODGroup* lodGroup_ = nullptr;  // この Renderer の LOD を選んでいる LODGroup
 };
 
 
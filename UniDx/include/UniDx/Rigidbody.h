@@ -6,6 +6,7 @@
 #include "Physics.h"
 #include "Bounds.h"
 #include "Debug.h"
+#include "SceneSerializer.h"
 
 
 namespace UniDx {
@@ -63,6 +64,22 @@ public:
         Physics::getInstance()->unregisterRigidbody(this);
     }
 
+    virtual void Serialize(SceneWriter& writer) const override
+    {
+        writer.write(linearVelocity);
+        writer.write(gravityScale);
+        writer.write(mass);
+        writer.write(isKinematic);
+    }
+
+    virtual void Deserialize(SceneReader& reader) override
+    {
+        reader.read(linearVelocity);
+        reader.read(gravityScale);
+        reader.read(mass);
+        reader.read(isKinematic);
+    }
+
     // 指定位置に移動。補間が有効な場合は間の衝突判定を行う。
     void MovePosition(Vector3 pos)
     {
@@ -1,9 +1,11 @@
 ﻿#pragma once
 
 #include <memory>
+#include <vector>
 
 #include "UniDxDefine.h"
 #include "Singleton.h"
+#include "SceneArena.h"
 
 namespace UniDx
 {
@@ -24,7 +26,51 @@ public:
 
     const GameObjectContainer& GetRootGameObjects() { return routeGameObjects; }
 
+    // ルートにGameObjectを追加
+    void AddRootGameObject(unique_ptr<GameObject> obj) { routeGameObjects.push_back(std::move(obj)); }
+
+    // ルートからGameObjectを外して所有権を取り出す
+    unique_ptr<GameObject> ReleaseRootGameObject(GameObject* obj)
+    {
+        for (auto it = routeGameObjects.begin(); it != routeGameObjects.end(); ++it)
+        {
+            if (it->get() == obj)
+            {
+                unique_ptr<GameObject> result = std::move(*it);
+                routeGameObjects.erase(it);
+                return result;
+            }
+        }
+        return nullptr;
+    }
+
+    // ルートの GameObject をすべて別のシーンに移す
+    void MoveRootGameObjects(Scene& destination)
+    {
+        for (auto& obj : routeGameObjects)
+        {
+            destination.routeGameObjects.push_back(std::move(obj));
+        }
+        routeGameObjects.clear();
+    }
+
+    // シーンの構築に使ったアリーナ。GameObject をすべて破棄した後に解放される
+    void setArena(std::unique_ptr<SceneArena> arena) { arena_ = std::move(arena); }
+    SceneArena* getArena() const { return arena_.get(); }
+
+    // 加算読み込みしたシーンのアリーナ。追加された GameObject と一緒に保持する
+    void addArena(std::unique_ptr<SceneArena> arena)
+    {
+        if (arena != nullptr)
+        {
+            additiveArenas_.push_back(std::move(arena));
+        }
+    }
+
 protected:
+    // routeGameObjects より先に宣言して、後に破棄されるようにする
+    std::unique_ptr<SceneArena> arena_;
+    std::vector<std::unique_ptr<SceneArena>> additiveArenas_;
     GameObjectContainer routeGameObjects;
 
     // ヘルパー関数でパック展開
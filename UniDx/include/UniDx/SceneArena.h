@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace UniDx
+{
+
+// --------------------
+// SceneArena
+//
+// シーンの構築中に作られる Object（GameObject とコンポーネント）をまとめて確保する領域
+// Scope で現在のアリーナにしている間の Object の new はここから切り出され、
+// 連続したメモリに詰めて置かれる
+// delete では解放せず、アリーナの破棄でチャンクごとまとめて解放する
+// アリーナより長く生きる Object（プールに保持されているものなど）のあるチャンクは、
+// その Object がすべて破棄されたときに解放する
+// --------------------
+class SceneArena
+{
+public:
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    SceneArena() = default;
+    ~SceneArena();
+
+    SceneArena(const SceneArena&) = delete;
+    SceneArena& operator=(const SceneArena&) = delete;
+
+    // Object 用に size バイトを切り出す
+    void* allocate(size_t size);
+
+    // allocate() で確保したものを破棄済みにする
+    // アリーナが先に破棄されていてもよい
+    static void deallocate(void* p);
+
+    // 確保したバイト数
+    size_t getUsedBytes() const { return usedBytes_; }
+
+    // 破棄されていない Object の数
+    size_t getLiveCount() const { return liveCount_; }
+
+    size_t getChunkCount() const { return chunks_.size(); }
+
+    // 現在のスレッドで使うアリーナ（なければ nullptr）
+    static SceneArena* current();
+
+    // false にするとアリーナを使わず通常のヒープから確保する（比較用）
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // --------------------
+    // Scope
+    // 生存期間の間、現在のスレッドのアリーナを切り替える
+    // --------------------
+    class Scope
+    {
+    public:
+        explicit Scope(SceneArena* arena);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        SceneArena* prev_;
+    };
+
+private:
+    std::vector<std::byte*> chunks_;
+    std::byte* currentChunk_ = nullptr;
+    std::byte* cursor_ = nullptr;
+    size_t remaining_ = 0;
+    size_t usedBytes_ = 0;
+    size_t liveCount_ = 0;
+};
+
+} // namespace UniDx
@@ -1,10 +1,13 @@
 ﻿#pragma once
 
 #include <memory>
+#include <vector>
+#include <deque>
 
 #include "Singleton.h"
 #include "Scene.h"
 #include "Material.h"
+#include "AsyncOperation.h"
 
 
 std::unique_ptr<UniDx::Scene> CreateDefaultScene();
@@ -14,18 +17,116 @@ namespace UniDx
 {
 
 class Scene;
+class GameObject;
+class Transform;
+class SceneLoader;
 
 // シーンマネージャ
 class SceneManager : public Singleton<SceneManager>
 {
 public:
+    virtual ~SceneManager();
+
+    // シーンを作る。構築中に作られた Object はシーンのアリーナに置かれる
+    // シーンファイルが指定されていればそこから読み込み、なければ CreateDefaultScene() で作る
     void createScene();
 
+    // createScene() で読み込むシーンファイル（プロセスで共通。エンジンの初期化前に設定する）
+    // saveFile を指定すると、CreateDefaultScene() で作ったシーンをそこに書き出す
+    static void setSceneFile(const std::wstring& sceneFile, const std::wstring& saveFile = L"");
+
     Scene* GetActiveScene() { return activeScene.get(); }
 
+    // 最後の createScene() にかかった時間（ミリ秒）
+    double getBuildMilliseconds() const { return buildMilliseconds_; }
+
+    // 今のシーンを破棄して、かかった時間（ミリ秒）を返す
+    double destroyScene();
+
+    // シーンファイルを非同期に読み込む
+    // ファイルの読み込み、画像のデコード、シェーダーのコンパイルはワーカースレッドで行い、
+    // GPU リソースと GameObject の作成はフレームの終わりに loadingBudget ずつメインスレッドで進める
+    // 読み込みが終わると、mode に従って今のシーンを置き換えるか、今のシーンに追加する
+    // 複数の読み込みは要求した順に有効になる
+    std::shared_ptr<AsyncOperation> LoadSceneAsync(const std::wstring& path, LoadSceneMode mode = LoadSceneMode_Single);
+
+    // 非同期読み込みでメインスレッドが1フレームに使う時間（ミリ秒）
+    void setLoadingBudget(double milliseconds) { loadingBudget_ = milliseconds; }
+    double getLoadingBudget() const { return loadingBudget_; }
+
+    // 読み込み中のシーンがあるか
+    bool isLoading() const { return !loading_.empty(); }
+
+    // 非同期読み込みを進める（Engine からフレームの終わりに呼ばれる）
+    // 有効になったシーンのルートの GameObject を返す
+    const std::vector<GameObject*>& updateLoading();
+
+    // シーンへの追加を予約する（Instantiate() から呼ばれる）
+    // activate が true なら追加するときにアクティブにする
+    GameObject* instantiate(std::unique_ptr<GameObject> object, Transform* parent, bool activate);
+
+    // 破棄を予約する（Destroy() から呼ばれる）
+    void destroy(GameObject* object, float delay);
+
+    // 破棄の予約を取り消す（予約済みの GameObject が先に破棄されたとき）
+    void cancelDestroy(GameObject* object);
+
+    // 予約された追加をシーンに反映し、追加した GameObject を返す
+    const std::vector<GameObject*>& flushInstantiated();
+
+    // time までに予約された破棄をまとめて行う
+    void flushDestroyed(float time);
+
 protected:
     std::unique_ptr<Scene> activeScene;
+
+    static inline std::wstring sceneFile_;
+    static inline std::wstring saveFile_;
 //    std::unique_ptr<Material> defaultMaterial;
+
+private:
+    struct PendingAdd
+    {
+        std::unique_ptr<GameObject> object;
+        Transform* parent;
+        bool activate;
+    };
+
+    struct PendingDestroy
+    {
+        GameObject* object;
+        float time;
+    };
+
+    double buildMilliseconds_ = 0.0;
+
+    std::vector<PendingAdd> pendingAdds_;
+    std::vector<PendingAdd> addBatch_;
+    std::vector<GameObject*> added_;
+
+    std::vector<PendingDestroy> pendingDestroys_;
+    std::vector<GameObject*> dueObjects_;
+    std::vector<std::unique_ptr<GameObject>> destroyBatch_;
+
+    // 非同期読み込み
+    // ワーカーで動くジョブとは LoadJob を共有するので、途中でシーンマネージャが破棄されても安全
+    // GameObject はメインスレッドで scene に作り、arena は scene より後に破棄する
+    struct LoadJob;
+    struct LoadRequest
+    {
+        std::unique_ptr<SceneArena> arena;
+        std::unique_ptr<Scene> scene;
+        std::shared_ptr<LoadJob> job;
+        std::shared_ptr<AsyncOperation> operation;
+        LoadSceneMode mode;
+        bool built;     // GameObject を作り終えて、有効になるのを待っている
+    };
+
+    std::deque<LoadRequest> loading_;
+    std::vector<GameObject*> activated_;
+    double loadingBudget_ = 2.0;
+
+    void activate(LoadRequest& request);
 };
 
 }
\ No newline at end of file
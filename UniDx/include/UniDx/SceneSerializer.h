@@ -0,0 +1,393 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <d3d11.h>
+
+#include "UniDxDefine.h"
+#include "Mesh.h"
+#include "MappedFile.h"
+
+namespace UniDx
+{
+
+class Object;
+class Component;
+class GameObject;
+class Scene;
+class Texture;
+class Material;
+class Font;
+class GltfModelAsset;
+
+//
+// シーンファイルの形式
+//
+// ヘッダ、各テーブル、文字列、データの順に並ぶ。オフセットはファイル先頭からのバイト数
+// GameObject は親が子より先に来る順（深さ優先）で並び、parent は GameObject テーブルの番号
+// コンポーネントとアセットのフィールドはデータ領域に置かれ、参照はテーブルの番号で表す
+// テクスチャはミップマップまで作った DDS を、マテリアルはシェーダーのバイトコードを書き出したときに焼き込む
+// 元の画像やシェーダーを書き換えたら、シーンを書き出し直す
+//
+namespace SceneFile
+{
+    constexpr uint32_t Magic = 'U' | ('D' << 8) | ('X' << 16) | ('S' << 24);
+    constexpr uint16_t Version = 2;
+    constexpr uint32_t NullIndex = 0xffffffff;
+
+    enum AssetType : uint32_t
+    {
+        AssetType_Texture = 1,
+        AssetType_Material = 2,
+        AssetType_Font = 3,
+    };
+
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t charSize;          // 文字列の1文字のバイト数（sizeof(wchar_t)）
+        uint32_t objectCount;
+        uint32_t componentCount;
+        uint32_t assetCount;
+        uint32_t stringCount;
+        uint32_t objectOffset;
+        uint32_t componentOffset;
+        uint32_t assetOffset;
+        uint32_t stringOffset;
+        uint32_t charOffset;
+        uint32_t dataOffset;
+        uint32_t fileSize;
+    };
+
+    struct ObjectRecord
+    {
+        uint32_t parent;            // NullIndex ならシーンのルート
+        uint32_t name;              // 文字列の番号
+        uint32_t firstComponent;
+        uint32_t componentCount;
+        uint32_t active;
+        Vector3 localPosition;
+        Quaternion localRotation;
+        Vector3 localScale;
+    };
+
+    struct ComponentRecord
+    {
+        uint32_t type;              // 型名の文字列の番号
+        uint32_t enabled;
+        uint32_t dataOffset;        // データ領域の先頭からのバイト数
+        uint32_t dataSize;
+    };
+
+    struct AssetRecord
+    {
+        uint32_t type;
+        uint32_t dataOffset;
+        uint32_t dataSize;
+    };
+
+    struct StringRecord
+    {
+        uint32_t offset;            // 文字領域の先頭からの文字数
+        uint32_t length;
+    };
+}
+
+
+// --------------------
+// SceneVertexType
+// シーンファイルに名前で記録する頂点の型
+// --------------------
+struct SceneVertexType
+{
+    std::wstring name;
+    const D3D11_INPUT_ELEMENT_DESC* layout;
+    size_t layoutSize;
+    void (*createBuffer)(SubMesh* submesh);
+    void (*interleave)(SubMesh* submesh, std::vector<std::byte>& out);   // 頂点バッファに書き込む内容を作る
+
+    template<typename TVertex>
+    static SceneVertexType Create(const std::wstring& name)
+    {
+        return SceneVertexType{ name, TVertex::layout.data(), TVertex::layout.size(),
+            [](SubMesh* submesh) { submesh->createBuffer<TVertex>(); },
+            [](SubMesh* submesh, std::vector<std::byte>& out)
+            {
+                std::vector<TVertex> vertices(submesh->positions.size());
+                submesh->copyTo(std::span<TVertex>(vertices));
+                const std::byte* p = reinterpret_cast<const std::byte*>(vertices.data());
+                out.assign(p, p + vertices.size() * sizeof(TVertex));
+            } };
+    }
+};
+
+
+// --------------------
+// SceneWriter
+// Component::Serialize() でフィールドを書き出す
+// --------------------
+class SceneWriter
+{
+public:
+    // 値をそのまま書き出す
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        const std::byte* p = reinterpret_cast<const std::byte*>(&value);
+        data_.insert(data_.end(), p, p + sizeof(T));
+    }
+
+    void writeString(std::wstring_view s) { write(addString(s)); }
+
+    // バイト数に続けてそのまま書き出す
+    void writeBytes(const void* data, size_t size);
+
+    // アセットは最初に出てきたときにアセットテーブルに追加し、以降は番号で参照する
+    void writeTexture(const std::shared_ptr<Texture>& texture);
+    void writeMaterial(const std::shared_ptr<Material>& material);
+    void writeFont(const std::shared_ptr<Font>& font);
+
+    // 同じシーンの他のコンポーネントへの参照（読み込み時にポインタに戻す）
+    void writeReference(const Component* component);
+
+    // 頂点の型（SceneSerializer::registerVertex で登録したもの）
+    void writeVertexType(const D3D11_INPUT_ELEMENT_DESC* layout);
+
+    // この GameObject の子を書き出さない
+    // コンポーネントが読み込み時に作り直す子（glTF のノードなど）に使う
+    void excludeChild(const GameObject* child) { excluded_.insert(child); }
+
+private:
+    friend class SceneSerializer;
+
+    std::vector<SceneFile::ObjectRecord> objects_;
+    std::vector<SceneFile::ComponentRecord> components_;
+    std::vector<SceneFile::AssetRecord> assets_;
+    std::vector<SceneFile::StringRecord> strings_;
+    std::wstring chars_;
+    std::vector<std::byte> data_;       // コンポーネントのデータ
+    std::vector<std::byte> assetData_;  // アセットのデータ（ファイルではコンポーネントのデータの後ろ）
+
+    std::unordered_map<std::wstring, uint32_t> stringIndex_;
+    std::unordered_map<const Object*, uint32_t> assetIndex_;
+    std::unordered_map<const Component*, uint32_t> componentIndex_;
+    std::vector<std::pair<size_t, const Component*>> references_;
+    std::unordered_set<const GameObject*> excluded_;
+
+    uint32_t addString(std::wstring_view s);
+    uint32_t addAsset(const Object* asset, SceneFile::AssetType type, const std::function<void()>& writeFields);
+    void writeObject(GameObject* object, uint32_t parent);
+    bool resolveReferences();
+};
+
+
+// --------------------
+// SceneReader
+// Component::Deserialize() でフィールドを読み込む
+// 書き出したときと同じ順番で読むこと
+// --------------------
+class SceneReader
+{
+public:
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+        T value{};
+        if (cursor_ + sizeof(T) > end_)
+        {
+            failed_ = true;
+            return value;
+        }
+        std::memcpy(&value, cursor_, sizeof(T));
+        cursor_ += sizeof(T);
+        return value;
+    }
+
+    template<typename T>
+    void read(T& value) { value = read<T>(); }
+
+    // ファイルの中の文字列を指す。読み込みが終わるまで有効なので、保持するならコピーする
+    std::wstring_view readString() { return getString(read<uint32_t>()); }
+
+    // writeBytes() で書いたもの。ファイルの中を指すので、読み込みが終わるまで有効
+    std::span<const std::byte> readBytes();
+
+    std::shared_ptr<Texture> readTexture();
+    std::shared_ptr<Material> readMaterial();
+    std::shared_ptr<Font> readFont();
+
+    // 参照はすべての GameObject を作った後に設定される（型が違えば nullptr）
+    template<typename T>
+    void readReference(T*& target)
+    {
+        target = nullptr;
+        uint32_t index = read<uint32_t>();
+        if (index != SceneFile::NullIndex)
+        {
+            fixups_.push_back({ index, [&target](Component* c) { target = dynamic_cast<T*>(c); } });
+        }
+    }
+
+    // 登録されていない型なら nullptr
+    const SceneVertexType* readVertexType();
+
+    // glTF モデルを読み込む
+    // SceneLoader::prepare() でデコードしておいたものがあれば、頂点バッファを作るだけにする
+    std::shared_ptr<const GltfModelAsset> loadModel(const std::wstring& path, const SceneVertexType& vertex);
+
+    // 範囲外を読もうとしたか
+    bool hasFailed() const { return failed_; }
+
+private:
+    friend class SceneSerializer;
+    friend class SceneLoader;
+
+    struct Fixup
+    {
+        uint32_t index;
+        std::function<void(Component*)> apply;
+    };
+
+    struct PreparedModel
+    {
+        std::wstring path;
+        const SceneVertexType* vertex;
+        std::shared_ptr<GltfModelAsset> asset;
+    };
+
+    const std::byte* file_ = nullptr;
+    const SceneFile::Header* header_ = nullptr;
+    const std::byte* cursor_ = nullptr;
+    const std::byte* end_ = nullptr;
+    bool failed_ = false;
+
+    std::vector<std::shared_ptr<Object>> assets_;
+    std::vector<Component*> components_;
+    std::vector<Fixup> fixups_;
+    std::vector<PreparedModel> models_;
+
+    std::wstring_view getString(uint32_t index) const;
+    std::shared_ptr<Object> getAsset(uint32_t index, SceneFile::AssetType type) const;
+    void setRange(uint32_t offset, uint32_t size);
+};
+
+
+// --------------------
+// SceneLoader
+//
+// シーンファイルの読み込みを段階に分けて行う
+//   prepare()       : ファイルのマップ、焼き込んだ画像とバイトコードの取り出し（なければデコードとコンパイル）、
+//                     フォントの読み込み、glTF モデルの解析とデコード
+//                     GPU もシーンも使わないので、ワーカースレッドで行える
+//   createAssets()  : デコードしたものから GPU のリソースを作る
+//   createObjects() : GameObject とコンポーネントを作ってシーンに追加する
+//   finish()        : コンポーネント間の参照を解決する
+// createAssets() 以降はメインスレッドで呼ぶ
+// 期限までに終わらなければ false を返すので、次のフレームで続きを呼ぶ（少なくともひとつは進める）
+// --------------------
+class SceneLoader
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SceneLoader(const std::wstring& path);
+    ~SceneLoader();
+
+    SceneLoader(const SceneLoader&) = delete;
+    SceneLoader& operator=(const SceneLoader&) = delete;
+
+    // decode が false なら画像のデコードなどを行わない（ヘッドレスモード用）
+    // ワーカースレッドでは D3DManager を参照できないので、呼び出す側で決める
+    bool prepare(bool decode);
+
+    bool createAssets(Clock::time_point deadline);
+    bool createObjects(Scene* scene, Clock::time_point deadline);
+
+    // 失敗していたら false
+    bool finish();
+
+    const std::wstring& getPath() const { return path_; }
+    bool hasFailed() const { return failed_; }
+
+    // 進み具合（0～1）。prepare() の実行中に別のスレッドから呼んでもよい
+    float getProgress() const;
+
+private:
+    struct PreparedAsset;
+
+    std::wstring path_;
+    Clock::time_point start_;
+    MappedFile file_;
+    SceneFile::Header header_{};
+    SceneReader reader_;
+    bool failed_ = false;
+
+    std::unique_ptr<PreparedAsset[]> prepared_;
+    std::atomic<uint32_t> assetTotal_ = 0;
+    std::atomic<uint32_t> objectTotal_ = 0;
+    std::atomic<uint32_t> preparedCount_ = 0;
+    std::atomic<uint32_t> modelTotal_ = 0;
+    std::atomic<uint32_t> preparedModelCount_ = 0;
+
+    uint32_t assetCursor_ = 0;
+    uint32_t objectCursor_ = 0;
+    std::vector<GameObject*> objects_;
+
+    void prepareModels();
+};
+
+
+// --------------------
+// SceneSerializer
+//
+// シーンをバイナリ形式で保存・読み込みする
+// 書き出せるのは registerComponent で登録した型のコンポーネントだけで、登録されていないものは飛ばす
+// Transform は GameObject のレコードに含まれる
+// 読み込みはファイルをメモリにマップし、テーブルの順に GameObject とコンポーネントを作る
+// --------------------
+class SceneSerializer
+{
+public:
+    using Factory = std::unique_ptr<Component>(*)();
+
+    // シーンを書き出す
+    static bool Save(Scene* scene, const std::wstring& path);
+
+    // シーンを読み込む。失敗したら nullptr
+    static std::unique_ptr<Scene> Load(const std::wstring& path);
+
+    // コンポーネントの型を名前で登録する
+    template<typename T>
+    static void registerComponent(const std::wstring& name)
+    {
+        registerComponent(typeid(T), name, []() -> std::unique_ptr<Component> { return std::make_unique<T>(); });
+    }
+    static void registerComponent(const std::type_info& type, const std::wstring& name, Factory factory);
+
+    // 頂点の型を名前で登録する
+    template<typename TVertex>
+    static void registerVertex(const std::wstring& name)
+    {
+        registerVertex(SceneVertexType::Create<TVertex>(name));
+    }
+    static void registerVertex(const SceneVertexType& vertex);
+
+    static const SceneVertexType* findVertex(const D3D11_INPUT_ELEMENT_DESC* layout);
+    static const SceneVertexType* findVertex(std::wstring_view name);
+};
+
+} // namespace UniDx
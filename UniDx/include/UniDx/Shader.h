@@ -3,6 +3,8 @@
 // C++のSTL
 #include <string>
 #include <array>
+#include <span>
+#include <memory>
 
 // Direct3Dの型・クラス・関数など
 #include <d3d11.h>
@@ -131,6 +133,24 @@ struct VertexPNC
 // ----------------------------------------------------------
 // Shaderクラス
 // ----------------------------------------------------------
+// コンパイル済みのシェーダー
+struct ShaderBytecode
+{
+	ComPtr<ID3DBlob> vertex;
+	ComPtr<ID3DBlob> pixel;
+};
+
+
+// バイトコードから作った D3D のオブジェクト
+// 同じファイルと頂点レイアウトの Shader で共有する（AssetDatabase）
+struct ShaderProgram
+{
+	ComPtr<ID3D11VertexShader>	vertex;		// 頂点シェーダー
+	ComPtr<ID3D11PixelShader>	pixel;		// ピクセルシェーダー
+	ComPtr<ID3D11InputLayout>	inputLayout;// 入力レイアウト
+};
+
+
 class Shader : public Object
 {
 public:
@@ -142,16 +162,28 @@ public:
 	template<typename TVertex>
 	bool compile(const std::wstring& filePath) { return compile(filePath, TVertex::layout.data(), TVertex::layout.size()); }
 
+	// シェーダーファイルをバイトコードにコンパイルする
+	// GPU を使わないので、ワーカースレッドから呼べる
+	static bool compileBytecode(const std::wstring& filePath, ShaderBytecode& bytecode);
+
+	// compileBytecode() したものからシェーダーを作る（メインスレッドで呼ぶ）
+	bool create(const std::wstring& filePath, const ShaderBytecode& bytecode, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size);
+
+	// コンパイルしたときに指定したパスと頂点レイアウト
+	const wstring& getFilePath() const { return filePath; }
+	std::span<const D3D11_INPUT_ELEMENT_DESC> getInputLayout() const { return std::span<const D3D11_INPUT_ELEMENT_DESC>(layout, layoutSize); }
+
 	// 描画のため、D3DDeviceContextにこのシェーダーをセット
 	void setToContext() const;
 
 protected:
 	wstring fileName;
+	wstring filePath;
+	const D3D11_INPUT_ELEMENT_DESC* layout = nullptr;	// TVertex::layout など、寿命の長いものを指す
+	size_t layoutSize = 0;
 
 private:
-	ComPtr<ID3D11VertexShader>	m_vertex = nullptr;	// 頂点シェーダー
-	ComPtr<ID3D11PixelShader>	m_pixel = nullptr;	// ピクセルシェーダー
-	ComPtr<ID3D11InputLayout>	m_inputLayout = nullptr;// 入力レイアウト
+	std::shared_ptr<const ShaderProgram> program_;
 };
 
 }
\ No newline at end of file
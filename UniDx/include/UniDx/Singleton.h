@@ -3,45 +3,85 @@
 #include <memory>
 #include <assert.h>
 #include "UniDxDefine.h"
+#include "EngineContext.h"
 
 namespace UniDx
 {
 
+// VOg̗L͈
+enum SingletonScope
+{
+    SingletonScope_Context, // EngineContext ƂɂЂƂ
+    SingletonScope_Process  // vZXŜłЂƂ
+};
+
 // --------------------
 // Singleton
 //
 // Ɣj̃^C~O𐧌䂵A
 // ̃NX create ł悤ɂ邽
 // I create  destroy Kv
+//
+// CX^X݂͌̃Xbh EngineContext Ƃɕێ
+// SingletonScope_Process w肵̂̓vZXłЂƂ
 // --------------------
-template<class T>
-class Singleton
+template<class T, SingletonScope Scope = SingletonScope_Context>
+class Singleton : public SingletonBase
 {
 public:
     // CX^X̎擾
-    static T* getInstance() { return instance_.get(); }
+    static T* getInstance()
+    {
+        if constexpr (Scope == SingletonScope_Process)
+        {
+            return instance_.get();
+        }
+        else
+        {
+            return static_cast<T*>(EngineContext::current()->getSlot(slot()));
+        }
+    }
 
     // ̃NXCX^XƂč쐬
     static void create()
     {
-		assert(instance_ == nullptr);
-        instance_ = std::make_unique<T>();
+		assert(getInstance() == nullptr);
+        if constexpr (Scope == SingletonScope_Process)
+        {
+            instance_ = std::make_unique<T>();
+        }
+        else
+        {
+            EngineContext::current()->setSlot(slot(), std::make_unique<T>());
+        }
     }
 
     // CX^X̔j
 	static void destroy()
 	{
-		instance_ = nullptr;
+        if constexpr (Scope == SingletonScope_Process)
+        {
+            instance_ = nullptr;
+        }
+        else
+        {
+            EngineContext::current()->setSlot(slot(), nullptr);
+        }
 	}
 
 protected:
     Singleton() {}
     virtual ~Singleton() {}
 
-    static unique_ptr<T> instance_;
-};
+    static inline unique_ptr<T> instance_;
 
-template<class T>
-inline std::unique_ptr<T> Singleton<T>::instance_ = nullptr;
+private:
+    // EngineContext ł̃NXgXbgԍ
+    static size_t slot()
+    {
+        static const size_t index = EngineContext::allocateSlot();
+        return index;
+    }
+};
 
 }
\ No newline at end of file
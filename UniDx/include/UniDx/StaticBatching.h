@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Renderer.h"
+#include "Bounds.h"
+
+namespace UniDx
+{
+
+class GameObject;
+
+
+// --------------------
+// StaticBatchRenderer
+//
+// 動かない MeshRenderer のメッシュを、姿勢を焼き込んでひとつの頂点・インデックスバッファにまとめて描く
+// メッシュは最初に有効になったときに sources から作る
+// まとめた範囲がカメラの視錐台の外にあれば描かない
+// --------------------
+class StaticBatchRenderer : public MeshRenderer
+{
+public:
+    // まとめる元の Renderer（StaticBatching::Combine で無効にしたもの）
+    // メッシュを作るときにだけ参照する
+    std::vector<MeshRenderer*> sources;
+
+    // まとめた範囲（このオブジェクトのローカル座標）
+    const Bounds& getBounds() const { return bounds_; }
+
+    virtual void Render(const Camera& camera) const override;
+
+    virtual void Serialize(SceneWriter& writer) const override;
+    virtual void Deserialize(SceneReader& reader) override;
+
+protected:
+    virtual void OnEnable() override;
+
+private:
+    Bounds bounds_;
+
+    void buildMesh();
+};
+
+
+// --------------------
+// StaticBatching
+//
+// 動かない GameObject の MeshRenderer を、マテリアルと空間のチャンクごとに StaticBatchRenderer にまとめる
+// まとめた元の Renderer は無効にするので、描画の回数はオブジェクトの数からチャンクの数になる
+// --------------------
+class StaticBatching
+{
+public:
+    static constexpr float DefaultChunkSize = 16.0f;
+
+    // objects と子の MeshRenderer をまとめ、batchRoot の子に StaticBatchRenderer を作る
+    // チャンクは batchRoot のローカル座標の XZ 平面を chunkSize 四方で区切り、Renderer の位置で振り分ける
+    // 作った StaticBatchRenderer の数を返す
+    static int Combine(std::span<GameObject* const> objects, GameObject* batchRoot, float chunkSize = DefaultChunkSize);
+
+    // 無効にすると Combine() は何もしない（描画の回数を比べる用）
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+};
+
+} // namespace UniDx
@@ -18,6 +18,9 @@ public:
 	virtual void Awake() override;
 	virtual void Render(const Matrix& proj) const;
 
+	virtual void Serialize(SceneWriter& writer) const override;
+	virtual void Deserialize(SceneReader& reader) override;
+
 	wstring          text;
 	shared_ptr<Font> font;
 
@@ -28,6 +28,16 @@ public:
     // 画像ファイルを読み込む
     bool Load(const std::wstring& filePath);
 
+    // 画像ファイルを読み込んでミップマップまで作る
+    // GPU を使わないので、ワーカースレッドから呼べる
+    static bool Decode(const std::wstring& filePath, DirectX::ScratchImage& image);
+
+    // Decode() した画像から GPU のリソースを作る（メインスレッドで呼ぶ）
+    bool Create(const std::wstring& filePath, const DirectX::ScratchImage& image);
+
+    // 読み込んだときに指定したパス
+    const wstring& getFilePath() const { return filePath; }
+
     void setForRender() const;
 
     D3D11_TEXTURE_ADDRESS_MODE wrapModeU;
@@ -36,6 +46,7 @@ public:
 protected:
     ComPtr<ID3D11SamplerState> samplerState;
     wstring fileName;
+    wstring filePath;
 
     // シェーダーリソースビュー(画像データ読み取りハンドル)
     ComPtr<ID3D11ShaderResourceView> m_srv = nullptr;
@@ -5,51 +5,74 @@
 namespace UniDx
 {
 
+// EngineContext ごとに保持する時間の状態
+struct TimeState
+{
+    int frameCount = 0;
+    float fixedDeltaTime = 0.01667f;
+    float time = 0.0f;
+    float timeScale = 1.0f;
+    float unscaledTime = 0.0f;
+    float unscaledDeltaTime = 0.0f;
+    double realDeltaTime = 0.0;
+};
+
+
 // Time情報
+// 値は現在のスレッドの EngineContext が持つ TimeState を参照する
 class Time
 {
+private:
+    // 現在のコンテキストの時間の状態
+    static TimeState& state();
+
 public:
-    static inline int frameCount = 0;
+    static inline ReadOnlyProperty<int> frameCount = ReadOnlyProperty<int>([]() { return state().frameCount; });
 
-    static inline float fixedDeltaTime = 0.01667f;
+    static inline Property<float> fixedDeltaTime = Property<float>(
+        []() { return state().fixedDeltaTime; },
+        [](const float& v) { state().fixedDeltaTime = v; });
 
-    static inline float time = 0.0f;
+    static inline ReadOnlyProperty<float> time = ReadOnlyProperty<float>([]() { return state().time; });
 
-    static inline float timeScale = 1.0f;
+    static inline Property<float> timeScale = Property<float>(
+        []() { return state().timeScale; },
+        [](const float& v) { state().timeScale = v; });
 
-    static inline float unscaledTime = 0.0f;
+    static inline ReadOnlyProperty<float> unscaledTime = ReadOnlyProperty<float>([]() { return state().unscaledTime; });
 
-    static inline float unscaledDeltaTime = 0.0f;
+    static inline ReadOnlyProperty<float> unscaledDeltaTime = ReadOnlyProperty<float>([]() { return state().unscaledDeltaTime; });
 
-    static inline ReadOnlyProperty<float> deltaTime = ReadOnlyProperty<float>([]() { return unscaledDeltaTime * timeScale; });
+    static inline ReadOnlyProperty<float> deltaTime = ReadOnlyProperty<float>([]() { return state().unscaledDeltaTime * state().timeScale; });
 
     static void Start()
     {
-        frameCount = 0;
-        time = 0.0f;
-        timeScale = 1.0f;
+        TimeState& s = state();
+        s.frameCount = 0;
+        s.time = 0.0f;
+        s.timeScale = 1.0f;
     }
 
     static void SetDeltaTimeFixed()
     {
-        unscaledDeltaTime = fixedDeltaTime;
+        TimeState& s = state();
+        s.unscaledDeltaTime = s.fixedDeltaTime;
     }
 
     static void SetDeltaTimeFrame()
     {
-        unscaledDeltaTime = float(realDeltaTime);
+        TimeState& s = state();
+        s.unscaledDeltaTime = float(s.realDeltaTime);
     }
 
     static void UpdateFrame(double rt)
     {
-        realDeltaTime = rt;
-        frameCount++;
-        time = float(time + rt * timeScale);
-        unscaledTime += float(rt);
+        TimeState& s = state();
+        s.realDeltaTime = rt;
+        s.frameCount++;
+        s.time = float(s.time + rt * s.timeScale);
+        s.unscaledTime += float(rt);
     }
-
-private:
-    static inline double realDeltaTime;
 };
 
 }
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <memory>
+#include <atomic>
 #include <SimpleMath.h>
 
 #include "UniDxDefine.h"
@@ -26,6 +27,10 @@ public:
     // ワールド空間のプロパティ
     Property<Vector3> position;
     Property<Quaternion> rotation;
+    ReadOnlyProperty<Vector3> lossyScale;
+
+    // 最後にfalseを設定してから、このTransform（または親）が変化したか
+    Property<bool> hasChanged;
 
     Transform* parent = nullptr;
 
@@ -37,6 +42,9 @@ public:
     // 親のいないTransformを持つGameObjectに親を設定
     static void SetParent(unique_ptr<GameObject> gameObjectPtr, Transform* newParent);
 
+    // 親（親がなければシーンのルート）から外して所有権を取り出す
+    unique_ptr<GameObject> DetachFromParent();
+
     // 子の数を取得
     size_t childCount() const { return children.size(); }
 
@@ -59,6 +67,32 @@ public:
         return m_worldMatrix;
     }
 
+    // 変更バージョン
+    // ワールド行列が再計算されるたびに単調増加する。親の変化も反映される
+    // 全Transformで共通のカウンタから採番するので、異なるTransform間で値が重複しない
+    uint64_t getChangeVersion() const {
+        updateMatrices();
+        return m_changeVersion;
+    }
+
+    // ワールド座標（行列更新時にキャッシュした値）
+    const Vector3& getWorldPosition() const {
+        updateMatrices();
+        return m_worldPosition;
+    }
+
+    // ワールド回転（行列更新時にキャッシュした値）
+    const Quaternion& getWorldRotation() const {
+        updateMatrices();
+        return m_worldRotation;
+    }
+
+    // ワールド空間での近似スケール（行列更新時にキャッシュした値）
+    const Vector3& getLossyScale() const {
+        updateMatrices();
+        return m_lossyScale;
+    }
+
     Transform()
         : localPosition(
             // getter
@@ -76,10 +110,7 @@ public:
         ),
         position(
             // getter: グローバル座標
-            [this]() {
-                updateMatrices();
-                return m_worldMatrix.Translation();
-            },
+            [this]() { return getWorldPosition(); },
             // setter: グローバル座標からlocalPositionを逆算
             [this](Vector3 worldPos) {
                 if (parent) {
@@ -93,22 +124,12 @@ public:
             }
         ),
         rotation(
-            [this]() {
-                updateMatrices();
-                // ワールド行列からクォータニオンを取得
-                Vector3 s, t;
-                Quaternion q;
-                m_worldMatrix.Decompose(s, q, t);
-                return q;
-            },
+            [this]() { return getWorldRotation(); },
             [this](Quaternion worldRot) {
                 if (parent) {
-                    parent->updateMatrices();
                     // 親のワールド回転の逆を掛けてローカル回転を算出
-                    Quaternion parentWorldRot, parentWorldRotInv;
-                    Vector3 s, t;
-                    parent->m_worldMatrix.Decompose(s, parentWorldRot, t);
-                    parentWorldRot.Inverse(parentWorldRotInv);
+                    Quaternion parentWorldRotInv;
+                    parent->getWorldRotation().Inverse(parentWorldRotInv);
                     _localRotation = Quaternion::Concatenate(worldRot, parentWorldRotInv);
                 }
                 else {
@@ -116,6 +137,13 @@ public:
                 }
                 m_dirty = true;
             }
+        ),
+        lossyScale(
+            [this]() { return getLossyScale(); }
+        ),
+        hasChanged(
+            [this]() { updateMatrices(); return m_hasChanged; },
+            [this](bool b) { updateMatrices(); m_hasChanged = b; }
         )
     {
     }
@@ -124,10 +152,8 @@ public:
 
     // ローカル空間の方向ベクトルをワールド空間の方向ベクトルに変換
     Vector3 TransformDirection(Vector3 localDirection) const {
-        // 平行移動成分を除外した回転・スケールのみ適用
-        Matrix m = getLocalToWorldMatrix();
-        m.Translation(Vector3(0, 0, 0)); // 平行移動を除外
-        return Vector3::TransformNormal(localDirection, m);
+        // TransformNormalは平行移動成分を使わないので、キャッシュ済みの行列の3x3部分だけが適用される
+        return Vector3::TransformNormal(localDirection, getLocalToWorldMatrix());
     }
 
     // ローカル空間のベクトルをワールド空間のベクトルに変換（スケール・回転のみ、平行移動なし）
@@ -147,6 +173,16 @@ private:
     mutable Matrix m_localMatrix = Matrix::Identity;
     mutable Matrix m_worldMatrix = Matrix::Identity;
 
+    // 行列更新時にキャッシュするワールド空間の姿勢
+    mutable Vector3 m_worldPosition{ 0,0,0 };
+    mutable Quaternion m_worldRotation = Quaternion::Identity;
+    mutable Vector3 m_lossyScale{ 1,1,1 };
+
+    // 変更の追跡
+    mutable uint64_t m_changeVersion = 0;
+    mutable bool m_hasChanged = true;
+    static inline std::atomic<uint64_t> s_changeVersionCounter = 0;
+
     bool dirtyInHierarchy() const { return m_dirty || parent && parent->dirtyInHierarchy(); }
 
     Vector3 _localPosition{ 0,0,0 };
@@ -0,0 +1,268 @@
+﻿#include "pch.h"
+#include <UniDx/AccessorDecoder.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define UNIDX_DECODE_SSE2
+#endif
+
+
+namespace UniDx
+{
+
+namespace
+{
+    // 正規化された整数を float にするときの倍率
+    float normalizeScale(int componentType)
+    {
+        switch (componentType)
+        {
+        case VertexComponent_Byte:          return 1.0f / 127.0f;
+        case VertexComponent_UnsignedByte:  return 1.0f / 255.0f;
+        case VertexComponent_Short:         return 1.0f / 32767.0f;
+        case VertexComponent_UnsignedShort: return 1.0f / 65535.0f;
+        default:                            return 1.0f;
+        }
+    }
+
+    // 成分をひとつ float で読む
+    float readComponent(const uint8_t* p, int componentType)
+    {
+        switch (componentType)
+        {
+        case VertexComponent_Float:         { float v; memcpy(&v, p, 4); return v; }
+        case VertexComponent_UnsignedByte:  return float(*p);
+        case VertexComponent_Byte:          return float(int8_t(*p));
+        case VertexComponent_UnsignedShort: { uint16_t v; memcpy(&v, p, 2); return float(v); }
+        case VertexComponent_Short:         { int16_t v; memcpy(&v, p, 2); return float(v); }
+        case VertexComponent_UnsignedInt:   { uint32_t v; memcpy(&v, p, 4); return float(v); }
+        default:                            return 0.0f;
+        }
+    }
+
+    // 1 成分ずつ変換する
+    void decodeScalar(const uint8_t* src, size_t stride, size_t count, int componentType, bool normalized,
+        int components, float* dst, int dstComponents, const float* fill)
+    {
+        size_t size = AccessorDecoder::ComponentSize(componentType);
+        bool scale = normalized && componentType != VertexComponent_Float && componentType != VertexComponent_UnsignedInt;
+        float s = normalizeScale(componentType);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint8_t* element = src + i * stride;
+            float* out = dst + i * dstComponents;
+            for (int c = 0; c < dstComponents; ++c)
+            {
+                if (c < components)
+                {
+                    float v = readComponent(element + c * size, componentType);
+                    out[c] = scale ? std::max(v * s, -1.0f) : v;
+                }
+                else
+                {
+                    out[c] = fill != nullptr ? fill[c] : 0.0f;
+                }
+            }
+        }
+    }
+
+#ifdef UNIDX_DECODE_SSE2
+    // 4 成分分のバイトを 32bit 整数に広げる
+    template<int ComponentType>
+    __m128i widen(__m128i x)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        if constexpr (ComponentType == VertexComponent_UnsignedByte)
+        {
+            return _mm_unpacklo_epi16(_mm_unpacklo_epi8(x, zero), zero);
+        }
+        else if constexpr (ComponentType == VertexComponent_Byte)
+        {
+            // 上位バイトに置いてから算術シフトで符号を広げる
+            x = _mm_unpacklo_epi8(x, x);
+            return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 24);
+        }
+        else if constexpr (ComponentType == VertexComponent_UnsignedShort)
+        {
+            return _mm_unpacklo_epi16(x, zero);
+        }
+        else
+        {
+            return _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        }
+    }
+
+    // 4 成分分のバイトを float にする。正規化するなら -1 未満を -1 にそろえる
+    template<int ComponentType>
+    __m128 convert(__m128i x, bool scale, __m128 s)
+    {
+        if constexpr (ComponentType == VertexComponent_Float)
+        {
+            return _mm_castsi128_ps(x);
+        }
+        else
+        {
+            __m128 v = _mm_cvtepi32_ps(widen<ComponentType>(x));
+            return scale ? _mm_max_ps(_mm_mul_ps(v, s), _mm_set1_ps(-1.0f)) : v;
+        }
+    }
+
+    // 4 要素分の 4 成分を dstComponents 個ずつ詰めて書き込む
+    void store4(float* out, int dstComponents, __m128 v0, __m128 v1, __m128 v2, __m128 v3)
+    {
+        switch (dstComponents)
+        {
+        case 4:
+            _mm_storeu_ps(out, v0);
+            _mm_storeu_ps(out + 4, v1);
+            _mm_storeu_ps(out + 8, v2);
+            _mm_storeu_ps(out + 12, v3);
+            break;
+        case 3:
+            // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+            _mm_storeu_ps(out, _mm_shuffle_ps(v0, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0, 0, 2, 2)), _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(out + 4, _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 0, 2, 1)));
+            _mm_storeu_ps(out + 8, _mm_shuffle_ps(_mm_shuffle_ps(v2, v3, _MM_SHUFFLE(0, 0, 2, 2)), v3, _MM_SHUFFLE(2, 1, 2, 0)));
+            break;
+        case 2:
+            _mm_storeu_ps(out, _mm_movelh_ps(v0, v1));
+            _mm_storeu_ps(out + 4, _mm_movelh_ps(v2, v3));
+            break;
+        default:
+            _mm_storeu_ps(out, _mm_movelh_ps(_mm_unpacklo_ps(v0, v1), _mm_unpacklo_ps(v2, v3)));
+            break;
+        }
+    }
+
+    // 4 要素ずつまとめて変換する
+    // 要素の先頭から 16 バイトを読んでも配列の終わりを越えない要素は、そのまま 16 バイト読み込む
+    // 残りの要素だけ成分のバイトを取り出してから変換する
+    // 成分が足りないレーンは fill で埋める
+    template<int ComponentType>
+    void decodeSSE2(const uint8_t* src, size_t stride, size_t count, bool normalized,
+        int components, float* dst, int dstComponents, const float* fill)
+    {
+        constexpr size_t size = ComponentType == VertexComponent_Float ? 4
+            : (ComponentType == VertexComponent_Byte || ComponentType == VertexComponent_UnsignedByte) ? 1 : 2;
+
+        const int n = std::min(components, 4);
+        const size_t bytes = size * n;
+
+        // 成分のあるレーンだけ変換した値を使うマスク
+        alignas(16) uint32_t maskBits[4];
+        alignas(16) float fillValues[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            maskBits[c] = c < n ? 0xffffffffu : 0u;
+            fillValues[c] = fill != nullptr && c < dstComponents ? fill[c] : 0.0f;
+        }
+        const __m128 mask = _mm_load_ps(reinterpret_cast<const float*>(maskBits));
+        const __m128 fillVector = _mm_andnot_ps(mask, _mm_load_ps(fillValues));
+
+        const bool scale = normalized && ComponentType != VertexComponent_Float;
+        const __m128 s = _mm_set1_ps(normalizeScale(ComponentType));
+
+        auto load = [&](const uint8_t* p)
+        {
+            __m128 v = convert<ComponentType>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), scale, s);
+            return _mm_or_ps(_mm_and_ps(v, mask), fillVector);
+        };
+
+        // そのまま 16 バイト読める要素の数
+        const size_t end = (count - 1) * stride + bytes;
+        size_t direct = 0;
+        if (end >= 16)
+        {
+            direct = stride == 0 ? count : std::min(count, (end - 16) / stride + 1);
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= direct; i += 4)
+        {
+            const uint8_t* p = src + i * stride;
+            store4(dst + i * dstComponents, dstComponents, load(p), load(p + stride), load(p + stride * 2), load(p + stride * 3));
+        }
+
+        for (; i < count; ++i)
+        {
+            // 要素の終わりを越えて読まないように、成分のバイトだけ取り出す
+            alignas(16) uint8_t raw[16] = {};
+            memcpy(raw, src + i * stride, bytes);
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, load(raw));
+            memcpy(dst + i * dstComponents, lanes, sizeof(float) * dstComponents);
+        }
+    }
+#endif
+}
+
+
+size_t AccessorDecoder::ComponentSize(int componentType)
+{
+    switch (componentType)
+    {
+    case VertexComponent_Byte:
+    case VertexComponent_UnsignedByte:  return 1;
+    case VertexComponent_Short:
+    case VertexComponent_UnsignedShort: return 2;
+    case VertexComponent_UnsignedInt:
+    case VertexComponent_Float:         return 4;
+    default:                            return 0;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 変換
+// -----------------------------------------------------------------------------
+void AccessorDecoder::Decode(const void* src, size_t stride, size_t count,
+    int componentType, bool normalized, int components,
+    float* dst, int dstComponents, const float* fill)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(src);
+    if (count == 0 || components <= 0 || dstComponents <= 0 || ComponentSize(componentType) == 0)
+    {
+        return;
+    }
+
+    // 詰めて並んだ同じ成分数の float はそのままコピー
+    if (componentType == VertexComponent_Float && components == dstComponents && stride == sizeof(float) * components)
+    {
+        memcpy(dst, p, count * stride);
+        return;
+    }
+
+#ifdef UNIDX_DECODE_SSE2
+    if (dstComponents <= 4)
+    {
+        switch (componentType)
+        {
+        case VertexComponent_Float:         decodeSSE2<VertexComponent_Float>(p, stride, count, normalized, components, dst, dstComponents, fill); return;
+        case VertexComponent_Byte:          decodeSSE2<VertexComponent_Byte>(p, stride, count, normalized, components, dst, dstComponents, fill); return;
+        case VertexComponent_UnsignedByte:  decodeSSE2<VertexComponent_UnsignedByte>(p, stride, count, normalized, components, dst, dstComponents, fill); return;
+        case VertexComponent_Short:         decodeSSE2<VertexComponent_Short>(p, stride, count, normalized, components, dst, dstComponents, fill); return;
+        case VertexComponent_UnsignedShort: decodeSSE2<VertexComponent_UnsignedShort>(p, stride, count, normalized, components, dst, dstComponents, fill); return;
+        default: break;
+        }
+    }
+#endif
+
+    decodeScalar(p, stride, count, componentType, normalized, components, dst, dstComponents, fill);
+}
+
+
+void AccessorDecoder::DecodeScalar(const void* src, size_t stride, size_t count,
+    int componentType, bool normalized, int components,
+    float* dst, int dstComponents, const float* fill)
+{
+    if (count == 0 || components <= 0 || dstComponents <= 0 || ComponentSize(componentType) == 0)
+    {
+        return;
+    }
+    decodeScalar(static_cast<const uint8_t*>(src), stride, count, componentType, normalized, components, dst, dstComponents, fill);
+}
+
+} // namespace UniDx
@@ -0,0 +1,179 @@
+﻿#include "pch.h"
+#include <UniDx/AssetDatabase.h>
+
+#include <filesystem>
+#include <cwctype>
+
+#include <UniDx/Texture.h>
+#include <UniDx/Font.h>
+
+
+namespace UniDx
+{
+
+// -----------------------------------------------------------------------------
+// キー
+// -----------------------------------------------------------------------------
+std::wstring AssetDatabase::NormalizePath(const std::wstring& path)
+{
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(std::filesystem::path(path), ec);
+    std::wstring result = (ec ? std::filesystem::path(path) : absolute).lexically_normal().make_preferred().wstring();
+
+    // Windows のパスは大文字小文字を区別しない
+    for (auto& c : result)
+    {
+        c = wchar_t(std::towlower(c));
+    }
+    return result;
+}
+
+
+size_t AssetDatabase::KeyHash::operator()(const Key& key) const
+{
+    size_t h = key.type.hash_code();
+    h ^= std::hash<std::wstring>()(key.path) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    h ^= std::hash<uint64_t>()(key.params) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+
+// -----------------------------------------------------------------------------
+// 検索と読み込み
+// -----------------------------------------------------------------------------
+std::shared_ptr<void> AssetDatabase::find(std::type_index type, const std::wstring& normalizedPath, uint64_t params)
+{
+    auto it = entries_.find(Key{ type, normalizedPath, params });
+    return it != entries_.end() ? it->second.lock() : nullptr;
+}
+
+
+std::shared_ptr<void> AssetDatabase::findOrLoad(std::type_index type, const std::wstring& path, uint64_t params,
+    const std::function<std::shared_ptr<void>()>& load)
+{
+    Key key{ type, NormalizePath(path), params };
+    auto it = entries_.find(key);
+    if (it != entries_.end())
+    {
+        if (auto asset = it->second.lock())
+        {
+            hits_++;
+            return asset;
+        }
+    }
+
+    misses_++;
+    std::shared_ptr<void> asset = load();
+    if (asset != nullptr)
+    {
+        entries_[std::move(key)] = asset;
+    }
+    return asset;
+}
+
+
+std::shared_ptr<Texture> AssetDatabase::LoadTexture(const std::wstring& path,
+    D3D11_TEXTURE_ADDRESS_MODE wrapModeU, D3D11_TEXTURE_ADDRESS_MODE wrapModeV)
+{
+    return Load<Texture>(path, uint64_t(wrapModeU) | (uint64_t(wrapModeV) << 8), [&]() -> std::shared_ptr<Texture>
+        {
+            auto texture = std::make_shared<Texture>();
+            texture->wrapModeU = wrapModeU;
+            texture->wrapModeV = wrapModeV;
+            if (!texture->Load(path))
+            {
+                Debug::Log(L"テクスチャを読み込めません: " + path);
+                return nullptr;
+            }
+            return texture;
+        });
+}
+
+
+std::shared_ptr<Texture> AssetDatabase::LoadTexture(const std::wstring& path, const DirectX::ScratchImage& image,
+    D3D11_TEXTURE_ADDRESS_MODE wrapModeU, D3D11_TEXTURE_ADDRESS_MODE wrapModeV)
+{
+    return Load<Texture>(path, uint64_t(wrapModeU) | (uint64_t(wrapModeV) << 8), [&]() -> std::shared_ptr<Texture>
+        {
+            auto texture = std::make_shared<Texture>();
+            texture->wrapModeU = wrapModeU;
+            texture->wrapModeV = wrapModeV;
+            if (!texture->Create(path, image))
+            {
+                Debug::Log(L"テクスチャを作れません: " + path);
+                return nullptr;
+            }
+            return texture;
+        });
+}
+
+
+std::shared_ptr<Font> AssetDatabase::LoadFont(const std::wstring& path)
+{
+    return Load<Font>(path, 0, [&]() -> std::shared_ptr<Font>
+        {
+            auto font = std::make_shared<Font>();
+            if (!font->Load(path))
+            {
+                Debug::Log(L"フォントを読み込めません: " + path);
+                return nullptr;
+            }
+            return font;
+        });
+}
+
+
+std::shared_ptr<Font> AssetDatabase::LoadFont(const std::wstring& path, const std::vector<uint8_t>& data)
+{
+    return Load<Font>(path, 0, [&]() -> std::shared_ptr<Font>
+        {
+            auto font = std::make_shared<Font>();
+            if (!font->Create(path, data))
+            {
+                Debug::Log(L"フォントを作れません: " + path);
+                return nullptr;
+            }
+            return font;
+        });
+}
+
+
+// -----------------------------------------------------------------------------
+// 解放されたエントリの掃除と統計
+// -----------------------------------------------------------------------------
+void AssetDatabase::Collect()
+{
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+        if (it->second.expired())
+        {
+            it = entries_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+AssetDatabase::Stats AssetDatabase::getStats()
+{
+    Collect();
+
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.liveCount = entries_.size();
+    return stats;
+}
+
+
+void AssetDatabase::LogStats()
+{
+    Stats stats = getStats();
+    Debug::Log(L"アセット: " + std::to_wstring(stats.liveCount) + L" 個 (ヒット " + std::to_wstring(stats.hits)
+        + L", ミス " + std::to_wstring(stats.misses) + L")");
+}
+
+} // namespace UniDx
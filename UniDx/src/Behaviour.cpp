@@ -0,0 +1,62 @@
+﻿#include "pch.h"
+#include <UniDx/Behaviour.h>
+
+#include <UniDx/SceneSerializer.h>
+
+
+namespace UniDx
+{
+
+Behaviour::~Behaviour()
+{
+    StopAllCoroutines();
+}
+
+
+CoroutineHandle Behaviour::StartCoroutine(Coroutine&& coroutine)
+{
+    auto scheduler = CoroutineScheduler::getInstance();
+    if (scheduler == nullptr)
+    {
+        return CoroutineHandle();
+    }
+    return scheduler->start(this, std::move(coroutine));
+}
+
+
+void Behaviour::StopCoroutine(CoroutineHandle handle)
+{
+    auto scheduler = CoroutineScheduler::getInstance();
+    if (scheduler != nullptr)
+    {
+        scheduler->stop(handle);
+    }
+}
+
+
+void Behaviour::StopAllCoroutines()
+{
+    if (runningCoroutines_ == 0)
+    {
+        return;
+    }
+    auto scheduler = CoroutineScheduler::getInstance();
+    if (scheduler != nullptr)
+    {
+        scheduler->stopAll(this);
+    }
+}
+
+
+void Behaviour::Serialize(SceneWriter& writer) const
+{
+    writer.write(updatePolicy);
+}
+
+
+void Behaviour::Deserialize(SceneReader& reader)
+{
+    reader.read(updatePolicy);
+}
+
+} // namespace UniDx
@@ -1,30 +1,31 @@
 ﻿#include "pch.h"
 #include <UniDx/Camera.h>
 
+#include <UniDx/SceneSerializer.h>
+
 namespace UniDx{
 
-// static なメインカメラ
-Camera* Camera::main;
+// メインカメラは EngineContext が保持する
+Property<Camera*> Camera::main(
+    []() { return EngineContext::current()->mainCamera; },
+    [](Camera* const& c) { EngineContext::current()->mainCamera = c; }
+);
 
 Matrix Camera::GetViewMatrix() const
 {
-    // ワールド行列を分解
-    Vector3 scale, translation;
-    Quaternion rotation;
-    Matrix mtx = transform->getLocalToWorldMatrix();
-    mtx.Decompose(scale, rotation, translation);
-
-    // スケールを(1,1,1)にして再構成
-    Matrix worldNoScale = Matrix::CreateFromQuaternion(rotation) * Matrix::CreateTranslation(translation);
+    // Transformがキャッシュしているワールド座標と回転を使い、行列の分解を避ける
+    const Vector3& translation = transform->getWorldPosition();
+    Quaternion invRotation;
+    transform->getWorldRotation().Inverse(invRotation);
 
-    // 逆行列を返す（ビュー行列）
-    return worldNoScale.Invert();
+    // スケールを除いたワールド行列の逆行列（ビュー行列）を直接組み立てる
+    return Matrix::CreateTranslation(-translation) * Matrix::CreateFromQuaternion(invRotation);
 }
 
 
 void Camera::OnEnable()
 {
-    if (main == nullptr)
+    if (main.get() == nullptr)
     {
         main = this;
     }
@@ -39,4 +40,22 @@ void Camera::OnDisable()
     }
 }
 
+
+void Camera::Serialize(SceneWriter& writer) const
+{
+    Behaviour::Serialize(writer);
+    writer.write(fov);
+    writer.write(nearClip);
+    writer.write(farClip);
+}
+
+
+void Camera::Deserialize(SceneReader& reader)
+{
+    Behaviour::Deserialize(reader);
+    reader.read(fov);
+    reader.read(nearClip);
+    reader.read(farClip);
+}
+
 }
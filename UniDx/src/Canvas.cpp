@@ -9,6 +9,7 @@
 #include <UniDx/Shader.h>
 #include <UniDx/Material.h>
 #include <UniDx/D3DManager.h>
+#include <UniDx/SceneSerializer.h>
 
 namespace UniDx {
 
@@ -17,12 +18,16 @@ using namespace DirectX;
 
 void Canvas::Awake()
 {
-	size = D3DManager::getInstance()->getScreenSize();
+	if (D3DManager::isAvailable())
+	{
+		size = D3DManager::getInstance()->getScreenSize();
+	}
 }
 
 
 void Canvas::LoadDefaultMaterial(const wchar_t* assetPath)
 {
+	assetPath_ = assetPath;
 	std::filesystem::path assetRoot = assetPath;
 	defaultMaterial = std::make_unique<Material>();
 	defaultMaterial->shader.compile<VertexPC>(assetRoot / L"Color.hlsl");
@@ -58,6 +63,25 @@ void Canvas::unregisterUI(UIBehaviour* e)
 }
 
 
+// ftHg}eA̓tH_oāAǂݍݎɍ蒼
+void Canvas::Serialize(SceneWriter& writer) const
+{
+	Behaviour::Serialize(writer);
+	writer.writeString(assetPath_);
+}
+
+
+void Canvas::Deserialize(SceneReader& reader)
+{
+	Behaviour::Deserialize(reader);
+	std::wstring assetPath(reader.readString());
+	if (!assetPath.empty())
+	{
+		LoadDefaultMaterial(assetPath.c_str());
+	}
+}
+
+
 Material* Canvas::getDefaultMaterial()
 {
 	return defaultMaterial.get();
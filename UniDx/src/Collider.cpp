@@ -4,6 +4,7 @@
 #include <UniDx/Collider.h>
 #include <UniDx/Collision.h>
 #include <UniDx/Rigidbody.h>
+#include <UniDx/SceneSerializer.h>
 
 namespace
 {
@@ -135,6 +136,53 @@ namespace UniDx
     }
 
 
+    // シーンファイルへの書き出しと読み込み
+    void Collider::Serialize(SceneWriter& writer) const
+    {
+        writer.write(isTrigger);
+        writer.write(bounciness);
+    }
+
+
+    void Collider::Deserialize(SceneReader& reader)
+    {
+        reader.read(isTrigger);
+        reader.read(bounciness);
+    }
+
+
+    void AABBCollider::Serialize(SceneWriter& writer) const
+    {
+        Collider::Serialize(writer);
+        writer.write(center);
+        writer.write(size);
+    }
+
+
+    void AABBCollider::Deserialize(SceneReader& reader)
+    {
+        Collider::Deserialize(reader);
+        reader.read(center);
+        reader.read(size);
+    }
+
+
+    void SphereCollider::Serialize(SceneWriter& writer) const
+    {
+        Collider::Serialize(writer);
+        writer.write(center);
+        writer.write(radius);
+    }
+
+
+    void SphereCollider::Deserialize(SceneReader& reader)
+    {
+        Collider::Deserialize(reader);
+        reader.read(center);
+        reader.read(radius);
+    }
+
+
     // ワールド空間における空間境界を取得
     Bounds SphereCollider::getBounds() const
     {
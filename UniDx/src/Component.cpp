@@ -11,12 +11,14 @@ Component::Component() :
         [this]() { return _enabled && isCalledAwake; },
 
         // set
+        // 非アクティブな GameObject では、アクティブになったときに OnEnable() が呼ばれる
         [this](bool value) {
-            if (!_enabled && value) {
+            bool active = gameObject == nullptr || gameObject->activeInHierarchy();
+            if (!_enabled && value && active) {
                 if (!isCalledAwake) { Awake(); isCalledAwake = true; }
                 OnEnable();
             }
-            else if (_enabled && !value) {
+            else if (_enabled && !value && active) {
                 if (isCalledAwake) { OnDisable(); }
             }
             _enabled = value;
@@ -0,0 +1,343 @@
+﻿#include "pch.h"
+#include <UniDx/Coroutine.h>
+
+#include <mutex>
+#include <memory>
+#include <new>
+#include <algorithm>
+
+#include <UniDx/Behaviour.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    // -----------------------------------------------------------------------------
+    // コルーチンフレームのプール
+    // 64バイト単位のサイズごとにフリーリストを持つ。大きすぎるものは通常の new
+    // -----------------------------------------------------------------------------
+    class CoroutineFramePool
+    {
+    public:
+        static constexpr size_t Granularity = 64;
+        static constexpr size_t ClassCount = 32;       // 2048バイトまで
+        static constexpr size_t BlocksPerChunk = 64;
+
+        void* allocate(size_t size)
+        {
+            size_t c = sizeClass(size);
+            if (c >= ClassCount)
+            {
+                return ::operator new(size);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (freeList_[c] == nullptr)
+            {
+                grow(c);
+            }
+            FreeBlock* block = freeList_[c];
+            freeList_[c] = block->next;
+            return block;
+        }
+
+        void deallocate(void* p, size_t size)
+        {
+            size_t c = sizeClass(size);
+            if (c >= ClassCount)
+            {
+                ::operator delete(p);
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            FreeBlock* block = static_cast<FreeBlock*>(p);
+            block->next = freeList_[c];
+            freeList_[c] = block;
+        }
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        std::mutex mutex_;
+        FreeBlock* freeList_[ClassCount] = {};
+        std::vector<std::unique_ptr<std::byte[]>> chunks_;
+
+        static size_t sizeClass(size_t size) { return (size + Granularity - 1) / Granularity - 1; }
+
+        void grow(size_t c)
+        {
+            const size_t blockSize = (c + 1) * Granularity;
+            chunks_.push_back(std::make_unique<std::byte[]>(blockSize * BlocksPerChunk));
+            std::byte* chunk = chunks_.back().get();
+            for (size_t i = 0; i < BlocksPerChunk; ++i)
+            {
+                FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + blockSize * i);
+                block->next = freeList_[c];
+                freeList_[c] = block;
+            }
+        }
+    };
+
+    // 終了時に破棄されるシングルトンよりも後まで使われるので解放しない
+    CoroutineFramePool& framePool()
+    {
+        static CoroutineFramePool* pool = new CoroutineFramePool();
+        return *pool;
+    }
+}
+
+
+void* Coroutine::promise_type::operator new(size_t size)
+{
+    return framePool().allocate(size);
+}
+
+
+void Coroutine::promise_type::operator delete(void* p, size_t size)
+{
+    framePool().deallocate(p, size);
+}
+
+
+// -----------------------------------------------------------------------------
+// CoroutineScheduler
+// -----------------------------------------------------------------------------
+CoroutineScheduler::~CoroutineScheduler()
+{
+    for (auto& it : running_)
+    {
+        Coroutine::Handle h = it.second;
+        if (h.promise().owner != nullptr)
+        {
+            h.promise().owner->runningCoroutines_--;
+        }
+        h.destroy();
+    }
+    running_.clear();
+}
+
+
+CoroutineHandle CoroutineScheduler::start(Behaviour* owner, Coroutine&& coroutine)
+{
+    Coroutine::Handle h = coroutine.release();
+    if (!h)
+    {
+        return CoroutineHandle();
+    }
+
+    uint64_t id = nextId_++;
+    h.promise().id = id;
+    h.promise().owner = owner;
+    running_.emplace(id, h);
+    if (owner != nullptr)
+    {
+        owner->runningCoroutines_++;
+    }
+
+    // 最初の中断まで実行
+    resume(id);
+    return CoroutineHandle{ id };
+}
+
+
+void CoroutineScheduler::stop(CoroutineHandle handle)
+{
+    auto it = running_.find(handle.id);
+    if (it == running_.end())
+    {
+        return;
+    }
+
+    // 実行中のコルーチンを止めたときは、中断してから破棄する
+    // 中断までに owner が破棄されることがある（コルーチンの中で自身の GameObject を破棄したときのデストラクタからの呼び出し）ので、
+    // ここで owner から外しておき、finish() では触らない
+    if (std::find(resumingStack_.begin(), resumingStack_.end(), handle.id) != resumingStack_.end())
+    {
+        Coroutine::promise_type& promise = it->second.promise();
+        promise.stopRequested = true;
+        if (promise.owner != nullptr)
+        {
+            promise.owner->runningCoroutines_--;
+            promise.owner = nullptr;
+        }
+        return;
+    }
+    finish(handle.id);
+}
+
+
+void CoroutineScheduler::stopAll(const Behaviour* owner)
+{
+    if (owner == nullptr || owner->runningCoroutines_ == 0)
+    {
+        return;
+    }
+
+    std::vector<uint64_t> ids;
+    for (auto& it : running_)
+    {
+        if (it.second.promise().owner == owner)
+        {
+            ids.push_back(it.first);
+        }
+    }
+    for (uint64_t id : ids)
+    {
+        stop(CoroutineHandle{ id });
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 再開
+// -----------------------------------------------------------------------------
+void CoroutineScheduler::beginFrame(float time)
+{
+    time_ = time;
+    frame_++;
+
+    // 前のフレームまでに登録されたものだけをこのフレームの再開の対象にする
+    thisFrame_.insert(thisFrame_.end(), nextFrame_.begin(), nextFrame_.end());
+    nextFrame_.clear();
+}
+
+
+void CoroutineScheduler::fixedUpdate()
+{
+    resumeList_.swap(fixedUpdate_);
+    resumeAll(resumeList_);
+}
+
+
+void CoroutineScheduler::update()
+{
+    // 次のフレーム待ち
+    // このフレーム（再開中を含む）に登録されたものは nextFrame_ にあるので次のフレームに回る
+    resumeList_.swap(thisFrame_);
+    resumeAll(resumeList_);
+
+    // 時間待ち。時刻に達したものだけを取り出す
+    // このフレームに待ち始めたものは、時刻に達していても次のフレームに回す
+    while (!timers_.empty() && timers_.top().time <= time_)
+    {
+        const Timer& timer = timers_.top();
+        if (timer.frame < frame_)
+        {
+            resumeList_.push_back(timer.id);
+        }
+        else
+        {
+            deferredTimers_.push_back(timer);
+        }
+        timers_.pop();
+    }
+    for (const Timer& timer : deferredTimers_)
+    {
+        timers_.push(timer);
+    }
+    deferredTimers_.clear();
+    resumeAll(resumeList_);
+
+    // 条件待ち
+    predicateList_.swap(predicates_);
+    for (auto& p : predicateList_)
+    {
+        if (!running_.contains(p.id))
+        {
+            continue;
+        }
+        if (p.func())
+        {
+            resume(p.id);
+        }
+        else
+        {
+            predicates_.push_back(std::move(p));
+        }
+    }
+    predicateList_.clear();
+}
+
+
+void CoroutineScheduler::resumeAll(std::vector<uint64_t>& list)
+{
+    for (uint64_t id : list)
+    {
+        resume(id);
+    }
+    list.clear();
+}
+
+
+void CoroutineScheduler::resume(uint64_t id)
+{
+    auto it = running_.find(id);
+    if (it == running_.end())
+    {
+        // 止められたコルーチン
+        return;
+    }
+
+    Coroutine::Handle h = it->second;
+    resumingStack_.push_back(id);
+    h.resume();
+    resumingStack_.pop_back();
+
+    if (h.done() || h.promise().stopRequested)
+    {
+        finish(id);
+    }
+}
+
+
+void CoroutineScheduler::finish(uint64_t id)
+{
+    auto it = running_.find(id);
+    if (it == running_.end())
+    {
+        return;
+    }
+
+    Coroutine::Handle h = it->second;
+    running_.erase(it);
+    if (h.promise().owner != nullptr)
+    {
+        h.promise().owner->runningCoroutines_--;
+    }
+    h.destroy();
+}
+
+
+// -----------------------------------------------------------------------------
+// 待ちの登録
+// -----------------------------------------------------------------------------
+void CoroutineScheduler::waitNextFrame(uint64_t id)
+{
+    nextFrame_.push_back(id);
+}
+
+
+void CoroutineScheduler::waitFixedUpdate(uint64_t id)
+{
+    fixedUpdate_.push_back(id);
+}
+
+
+void CoroutineScheduler::waitUntilTime(uint64_t id, float time)
+{
+    timers_.push(Timer{ time, id, frame_ });
+}
+
+
+void CoroutineScheduler::waitUntil(uint64_t id, std::function<bool()> predicate)
+{
+    predicates_.push_back(Predicate{ id, std::move(predicate) });
+}
+
+} // namespace UniDx
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <chrono>
+#include <thread>
+#include <algorithm>
 
 #include <Keyboard.h>          // DirectXTK
 #include <SimpleMath.h>        // DirectXTK 便利数学ユーティリティ
@@ -24,8 +26,15 @@ using namespace DirectX::SimpleMath;
 #include <UniDx/Renderer.h>
 #include <UniDx/Physics.h>
 #include <UniDx/LightManager.h>
+#include <UniDx/LODManager.h>
 #include <UniDx/Input.h>
 #include <UniDx/Canvas.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/Coroutine.h>
+#include <UniDx/EventBus.h>
+#include <UniDx/LinearAllocator.h>
+#include <UniDx/AssetDatabase.h>
 
 using namespace std;
 using namespace UniDx;
@@ -44,17 +53,64 @@ void Engine::Initialize(HWND hWnd)
     // Direct3D初期化
     D3DManager::getInstance()->Initialize(hWnd, 1280, 720);
 
+    initializeSubsystems();
+}
+
+
+// -----------------------------------------------------------------------------
+//   InitializeHeadless()
+// -----------------------------------------------------------------------------
+void Engine::InitializeHeadless()
+{
+    // D3DManagerは作らない
+    headless_ = true;
+
+    initializeSubsystems();
+}
+
+
+// -----------------------------------------------------------------------------
+// 描画以外のサブシステムの初期化
+// -----------------------------------------------------------------------------
+void Engine::initializeSubsystems()
+{
+    Profiler::setThreadName("Main");
+
+    // ジョブシステムの作成（ワーカー数はコア数 - 1）
+    // プロセスで共有するので、最初に初期化したエンジンが持つ
+    if (JobSystem::getInstance() == nullptr)
+    {
+        JobSystem::create();
+        JobSystem::getInstance()->Initialize();
+        ownsJobSystem_ = true;
+    }
+
+    // 読み込んだアセットの共有
+    AssetDatabase::create();
+
     // シーンマネージャのインスタンス作成
     SceneManager::create();
 
-    // 入力の初期化
-    Input::initialize();
+    // 入力の初期化（ヘッドレスモードではキーボードを使わない）
+    Input::initialize(!headless_);
 
     // 物理エンジンのインスタンス作成
     Physics::create();
 
     // ライトマネージャのインスタンス作成
     LightManager::create();
+
+    // LOD の選択をまとめて行うマネージャの作成
+    LODManager::create();
+
+    // コルーチンのスケジューラ作成
+    CoroutineScheduler::create();
+
+    // イベントバスの作成
+    EventBus::create();
+
+    // フレーム内の一時データ用のメモリ
+    FrameMemory::create();
 }
 
 
@@ -81,13 +137,14 @@ int Engine::PlayerLoop()
     MSG msg;
 
     Time::Start();
-    double restFixedUpdateTime = 0.0f;
+    restFixedUpdateTime_ = 0.0;
+    quit_ = false;
 
     // デフォルトのシーン作成
     createScene();
 
     // メイン メッセージ ループ:
-    while (true)
+    while (!quit_)
     {
         if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
         {
@@ -107,48 +164,37 @@ int Engine::PlayerLoop()
 
         using clock = std::chrono::steady_clock;          // モノトニックなので経過時間計測向き
         auto start = clock::now();
+        UNIDX_PROFILE_SCOPE("Frame");
 
         //============================================
         // ゲームの処理を書く
         //============================================
         // 画面を塗りつぶす
-        D3DManager::getInstance()->Clear(0.3f, 0.5f, 0.9f, 1.0f);
-
-        Time::SetDeltaTimeFixed();
-
-        while (restFixedUpdateTime > Time::fixedDeltaTime)
         {
-            // 固定時間更新更新
-            fixedUpdate();
-
-            // 物理計算
-            physics();
-
-            restFixedUpdateTime -= Time::fixedDeltaTime;
+            UNIDX_PROFILE_SCOPE("Clear");
+            D3DManager::getInstance()->Clear(0.3f, 0.5f, 0.9f, 1.0f);
         }
 
-        Time::SetDeltaTimeFrame();
-
-        // 入力更新
-        input();
-
-        // 更新処理
-        update();
-
-        // 後更新処理
-        lateUpdate();
+        // 固定時間更新から後更新まで
+        updateFrame();
 
         // 描画処理
         render();
 
         // バックバッファの内容を画面に表示
-        D3DManager::getInstance()->Present();
+        {
+            UNIDX_PROFILE_SCOPE("Present");
+            D3DManager::getInstance()->Present();
+        }
 
         // 時間計算
         double deltaTime = std::chrono::duration<double>(clock::now() - start).count();
-        restFixedUpdateTime += deltaTime;
+        restFixedUpdateTime_ += deltaTime;
 
         Time::UpdateFrame(deltaTime);
+
+        // 時間指定のプロファイルの終了判定
+        Profiler::endFrame();
     }
 
     // 終了処理
@@ -158,9 +204,171 @@ int Engine::PlayerLoop()
 }
 
 
+// -----------------------------------------------------------------------------
+// ヘッドレスモードのループ
+// -----------------------------------------------------------------------------
+int Engine::HeadlessLoop(double frameRate, bool fastAsPossible, uint64_t maxFrames)
+{
+    using clock = std::chrono::steady_clock;
+
+    Time::Start();
+    restFixedUpdateTime_ = 0.0;
+    quit_ = false;
+    headlessStats_ = HeadlessStats();
+    auto loopStart = clock::now();
+
+    // デフォルトのシーン作成
+    createScene();
+    headlessStats_.sceneBuildMilliseconds = SceneManager::getInstance()->getBuildMilliseconds();
+
+    const double frameTime = 1.0 / frameRate;
+    const auto frameDuration = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(frameTime));
+    auto nextFrame = clock::now();
+
+    for (uint64_t frame = 0; !quit_ && (maxFrames == 0 || frame < maxFrames); ++frame)
+    {
+        auto start = clock::now();
+        UNIDX_PROFILE_SCOPE("Frame");
+
+        // 固定時間更新から後更新まで（描画はしない）
+        updateFrame();
+
+        double updateMilliseconds = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        headlessStats_.frames++;
+        headlessStats_.updateMilliseconds += updateMilliseconds;
+        headlessStats_.maxUpdateMilliseconds = std::max(headlessStats_.maxUpdateMilliseconds, updateMilliseconds);
+
+        double deltaTime;
+        if (fastAsPossible)
+        {
+            // 待たずに次のフレームへ。ゲーム内の時間は一定間隔で進める
+            deltaTime = frameTime;
+        }
+        else
+        {
+            // 次のフレームの時刻まで待つ
+            nextFrame += frameDuration;
+            std::this_thread::sleep_until(nextFrame);
+            deltaTime = std::chrono::duration<double>(clock::now() - start).count();
+        }
+        restFixedUpdateTime_ += deltaTime;
+
+        Time::UpdateFrame(deltaTime);
+
+        // 時間指定のプロファイルの終了判定
+        Profiler::endFrame();
+    }
+
+    // シーンの破棄（アリーナの有無で比べられるように時間を測る）
+    headlessStats_.sceneDestroyMilliseconds = SceneManager::getInstance()->destroyScene();
+
+    // 終了処理
+    finalize();
+    headlessStats_.wallSeconds = std::chrono::duration<double>(clock::now() - loopStart).count();
+
+    return 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// 1フレーム分の更新（固定時間更新、物理、入力、更新、後更新）
+// -----------------------------------------------------------------------------
+void Engine::updateFrame()
+{
+    // 前のフレーム（描画まで含む）のヒープ確保回数
+    uint64_t allocationCount = AllocationCounter::getThreadCount();
+    lastFrameAllocations_ = allocationCount - frameAllocationMark_;
+    frameAllocationMark_ = allocationCount;
+    frameIndex_++;
+
+    // 前のフレームの一時データを解放
+    FrameMemory::getInstance()->beginFrame();
+
+    // 前のフレームまでに次のフレーム待ちをしたコルーチンを、このフレームの再開の対象にする
+    CoroutineScheduler::getInstance()->beginFrame(Time::time);
+
+    Time::SetDeltaTimeFixed();
+
+    while (restFixedUpdateTime_ > Time::fixedDeltaTime)
+    {
+        FrameMemory::getInstance()->beginFixedStep();
+        uint64_t fixedStepMark = AllocationCounter::getThreadCount();
+
+        // 固定時間更新更新
+        fixedUpdate();
+
+        // 物理計算
+        physics();
+
+        // 固定時間更新と物理計算で発行されたイベントを配る
+        EventBus::getInstance()->dispatch();
+
+        // WaitForFixedUpdate のコルーチン再開
+        CoroutineScheduler::getInstance()->fixedUpdate();
+
+        if (frameIndex_ > fixedStepAllocationWarmup_)
+        {
+            fixedStepAllocations_ += AllocationCounter::getThreadCount() - fixedStepMark;
+        }
+
+        restFixedUpdateTime_ -= Time::fixedDeltaTime;
+    }
+
+    Time::SetDeltaTimeFrame();
+
+    // 入力更新
+    input();
+
+    // 更新処理
+    update();
+
+    // Update で発行されたイベントを配る
+    EventBus::getInstance()->dispatch();
+
+    // 中断中のコルーチンのうち、再開できるものを再開
+    {
+        UNIDX_PROFILE_SCOPE("Coroutines");
+        CoroutineScheduler::getInstance()->update();
+    }
+
+    // 後更新処理
+    lateUpdate();
+
+    // LateUpdate とコルーチンで発行されたイベントを配る
+    EventBus::getInstance()->dispatch();
+
+    // Instantiate / Destroy の反映
+    flushObjects();
+}
+
+
+// -----------------------------------------------------------------------------
+// フレームの途中で予約された GameObject の追加と破棄、非同期読み込みしたシーンの反映をまとめて行う
+// -----------------------------------------------------------------------------
+void Engine::flushObjects()
+{
+    auto sceneManager = SceneManager::getInstance();
+
+    // 非同期読み込みを進め、有効になったシーンの Awake
+    for (GameObject* object : sceneManager->updateLoading())
+    {
+        awake(object);
+    }
+
+    // 追加したものの Awake
+    for (GameObject* object : sceneManager->flushInstantiated())
+    {
+        awake(object);
+    }
+
+    sceneManager->flushDestroyed(Time::time);
+}
+
+
 // 固定時間更新更新
 void Engine::fixedUpdate()
 {
+    UNIDX_PROFILE_SCOPE("FixedUpdate");
     for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
     {
         fixedUpdate(&*it);
@@ -171,6 +379,7 @@ void Engine::fixedUpdate()
 // 物理計算
 void Engine::physics()
 {
+    UNIDX_PROFILE_SCOPE("Physics");
     Physics::getInstance()->simulatePositionCorrection(Time::fixedDeltaTime);
 }
 
@@ -178,6 +387,7 @@ void Engine::physics()
 // 入力更新
 void Engine::input()
 {
+    UNIDX_PROFILE_SCOPE("Input");
     Input::update();
 }
 
@@ -189,10 +399,26 @@ void Engine::input()
 //
 void Engine::update()
 {
+    UNIDX_PROFILE_SCOPE("Update");
+
+    // 頻度制御に使う値をフレームの最初に決めておく
+    updateStart_ = std::chrono::steady_clock::now();
+    updateFrameCount_ = Time::frameCount;
+    deferredUpdates_ = 0;
+    Camera* camera = Camera::main;
+    hasUpdateCamera_ = camera != nullptr;
+    if (hasUpdateCamera_)
+    {
+        updateCameraPosition_ = camera->transform->position;
+    }
+
     // 各コンポーネントの Start()
-    for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
     {
-        checkStart(&*it);
+        UNIDX_PROFILE_SCOPE("Start");
+        for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
+        {
+            checkStart(&*it);
+        }
     }
 
     // 各コンポーネントの Update()
@@ -200,12 +426,87 @@ void Engine::update()
     {
         update(&*it);
     }
+
+    lastDeferredUpdates_ = deferredUpdates_;
+}
+
+
+// -----------------------------------------------------------------------------
+// このフレームで Update() を呼ぶかどうか
+// -----------------------------------------------------------------------------
+bool Engine::shouldUpdate(Behaviour* behaviour)
+{
+    const UpdatePolicy& policy = behaviour->updatePolicy;
+
+    // 間隔の決定
+    int interval = 1;
+    switch (policy.rate)
+    {
+    case UpdateRate_Interval:
+        interval = std::max(policy.interval, 1);
+        break;
+
+    case UpdateRate_Distance:
+        if (hasUpdateCamera_)
+        {
+            int farInterval = std::max(policy.farInterval, 1);
+            Vector3 position = behaviour->transform->position;
+            float distance = Vector3::Distance(updateCameraPosition_, position);
+            if (distance >= policy.farDistance)
+            {
+                interval = farInterval;
+            }
+            else if (distance > policy.nearDistance)
+            {
+                // near から far の間は線形に間隔を広げる
+                float t = (distance - policy.nearDistance) / (policy.farDistance - policy.nearDistance);
+                interval = 1 + int(t * float(farInterval - 1));
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (interval > 1 && !behaviour->updatePending_)
+    {
+        // 登録順に位相をずらして、同じ間隔のものが同じフレームに集中しないようにする
+        if (behaviour->updatePhase_ < 0)
+        {
+            behaviour->updatePhase_ = nextUpdatePhase_;
+            nextUpdatePhase_ = (nextUpdatePhase_ + 1) & 0xffff;
+        }
+        if ((updateFrameCount_ + behaviour->updatePhase_) % interval != 0)
+        {
+            return false;
+        }
+    }
+
+    // 予算を超えていたら優先度の低いものは次のフレームに回す
+    if (policy.priority == UpdatePriority_Low && updateBudget_ > 0.0 && behaviour->deferredFrames_ < MaxDeferredFrames)
+    {
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart_).count();
+        if (elapsed > updateBudget_)
+        {
+            behaviour->updatePending_ = true;
+            behaviour->deferredFrames_++;
+            deferredUpdates_++;
+            return false;
+        }
+    }
+
+    behaviour->updatePending_ = false;
+    behaviour->deferredFrames_ = 0;
+    return true;
 }
 
 
 // 後更新処理
 void Engine::lateUpdate()
 {
+    UNIDX_PROFILE_SCOPE("LateUpdate");
+
     // 各コンポーネントの LateUpdate()
     for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
     {
@@ -221,36 +522,52 @@ void Engine::lateUpdate()
 //
 void Engine::render()
 {
+    UNIDX_PROFILE_SCOPE("Render");
+
     // ライトバッファの更新と転送
-    LightManager::getInstance()->updateLightCBuffer();
+    {
+        UNIDX_PROFILE_SCOPE("Lights");
+        LightManager::getInstance()->updateLightCBuffer();
+    }
 
     Camera* camera = Camera::main;
     if (camera != nullptr)
     {
-        // 不透明描画
-        D3DManager::getInstance()->setCurrentCurrentRenderingMode(RenderingMode_Opaque);
+        // すべての LODGroup の LOD をまとめて選ぶ
+        LODManager::getInstance()->updateLODs(*camera);
 
-
-        // 各コンポーネントの Render
-        for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
+        // 不透明描画
         {
-            render(&*it, *camera);
+            UNIDX_PROFILE_SCOPE("Opaque");
+            D3DManager::getInstance()->setCurrentCurrentRenderingMode(RenderingMode_Opaque);
+
+            // 各コンポーネントの Render
+            for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
+            {
+                render(&*it, *camera);
+            }
         }
     
         // 半透明描画
-        D3DManager::getInstance()->setCurrentCurrentRenderingMode(RenderingMode_Transparent);
-
-        // 各コンポーネントの Render
-        for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
         {
-            render(&*it, *camera);
+            UNIDX_PROFILE_SCOPE("Transparent");
+            D3DManager::getInstance()->setCurrentCurrentRenderingMode(RenderingMode_Transparent);
+
+            // 各コンポーネントの Render
+            for (auto& it : SceneManager::getInstance()->GetActiveScene()->GetRootGameObjects())
+            {
+                render(&*it, *camera);
+            }
         }
     }
 
     // UI
-    for (auto& it : canvas_)
     {
-        it->Render();
+        UNIDX_PROFILE_SCOPE("UI");
+        for (auto& it : canvas_)
+        {
+            it->Render();
+        }
     }
 }
 
@@ -258,12 +575,20 @@ void Engine::render()
 // 終了処理
 void Engine::finalize()
 {
-
+    // ワーカースレッドの停止
+    if (ownsJobSystem_)
+    {
+        JobSystem::destroy();
+        ownsJobSystem_ = false;
+    }
 }
 
 
 void Engine::awake(GameObject* object)
 {
+    // 非アクティブなものは子も含めて処理しない
+    if (!object->activeSelf) return;
+
     // 自身のコンポーネントの中でAwakeを呼び出していないものを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -280,6 +605,9 @@ void Engine::awake(GameObject* object)
 
 void Engine::fixedUpdate(GameObject* object)
 {
+    // 非アクティブなものは子も含めて処理しない
+    if (!object->activeSelf) return;
+
     // アタッチされている各コンポーネントのFixedUpdateを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -300,6 +628,9 @@ void Engine::fixedUpdate(GameObject* object)
 
 void Engine::checkStart(GameObject* object)
 {
+    // 非アクティブなものは子も含めて処理しない
+    if (!object->activeSelf) return;
+
     // 自身のコンポーネントの中でStartを呼び出していないものを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -320,12 +651,18 @@ void Engine::checkStart(GameObject* object)
 
 void Engine::update(GameObject* object)
 {
+    // 非アクティブなものは子も含めて処理しない
+    if (!object->activeSelf) return;
+
     // アタッチされている各コンポーネントのUpdateを呼ぶ
     for (auto& it : object->GetComponents())
     {
         auto behaviour = dynamic_cast<Behaviour*>(it.get());
-        if (behaviour != nullptr && behaviour->enabled)
+        if (behaviour != nullptr && behaviour->enabled && shouldUpdate(behaviour))
         {
+            float time = Time::time;
+            behaviour->updateDeltaTime_ = behaviour->lastUpdateTime_ < 0.0f ? float(Time::deltaTime) : time - behaviour->lastUpdateTime_;
+            behaviour->lastUpdateTime_ = time;
             behaviour->Update();
         }
     }
@@ -340,6 +677,9 @@ void Engine::update(GameObject* object)
 
 void Engine::lateUpdate(GameObject* object)
 {
+    // 非アクティブなものは子も含めて処理しない
+    if (!object->activeSelf) return;
+
     // アタッチされている各コンポーネントのLateUpdateを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -360,6 +700,9 @@ void Engine::lateUpdate(GameObject* object)
 
 void Engine::render(GameObject* object, const Camera& camera)
 {
+    // 非アクティブなものは子も含めて処理しない
+    if (!object->activeSelf) return;
+
     // アタッチされている各コンポーネントのRenderを呼ぶ
     for (auto& it : object->GetComponents())
     {
@@ -0,0 +1,85 @@
+﻿#include "pch.h"
+#include <UniDx/EngineContext.h>
+
+#include <atomic>
+#include <algorithm>
+
+
+namespace UniDx
+{
+
+thread_local EngineContext* EngineContext::current_ = nullptr;
+
+
+EngineContext::~EngineContext()
+{
+    // 破棄中に呼ばれる getInstance() がこのコンテキストを参照するように
+    Scope scope(this);
+
+    // 作成の逆順に破棄
+    // 破棄中に他のシングルトンが destroy() されても壊れないように、取り出してから破棄する
+    while (!creationOrder_.empty())
+    {
+        size_t index = creationOrder_.back();
+        creationOrder_.pop_back();
+        std::unique_ptr<SingletonBase> instance = std::move(slots_[index]);
+        instance = nullptr;
+    }
+    slots_.clear();
+}
+
+
+EngineContext* EngineContext::current()
+{
+    return current_ != nullptr ? current_ : getDefault();
+}
+
+
+void EngineContext::setCurrent(EngineContext* context)
+{
+    current_ = context;
+}
+
+
+EngineContext* EngineContext::getDefault()
+{
+    static EngineContext defaultContext;
+    return &defaultContext;
+}
+
+
+void EngineContext::setSlot(size_t index, std::unique_ptr<SingletonBase> instance)
+{
+    if (slots_.size() <= index)
+    {
+        slots_.resize(index + 1);
+    }
+
+    auto it = std::find(creationOrder_.begin(), creationOrder_.end(), index);
+    if (it != creationOrder_.end())
+    {
+        creationOrder_.erase(it);
+    }
+    if (instance != nullptr)
+    {
+        creationOrder_.push_back(index);
+    }
+
+    slots_[index] = std::move(instance);
+}
+
+
+size_t EngineContext::allocateSlot()
+{
+    static std::atomic<size_t> count = 0;
+    return count.fetch_add(1);
+}
+
+
+// 時間の状態は現在のコンテキストが持つ
+TimeState& Time::state()
+{
+    return EngineContext::current()->time;
+}
+
+} // namespace UniDx
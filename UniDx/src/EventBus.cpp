@@ -0,0 +1,116 @@
+﻿#include "pch.h"
+#include <UniDx/EventBus.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    // 発行スレッドのキューの番号の割り当て
+    // 返された番号は、前のスレッドが残したイベントが配られる前でも使い回してよい
+    // （同じキューに続けて積むだけで、前のスレッドはもう書き込まない）
+    std::mutex slotMutex;
+    std::vector<size_t> freeSlots;
+    size_t nextSlot = 0;
+
+    // スレッドが番号を持ち、終了するときに返す
+    struct ThreadSlotOwner
+    {
+        size_t slot;
+
+        ThreadSlotOwner()
+        {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            if (!freeSlots.empty())
+            {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            else if (nextSlot < EventChannelBase::MaxPublisherThreads)
+            {
+                slot = nextSlot++;
+            }
+            else
+            {
+                // 空きがなければ共有キューを使う
+                slot = EventChannelBase::MaxPublisherThreads;
+            }
+        }
+
+        ~ThreadSlotOwner()
+        {
+            if (slot >= EventChannelBase::MaxPublisherThreads) return;
+
+            std::lock_guard<std::mutex> lock(slotMutex);
+            freeSlots.push_back(slot);
+        }
+    };
+}
+
+
+size_t EventChannelBase::threadSlot()
+{
+    static thread_local const ThreadSlotOwner owner;
+    return owner.slot;
+}
+
+
+size_t EventBus::allocateTypeIndex()
+{
+    static std::atomic<size_t> count = 0;
+    size_t index = count.fetch_add(1);
+    assert(index < MaxEventTypes);
+    return index;
+}
+
+
+EventBus::~EventBus()
+{
+    for (auto& c : channels_)
+    {
+        delete c.load();
+    }
+}
+
+
+void EventBus::unsubscribe(EventListenerHandle handle)
+{
+    if (!handle.isValid())
+    {
+        return;
+    }
+
+    EventChannelBase* c = channels_[handle.type].load(std::memory_order_acquire);
+    if (c != nullptr)
+    {
+        c->unsubscribe(handle.id);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 同期点でまとめて配る
+// -----------------------------------------------------------------------------
+void EventBus::dispatch()
+{
+    // リスナーがイベントを発行し続けても止まるように、回数に上限を設ける
+    constexpr int MaxRounds = 8;
+
+    for (int round = 0; round < MaxRounds; ++round)
+    {
+        bool dispatched = false;
+        for (size_t i = 0; i < usedTypes_.size(); ++i)
+        {
+            EventChannelBase* c = channels_[usedTypes_[i]].load(std::memory_order_acquire);
+            dispatched |= c->dispatch();
+        }
+        if (!dispatched)
+        {
+            return;
+        }
+    }
+    Debug::Log(L"EventBus: イベントの連鎖が多すぎるため、残りは次の同期点で配ります");
+}
+
+} // namespace UniDx
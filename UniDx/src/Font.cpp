@@ -4,6 +4,7 @@
 
 #include <filesystem>
 #include <UniDx/D3DManager.h>
+#include <UniDx/Profiler.h>
 
 
 namespace UniDx
@@ -18,12 +19,45 @@ Font::Font() : Object([this]() { return fileName; })
 
 bool Font::Load(const wchar_t* filePath)
 {
+	UNIDX_PROFILE_SCOPE("Font::Load");
+
+	// ヘッドレスモードでは読み込まない
+	if (!D3DManager::isAvailable())
+	{
+		this->filePath = filePath;
+		fileName = std::filesystem::path(filePath).filename();
+		return true;
+	}
+
 	spriteFont = std::make_unique<DirectX::SpriteFont>(D3DManager::getInstance()->GetDevice().Get(), filePath);
 	std::filesystem::path path(filePath);
 	fileName = path.filename();
+	this->filePath = filePath;
 	return spriteFont != nullptr;
 }
 
+// 読み込み済みのファイルの内容から作る（メインスレッドで呼ぶ）
+bool Font::Create(const wstring& filePath, const std::vector<uint8_t>& data)
+{
+	UNIDX_PROFILE_SCOPE("Font::Create");
+
+	this->filePath = filePath;
+	fileName = std::filesystem::path(filePath).filename();
+
+	// ヘッドレスモードでは作らない
+	if (!D3DManager::isAvailable())
+	{
+		return true;
+	}
+	if (data.empty())
+	{
+		return false;
+	}
+
+	spriteFont = std::make_unique<DirectX::SpriteFont>(D3DManager::getInstance()->GetDevice().Get(), data.data(), data.size());
+	return true;
+}
+
 SpriteFont* Font::getSpriteFont() const
 {
 	return spriteFont.get();
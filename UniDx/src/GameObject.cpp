@@ -1,11 +1,71 @@
 ﻿#include "pch.h"
 
 #include <UniDx/Behaviour.h>
+#include <UniDx/SceneManager.h>
 
 
 namespace UniDx{
 
 
+GameObject::~GameObject()
+{
+	// Destroy() の予約が残っていれば取り消す
+	if (destroyQueued_)
+	{
+		auto sceneManager = SceneManager::getInstance();
+		if (sceneManager != nullptr)
+		{
+			sceneManager->cancelDestroy(this);
+		}
+	}
+}
+
+
+void GameObject::SetActive(bool value)
+{
+	if (active_ == value) return;
+
+	active_ = value;
+	updateActiveInHierarchy();
+}
+
+
+void GameObject::updateActiveInHierarchy()
+{
+	bool parentActive = transform->parent == nullptr || transform->parent->gameObject->activeInHierarchy_;
+	bool active = active_ && parentActive;
+	if (active == activeInHierarchy_) return;
+
+	activeInHierarchy_ = active;
+
+	// 有効なコンポーネントの OnEnable / OnDisable
+	for (auto& c : components)
+	{
+		if (active)
+		{
+			if (!c->isCalledAwake)
+			{
+				c->checkAwake();
+			}
+			else if (c->_enabled)
+			{
+				c->OnEnable();
+			}
+		}
+		else if (c->_enabled && c->isCalledAwake)
+		{
+			c->OnDisable();
+		}
+	}
+
+	// 子に伝える
+	for (auto& child : transform->getChildGameObjects())
+	{
+		child->updateActiveInHierarchy();
+	}
+}
+
+
 void GameObject::onTriggerEnter(Collider* other)
 {
 	for (auto& i : components)
@@ -2,7 +2,19 @@
 #include <UniDx/GltfModel.h>
 
 #include <tiny_gltf.h>
+#include <json.hpp>
 #include <codecvt>
+#include <atomic>
+
+#include <UniDx/Profiler.h>
+#include <UniDx/SceneSerializer.h>
+#include <UniDx/AssetDatabase.h>
+#include <UniDx/MappedFile.h>
+#include <UniDx/MeshCache.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/AccessorDecoder.h>
+#include <UniDx/MeshOptimizer.h>
+#include <UniDx/MeshSimplifier.h>
 
 
 namespace UniDx{
@@ -11,84 +23,302 @@ using namespace std;
 
 namespace {
 
-// tinygltf::Accessor から std::span<T> でデータを取得するヘルパー
+// バッファの中身。GLB ではマップしたファイルの BIN チャンクを指す
+struct BufferData
+{
+    const unsigned char* data;
+    size_t size;
+};
+
+
+// アクセサの参照するデータの先頭と要素の間隔を求める。バッファの範囲外なら nullptr
+const unsigned char* accessorData(
+    const tinygltf::Model& model,
+    const vector<BufferData>& buffers,
+    const tinygltf::Accessor& accessor,
+    size_t elementSize,
+    size_t& stride)
+{
+    if (accessor.bufferView < 0 || accessor.bufferView >= int(model.bufferViews.size())) return nullptr;
+    const auto& bufferView = model.bufferViews[accessor.bufferView];
+    if (bufferView.buffer < 0 || bufferView.buffer >= int(buffers.size())) return nullptr;
+    const BufferData& buffer = buffers[bufferView.buffer];
+
+    // byteStride が 0 なら詰めて並んでいる
+    stride = bufferView.byteStride != 0 ? bufferView.byteStride : elementSize;
+    size_t bytes = accessor.count > 0 ? stride * (accessor.count - 1) + elementSize : 0;
+    if (bufferView.byteOffset + bufferView.byteLength > buffer.size
+        || accessor.byteOffset + bytes > bufferView.byteLength)
+    {
+        return nullptr;
+    }
+    return buffer.data + bufferView.byteOffset + accessor.byteOffset;
+}
+
+
+// 詰めて並んだ float のデータなら、コピーせずにバッファを直接参照する
+template<typename T>
+bool BindAccessorData(
+    const tinygltf::Model& model,
+    const vector<BufferData>& buffers,
+    const tinygltf::Accessor& accessor,
+    int type,
+    std::span<const T>& out)
+{
+    if (accessor.type != type || accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.sparse.isSparse)
+    {
+        return false;
+    }
+    size_t stride;
+    const unsigned char* data = accessorData(model, buffers, accessor, sizeof(T), stride);
+    if (data == nullptr || stride != sizeof(T) || reinterpret_cast<uintptr_t>(data) % alignof(T) != 0)
+    {
+        return false;
+    }
+    out = std::span<const T>(reinterpret_cast<const T*>(data), accessor.count);
+    return true;
+}
+
+
+// tinygltf::Accessor のデータを型を変換しながら std::vector<T> にコピーするヘルパー
+// 間隔の空いたデータや、float 以外（正規化された整数）のデータに使う
+// 変換は AccessorDecoder でまとめて行う
 template<typename T>
 void ReadAccessorData(
     const tinygltf::Model& model,
+    const vector<BufferData>& buffers,
     const tinygltf::Accessor& accessor,
     vector<T>& out)
 {
-    if (accessor.bufferView < 0) return;
-    const auto& bufferView = model.bufferViews[accessor.bufferView];
-    const auto& buffer = model.buffers[bufferView.buffer];
-    size_t offset = bufferView.byteOffset + accessor.byteOffset;
-    size_t count = accessor.count;
-    const unsigned char* data = buffer.data.data() + offset;
-    out.resize(count);
-
-    // 型チェック
-    if constexpr (is_same_v<T, Vector3>) {
-        assert(accessor.type == TINYGLTF_TYPE_VEC3);
-        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-        for (size_t i = 0; i < count; ++i) {
-            const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-            out[i] = Vector3(v[0], v[1], v[2]);
+    constexpr int N = int(sizeof(T) / sizeof(float));
+    int components = tinygltf::GetNumComponentsInType(accessor.type);
+    int componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    if (components <= 0 || componentSize <= 0) return;
+
+    size_t stride;
+    const unsigned char* data = accessorData(model, buffers, accessor, size_t(components * componentSize), stride);
+    if (data == nullptr)
+    {
+        Debug::Log(L"glTF のアクセサがバッファの範囲外です");
+        return;
+    }
+
+    float fill[N] = {};
+    if constexpr (is_same_v<T, Color>) {
+        fill[3] = 1.0f;    // glTFのCOLOR_0はVEC3の場合あり
+    }
+    out.resize(accessor.count);
+    AccessorDecoder::Decode(data, stride, accessor.count, accessor.componentType, accessor.normalized, components,
+        reinterpret_cast<float*>(out.data()), N, fill);
+}
+
+
+// GLB のチャンク
+struct GlbChunks
+{
+    const char* json = nullptr;
+    size_t jsonSize = 0;
+    const unsigned char* bin = nullptr;
+    size_t binSize = 0;
+};
+
+// GLB のヘッダとチャンクを確認する
+bool readGlbChunks(const MappedFile& file, GlbChunks& chunks)
+{
+    auto read32 = [&](size_t offset) { uint32_t v; memcpy(&v, file.data() + offset, 4); return v; };
+
+    if (file.size() < 20 || read32(0) != 0x46546C67 || read32(4) != 2)   // "glTF" バージョン2
+    {
+        return false;
+    }
+    size_t length = std::min(size_t(read32(8)), file.size());
+
+    // 最初のチャンクは JSON
+    size_t jsonLength = read32(12);
+    if (read32(16) != 0x4E4F534A || 20 + jsonLength > length)
+    {
+        return false;
+    }
+    chunks.json = reinterpret_cast<const char*>(file.data() + 20);
+    chunks.jsonSize = jsonLength;
+
+    // 次のチャンクがあれば BIN
+    size_t offset = 20 + ((jsonLength + 3) & ~size_t(3));
+    if (offset + 8 <= length && read32(offset + 4) == 0x004E4942)
+    {
+        size_t binLength = read32(offset);
+        if (offset + 8 + binLength > length)
+        {
+            return false;
         }
+        chunks.bin = reinterpret_cast<const unsigned char*>(file.data() + offset + 8);
+        chunks.binSize = binLength;
     }
-    else if constexpr (is_same_v<T, Vector2>) {
-        assert(accessor.type == TINYGLTF_TYPE_VEC2);
-        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
-        for (size_t i = 0; i < count; ++i) {
-            const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-            out[i] = Vector2(v[0], v[1]);
+    return true;
+}
+
+
+// JSON の値を読むヘルパー
+int jsonInt(const nlohmann::json& o, const char* key, int defaultValue)
+{
+    auto it = o.find(key);
+    return it != o.end() && it->is_number_integer() ? it->get<int>() : defaultValue;
+}
+
+size_t jsonSize(const nlohmann::json& o, const char* key)
+{
+    auto it = o.find(key);
+    return it != o.end() && it->is_number_unsigned() ? it->get<size_t>() : 0;
+}
+
+vector<double> jsonNumbers(const nlohmann::json& o, const char* key)
+{
+    vector<double> result;
+    auto it = o.find(key);
+    if (it != o.end() && it->is_array())
+    {
+        for (const auto& v : *it)
+        {
+            result.push_back(v.is_number() ? v.get<double>() : 0.0);
         }
     }
-    else if constexpr (is_same_v<T, Color>) {
-        // glTFのCOLOR_0はfloat4またはubyte4
-        if (accessor.type == TINYGLTF_TYPE_VEC3 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-            for (size_t i = 0; i < count; ++i) {
-                const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-                out[i] = Color(v[0], v[1], v[2], 1.0f);
-            }
+    return result;
+}
+
+vector<int> jsonInts(const nlohmann::json& o, const char* key)
+{
+    vector<int> result;
+    auto it = o.find(key);
+    if (it != o.end() && it->is_array())
+    {
+        for (const auto& v : *it)
+        {
+            result.push_back(v.is_number_integer() ? v.get<int>() : -1);
         }
-        else if (accessor.type == TINYGLTF_TYPE_VEC4 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-            for (size_t i = 0; i < count; ++i) {
-                const float* v = reinterpret_cast<const float*>(data + i * bufferView.byteStride);
-                out[i] = Color(v[0], v[1], v[2], v[3]);
-            }
+    }
+    return result;
+}
+
+const nlohmann::json& jsonArray(const nlohmann::json& o, const char* key)
+{
+    static const nlohmann::json empty = nlohmann::json::array();
+    auto it = o.find(key);
+    return it != o.end() && it->is_array() ? *it : empty;
+}
+
+
+// GLB の JSON チャンクから、モデルの作成に使う部分だけを読む
+// バッファの中身と画像は読まない
+// BIN チャンク以外のバッファ（外部ファイルや data URI）を使っていれば false
+bool parseGlbJson(const GlbChunks& chunks, tinygltf::Model& model)
+{
+    nlohmann::json root = nlohmann::json::parse(chunks.json, chunks.json + chunks.jsonSize, nullptr, false);
+    if (root.is_discarded() || !root.is_object())
+    {
+        return false;
+    }
+
+    for (const auto& o : jsonArray(root, "buffers"))
+    {
+        if (o.contains("uri") || jsonSize(o, "byteLength") > chunks.binSize)
+        {
+            return false;
         }
-        else if (accessor.type == TINYGLTF_TYPE_VEC4 && accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-            for (size_t i = 0; i < count; ++i) {
-                const uint8_t* v = reinterpret_cast<const uint8_t*>(data + i * bufferView.byteStride);
-                out[i] = Color(
-                    v[0] / 255.0f, v[1] / 255.0f, v[2] / 255.0f, v[3] / 255.0f);
+        model.buffers.emplace_back();
+    }
+
+    for (const auto& o : jsonArray(root, "bufferViews"))
+    {
+        tinygltf::BufferView& view = model.bufferViews.emplace_back();
+        view.buffer = jsonInt(o, "buffer", -1);
+        view.byteOffset = jsonSize(o, "byteOffset");
+        view.byteLength = jsonSize(o, "byteLength");
+        view.byteStride = jsonSize(o, "byteStride");
+    }
+
+    for (const auto& o : jsonArray(root, "accessors"))
+    {
+        static const pair<const char*, int> types[] = {
+            { "SCALAR", TINYGLTF_TYPE_SCALAR }, { "VEC2", TINYGLTF_TYPE_VEC2 }, { "VEC3", TINYGLTF_TYPE_VEC3 },
+            { "VEC4", TINYGLTF_TYPE_VEC4 }, { "MAT2", TINYGLTF_TYPE_MAT2 }, { "MAT3", TINYGLTF_TYPE_MAT3 }, { "MAT4", TINYGLTF_TYPE_MAT4 } };
+
+        tinygltf::Accessor& accessor = model.accessors.emplace_back();
+        accessor.bufferView = jsonInt(o, "bufferView", -1);
+        accessor.byteOffset = jsonSize(o, "byteOffset");
+        accessor.componentType = jsonInt(o, "componentType", -1);
+        accessor.count = jsonSize(o, "count");
+        accessor.normalized = o.value("normalized", false);
+        accessor.sparse.isSparse = o.contains("sparse");
+        accessor.type = -1;
+        string type = o.value("type", string());
+        for (const auto& [name, value] : types)
+        {
+            if (type == name) accessor.type = value;
+        }
+    }
+
+    for (const auto& o : jsonArray(root, "meshes"))
+    {
+        tinygltf::Mesh& mesh = model.meshes.emplace_back();
+        for (const auto& p : jsonArray(o, "primitives"))
+        {
+            tinygltf::Primitive& primitive = mesh.primitives.emplace_back();
+            primitive.indices = jsonInt(p, "indices", -1);
+            primitive.mode = jsonInt(p, "mode", TINYGLTF_MODE_TRIANGLES);
+            if (auto it = p.find("attributes"); it != p.end() && it->is_object())
+            {
+                for (const auto& [name, index] : it->items())
+                {
+                    primitive.attributes[name] = index.is_number_integer() ? index.get<int>() : -1;
+                }
             }
         }
     }
-}
 
-}
+    for (const auto& o : jsonArray(root, "nodes"))
+    {
+        tinygltf::Node& node = model.nodes.emplace_back();
+        node.name = o.value("name", string());
+        node.mesh = jsonInt(o, "mesh", -1);
+        node.children = jsonInts(o, "children");
+        node.matrix = jsonNumbers(o, "matrix");
+        node.translation = jsonNumbers(o, "translation");
+        node.rotation = jsonNumbers(o, "rotation");
+        node.scale = jsonNumbers(o, "scale");
+    }
 
+    for (const auto& o : jsonArray(root, "scenes"))
+    {
+        model.scenes.emplace_back().nodes = jsonInts(o, "nodes");
+    }
+    model.defaultScene = jsonInt(root, "scene", -1);
 
-// -----------------------------------------------------------------------------
-// node生成
-// -----------------------------------------------------------------------------
-void GltfModel::createNodeRecursive(const tinygltf::Model& model,
-    int nodeIndex,
-    GameObject* parentGO)
+    for (const auto& o : jsonArray(root, "samplers"))
+    {
+        tinygltf::Sampler& sampler = model.samplers.emplace_back();
+        sampler.wrapS = jsonInt(o, "wrapS", TINYGLTF_TEXTURE_WRAP_REPEAT);
+        sampler.wrapT = jsonInt(o, "wrapT", TINYGLTF_TEXTURE_WRAP_REPEAT);
+    }
+
+    for (const auto& o : jsonArray(root, "textures"))
+    {
+        model.textures.emplace_back().sampler = jsonInt(o, "sampler", -1);
+    }
+    return true;
+}
 
+
+// ノードを親が子より先に来る順に並べる
+void appendNodeRecursive(const tinygltf::Model& model, int nodeIndex, int parent, vector<GltfModelAsset::Node>& nodes)
 {
     const tinygltf::Node& node = model.nodes[nodeIndex];
-    assert(parentGO);
 
-        // GameObject を作成
-    unique_ptr<GameObject> go = make_unique<GameObject>();
-    go->SetName( UniDx::ToUtf16(node.name) );
+    GltfModelAsset::Node result;
+    result.name = UniDx::ToUtf16(node.name);
+    result.parent = parent;
+    result.mesh = node.mesh >= 0 && node.mesh < int(model.meshes.size()) ? node.mesh : -1;
 
     // 行列を取得
-    Vector3 position;
-    Vector3 scale;
-    Quaternion rotation;
     if (!node.matrix.empty())
     {
         // 4x4行列が直接指定されている場合は
@@ -98,196 +328,614 @@ void GltfModel::createNodeRecursive(const tinygltf::Model& model,
         {
             reinterpret_cast<float*>(&matrix)[i] = static_cast<float>(node.matrix[i]);
         }
-        matrix.Decompose(scale, rotation, position);
+        matrix.Decompose(result.scale, result.rotation, result.position);
     }
     else {
         // translation/rotation/scaleから合成
-        position = node.translation.size() == 3 ? Vector3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]) : Vector3::Zero;
-        rotation = node.rotation.size() == 4 ? Quaternion((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]) : Quaternion::Identity;
-        scale = node.scale.size() == 3 ? Vector3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]) : Vector3::One;
+        result.position = node.translation.size() == 3 ? Vector3((float)node.translation[0], (float)node.translation[1], (float)node.translation[2]) : Vector3::Zero;
+        result.rotation = node.rotation.size() == 4 ? Quaternion((float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2], (float)node.rotation[3]) : Quaternion::Identity;
+        result.scale = node.scale.size() == 3 ? Vector3((float)node.scale[0], (float)node.scale[1], (float)node.scale[2]) : Vector3::One;
     }
-    go->transform->localScale = scale;
-    go->transform->localRotation = rotation;
-    go->transform->localPosition = position;
 
-    // メッシュを持っていればアタッチ
-    if (node.mesh >= 0 && node.mesh < submesh.size())
+    int index = int(nodes.size());
+    nodes.push_back(std::move(result));
+
+    // 子ノードを再帰
+    for (int child : node.children)
     {
-        auto* r = go->AddComponent<MeshRenderer>();
-        renderer.push_back(r);
-        r->mesh.submesh.push_back(submesh[node.mesh]);
+        if (child < 0 || child >= int(model.nodes.size())) continue;
+        appendNodeRecursive(model, child, index, nodes);
+    }
+}
+
+// glTF のラップモードを DirectX のアドレッシングモードへ
+D3D11_TEXTURE_ADDRESS_MODE ToDXAddr(int wrap)
+{
+    switch (wrap) {
+    case 10497: return D3D11_TEXTURE_ADDRESS_WRAP;   // GL_REPEAT
+    case 33648: return D3D11_TEXTURE_ADDRESS_MIRROR; // GL_MIRRORED_REPEAT
+    case 33071: return D3D11_TEXTURE_ADDRESS_CLAMP;  // GL_CLAMP_TO_EDGE
+    default:    return D3D11_TEXTURE_ADDRESS_WRAP;
     }
+}
 
-    // 親を設定
-    GameObject* ptr = go.get();
-    if (parentGO)
+
+// プリミティブのデコードの単位
+// 書き込み先がそれぞれ別なので、どの順番・どのスレッドで実行しても結果は同じになる
+enum DecodeStream
+{
+    DecodeStream_Position,
+    DecodeStream_Normal,
+    DecodeStream_Color,
+    DecodeStream_UV,
+    DecodeStream_UV2,
+    DecodeStream_UV3,
+    DecodeStream_UV4,
+    DecodeStream_Index,
+    DecodeStream_Count
+};
+
+// 並列にデコードするか
+std::atomic<bool> parallelDecode = true;
+
+
+// アクセサが無効なら nullptr
+const tinygltf::Accessor* findAttribute(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const char* name)
+{
+    auto it = primitive.attributes.find(name);
+    if (it == primitive.attributes.end() || it->second < 0 || it->second >= int(model.accessors.size())) return nullptr;
+    return &model.accessors[it->second];
+}
+
+
+// 属性をひとつデコードする
+// マップしたファイルを直接参照できなければ、変換して OwnedSubMesh の配列に入れる
+template<typename T>
+void decodeAttribute(
+    const tinygltf::Model& model,
+    const vector<BufferData>& buffers,
+    bool mapped,
+    const tinygltf::Primitive& primitive,
+    const char* name,
+    int type,
+    OwnedSubMesh& sub,
+    std::span<const T>& target,
+    void (OwnedSubMesh::*resize)(size_t),
+    const vector<T>& (OwnedSubMesh::*storage)())
+{
+    const tinygltf::Accessor* accessor = findAttribute(model, primitive, name);
+    if (accessor == nullptr || (mapped && BindAccessorData(model, buffers, *accessor, type, target)))
     {
-        Transform::SetParent(move(go), parentGO->transform);
+        return;
     }
+    (sub.*resize)(accessor->count);
+    ReadAccessorData(model, buffers, *accessor, const_cast<vector<T>&>((sub.*storage)()));
+}
 
-    // 子ノードを再帰
-    for (int child : node.children)
+
+// インデックスをデコードする
+void decodeIndices(
+    const tinygltf::Model& model,
+    const vector<BufferData>& buffers,
+    bool mapped,
+    const tinygltf::Primitive& primitive,
+    OwnedSubMesh& sub)
+{
+    if (primitive.indices < 0 || primitive.indices >= int(model.accessors.size()))
+    {
+        return;
+    }
+
+    const auto& accessor = model.accessors[primitive.indices];
+    size_t componentSize = size_t(std::max(tinygltf::GetComponentSizeInBytes(accessor.componentType), 0));
+    size_t stride;
+    const unsigned char* data = componentSize > 0 ? accessorData(model, buffers, accessor, componentSize, stride) : nullptr;
+
+    if (data == nullptr) {
+        Debug::Log(L"glTF のインデックスがバッファの範囲外です");
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT && mapped
+        && stride == sizeof(uint32_t) && reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) == 0) {
+        // 32bit index はそのまま参照
+        sub.indices = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(data), accessor.count);
+    }
+    else {
+        sub.resizeIndices(accessor.count);
+        auto& indices = const_cast<std::vector<uint32_t>&>(sub.mutableIndices());
+
+        if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
+            // 32bit index
+            memcpy(indices.data(), data, accessor.count * sizeof(uint32_t));
+        }
+        else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+            // 16bit index → 32bitへ変換
+            for (size_t i = 0; i < accessor.count; ++i) {
+                uint16_t index;
+                memcpy(&index, data + i * sizeof(uint16_t), sizeof(uint16_t));
+                indices[i] = index;
+            }
+        }
+        else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+            // 8bit index → 32bitへ変換
+            for (size_t i = 0; i < accessor.count; ++i) {
+                indices[i] = data[i];
+            }
+        }
+    }
+}
+
+
+// プリミティブの指定したストリームをデコードする
+void decodeStream(
+    const tinygltf::Model& model,
+    const vector<BufferData>& buffers,
+    bool mapped,
+    const tinygltf::Primitive& primitive,
+    int stream,
+    OwnedSubMesh& sub,
+    Bounds& bounds)
+{
+    switch (stream)
     {
-        createNodeRecursive(model, child, ptr);
+    case DecodeStream_Position:
+        decodeAttribute(model, buffers, mapped, primitive, "POSITION", TINYGLTF_TYPE_VEC3, sub, sub.positions,
+            &OwnedSubMesh::resizePositions, &OwnedSubMesh::mutablePositions);
+
+        // 頂点の範囲
+        bounds = Bounds(Vector3::Zero, Vector3::Zero);
+        if (!sub.positions.empty())
+        {
+            Vector3 mn = sub.positions[0];
+            Vector3 mx = sub.positions[0];
+            for (const Vector3& p : sub.positions)
+            {
+                mn = Vector3::Min(mn, p);
+                mx = Vector3::Max(mx, p);
+            }
+            bounds.SetMinMax(mn, mx);
+        }
+        break;
+    case DecodeStream_Normal:
+        decodeAttribute(model, buffers, mapped, primitive, "NORMAL", TINYGLTF_TYPE_VEC3, sub, sub.normals,
+            &OwnedSubMesh::resizeNormals, &OwnedSubMesh::mutableNormals);
+        break;
+    case DecodeStream_Color:
+        decodeAttribute(model, buffers, mapped, primitive, "COLOR_0", TINYGLTF_TYPE_VEC4, sub, sub.colors,
+            &OwnedSubMesh::resizeColors, &OwnedSubMesh::mutableColors);
+        break;
+    case DecodeStream_UV:
+        decodeAttribute(model, buffers, mapped, primitive, "TEXCOORD_0", TINYGLTF_TYPE_VEC2, sub, sub.uv,
+            &OwnedSubMesh::resizeUV, &OwnedSubMesh::mutableUV);
+        break;
+    case DecodeStream_UV2:
+        decodeAttribute(model, buffers, mapped, primitive, "TEXCOORD_1", TINYGLTF_TYPE_VEC2, sub, sub.uv2,
+            &OwnedSubMesh::resizeUV2, &OwnedSubMesh::mutableUV2);
+        break;
+    case DecodeStream_UV3:
+        decodeAttribute(model, buffers, mapped, primitive, "TEXCOORD_2", TINYGLTF_TYPE_VEC2, sub, sub.uv3,
+            &OwnedSubMesh::resizeUV3, &OwnedSubMesh::mutableUV3);
+        break;
+    case DecodeStream_UV4:
+        decodeAttribute(model, buffers, mapped, primitive, "TEXCOORD_3", TINYGLTF_TYPE_VEC2, sub, sub.uv4,
+            &OwnedSubMesh::resizeUV4, &OwnedSubMesh::mutableUV4);
+        break;
+    case DecodeStream_Index:
+        decodeIndices(model, buffers, mapped, primitive, sub);
+        break;
     }
 }
 
+}
+
 
 // -----------------------------------------------------------------------------
-// gltfファイルを読み込み
+// gltfファイルを読み込んで、ノードの階層、サブメッシュと頂点バッファを作る
 // -----------------------------------------------------------------------------
-bool GltfModel::load_(const wstring& filePath)
+shared_ptr<GltfModelAsset> GltfModelAsset::parse(const wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout)
 {
+    UNIDX_PROFILE_SCOPE("GltfModelAsset::parse");
     Debug::Log(filePath);
 
-    model = make_unique<tinygltf::Model>();
-    tinygltf::TinyGLTF loader;
-    string err, warn;
-
-    auto path = ToUtf8(filePath);
+    // glTF のデータはこの関数を抜けると解放される
+    auto gltf = make_unique<tinygltf::Model>();
+    tinygltf::Model* model = gltf.get();
+    vector<BufferData> buffers;
 
-    bool ok = loader.LoadBinaryFromFile(model.get(), &err, &warn, path.c_str());
-    if (!warn.empty())
+    // GLB はファイルをマップして JSON チャンクだけを解析し、
+    // 頂点とインデックスは BIN チャンクを直接参照する
+    auto file = make_shared<MappedFile>();
+    GlbChunks chunks;
+    if (file->open(filePath) && readGlbChunks(*file, chunks) && parseGlbJson(chunks, *model))
     {
-        Debug::Log(warn);
+        buffers.assign(model->buffers.size(), BufferData{ chunks.bin, chunks.binSize });
     }
-    if (!ok)
+    else
     {
-        Debug::Log(err);
-        return false;
+        // 外部のバッファを使っている場合などは tinygltf で全体を読む
+        file.reset();
+        *model = tinygltf::Model();
+
+        tinygltf::TinyGLTF loader;
+        string err, warn;
+
+        auto path = ToUtf8(filePath);
+
+        bool ok = loader.LoadBinaryFromFile(model, &err, &warn, path.c_str());
+        if (!warn.empty())
+        {
+            Debug::Log(warn);
+        }
+        if (!ok)
+        {
+            Debug::Log(err);
+            return nullptr;
+        }
+        for (const auto& buffer : model->buffers)
+        {
+            buffers.push_back(BufferData{ buffer.data.data(), buffer.data.size() });
+        }
     }
 
-    // Meshの生成
-    submesh.clear();
+    // 直接参照できるのはマップしたファイルだけ
+    const bool mapped = file != nullptr;
 
+    auto asset = make_shared<GltfModelAsset>();
+    asset->filePath_ = filePath;
+    asset->layout_ = layout;
+
+    // Meshの生成
+    // プリミティブを並べてから、プリミティブとストリームの組ごとにワーカースレッドでデコードする
+    vector<const tinygltf::Primitive*> primitives;
     for (const auto& gltfMesh : model->meshes)
     {
+        asset->meshes_.push_back(MeshRange{ uint32_t(primitives.size()), uint32_t(gltfMesh.primitives.size()) });
         for (const auto& primitive : gltfMesh.primitives)
         {
-            auto sub = make_shared<OwnedSubMesh>();
+            primitives.push_back(&primitive);
+        }
+    }
 
-            // POSITION
-            if (auto it = primitive.attributes.find("POSITION"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizePositions(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector3>&>(sub->mutablePositions()));
-            }
+    vector<shared_ptr<OwnedSubMesh>> subMeshes(primitives.size());
+    for (auto& sub : subMeshes)
+    {
+        sub = make_shared<OwnedSubMesh>();
+    }
+    asset->bounds_.resize(primitives.size());
 
-            // NORMAL
-            if (auto it = primitive.attributes.find("NORMAL"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeNormals(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector3>&>(sub->mutableNormals()));
-            }
+    auto decode = [&](size_t begin, size_t end)
+    {
+        UNIDX_PROFILE_SCOPE("GltfModelAsset::decode");
+        for (size_t i = begin; i < end; ++i)
+        {
+            size_t p = i / DecodeStream_Count;
+            decodeStream(*model, buffers, mapped, *primitives[p], int(i % DecodeStream_Count), *subMeshes[p], asset->bounds_[p]);
+        }
+    };
+    size_t taskCount = primitives.size() * DecodeStream_Count;
+    JobSystem* jobs = JobSystem::getInstance();
+    if (isParallelDecode() && jobs != nullptr && jobs->getWorkerCount() > 0)
+    {
+        jobs->parallelFor(0, taskCount, decode);
+    }
+    else
+    {
+        decode(0, taskCount);
+    }
 
-            // COLOR_0
-            if (auto it = primitive.attributes.find("COLOR_0"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeColors(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Color>&>(sub->mutableColors()));
+    // 有効なら、三角形と頂点を描きやすい順に並べ替え、簡略化した LOD を作る
+    const bool optimizeMesh = MeshOptimizer::isEnabled();
+    const int lodCount = MeshSimplifier::getImportLODCount();
+    if (optimizeMesh || lodCount > 0)
+    {
+        auto optimize = [&](size_t begin, size_t end)
+        {
+            UNIDX_PROFILE_SCOPE("GltfModelAsset::optimize");
+            for (size_t i = begin; i < end; ++i)
+            {
+                subMeshes[i]->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+                if (optimizeMesh)
+                {
+                    MeshOptimizer::Optimize(*subMeshes[i]);
+                }
+                if (lodCount > 0)
+                {
+                    MeshSimplifier::GenerateLODs(*subMeshes[i], lodCount);
+                }
             }
+        };
+        if (isParallelDecode() && jobs != nullptr && jobs->getWorkerCount() > 0)
+        {
+            jobs->parallelFor(0, subMeshes.size(), optimize, 1);
+        }
+        else
+        {
+            optimize(0, subMeshes.size());
+        }
+    }
 
-            // TEXCOORD_0
-            if (auto it = primitive.attributes.find("TEXCOORD_0"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV()));
-            }
-            // TEXCOORD_1
-            if (auto it = primitive.attributes.find("TEXCOORD_1"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV2(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV2()));
-            }
-            // TEXCOORD_2
-            if (auto it = primitive.attributes.find("TEXCOORD_2"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV3(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV3()));
+    // 頂点バッファは createBuffers() でプリミティブの順に作る
+    // マップしたファイルを指すサブメッシュは、ファイルを自分で保持する
+    for (auto& sub : subMeshes)
+    {
+        sub->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        sub->mappedFile = file;
+        asset->submesh_.push_back(sub);
+    }
+
+    // ノードの階層
+    if (!model->scenes.empty())
+    {
+        int sceneIndex = model->defaultScene >= 0 && model->defaultScene < int(model->scenes.size()) ? model->defaultScene : 0;
+        for (int nodeIndex : model->scenes[sceneIndex].nodes)
+        {
+            if (nodeIndex >= 0 && nodeIndex < int(model->nodes.size()))
+            {
+                appendNodeRecursive(*model, nodeIndex, -1, asset->nodes_);
             }
-            // TEXCOORD_3
-            if (auto it = primitive.attributes.find("TEXCOORD_3"); it != primitive.attributes.end()) {
-                const auto& accessor = model->accessors[it->second];
-                sub->resizeUV4(accessor.count);
-                ReadAccessorData(*model, accessor, const_cast<vector<Vector2>&>(sub->mutableUV4()));
+        }
+    }
+
+    // テクスチャのラップモード
+    for (const auto& tex : model->textures)
+    {
+        int samplerIndex = tex.sampler; // -1 の場合あり
+        if (samplerIndex >= 0 && samplerIndex < int(model->samplers.size()))
+        {
+            const tinygltf::Sampler& sampler = model->samplers[samplerIndex];
+            asset->textureWraps_.push_back(TextureWrap{ ToDXAddr(sampler.wrapS), ToDXAddr(sampler.wrapT) });
+        }
+        else
+        {
+            // デフォルト扱い（REPEAT）
+            asset->textureWraps_.push_back(TextureWrap{ D3D11_TEXTURE_ADDRESS_WRAP, D3D11_TEXTURE_ADDRESS_WRAP });
+        }
+    }
+
+    return asset;
+}
+
+
+// -----------------------------------------------------------------------------
+// 読み込み
+// 同じファイルと頂点の型で読み込み済みなら共有する
+// -----------------------------------------------------------------------------
+shared_ptr<const GltfModelAsset> GltfModelAsset::Load(const wstring& filePath, const SceneVertexType& vertex)
+{
+    return AssetDatabase::getInstance()->Load<GltfModelAsset>(filePath, uint64_t(uintptr_t(vertex.layout)),
+        [&]() -> shared_ptr<GltfModelAsset>
+        {
+            auto asset = Decode(filePath, vertex);
+            if (asset != nullptr)
+            {
+                asset->createBuffers();
             }
+            return asset;
+        });
+}
 
-            // indices
-            if (primitive.indices >= 0) {
-                const auto& accessor = model->accessors[primitive.indices];
-                sub->resizeIndices(accessor.count);
-                auto& indices = const_cast<std::vector<uint32_t>&>(sub->mutableIndices());
 
-                const auto& bufferView = model->bufferViews[accessor.bufferView];
-                const auto& buffer = model->buffers[bufferView.buffer];
-                size_t offset = bufferView.byteOffset + accessor.byteOffset;
-                const unsigned char* data = buffer.data.data() + offset;
+shared_ptr<GltfModelAsset> GltfModelAsset::Decode(const wstring& filePath, const SceneVertexType& vertex)
+{
+    // 変換済みのファイルが新しければ、glTF を解析しない
+    auto asset = MeshCache::Load(filePath, vertex);
+    if (asset == nullptr)
+    {
+        asset = parse(filePath, vertex.layout);
+        if (asset != nullptr)
+        {
+            MeshCache::Save(*asset, vertex);
+        }
+    }
+    if (asset != nullptr)
+    {
+        asset->createBuffer_ = vertex.createBuffer;
+    }
+    return asset;
+}
 
-                if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-                    // 32bit index
-                    memcpy(indices.data(), data, accessor.count * sizeof(uint32_t));
-                }
-                else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-                    // 16bit index → 32bitへ変換
-                    for (size_t i = 0; i < accessor.count; ++i) {
-                        indices[i] = reinterpret_cast<const uint16_t*>(data)[i];
-                    }
-                }
-                else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-                    // 8bit index → 32bitへ変換
-                    for (size_t i = 0; i < accessor.count; ++i) {
-                        indices[i] = data[i];
-                    }
-                }
+
+shared_ptr<const GltfModelAsset> GltfModelAsset::Register(shared_ptr<GltfModelAsset> decoded)
+{
+    if (decoded == nullptr)
+    {
+        return nullptr;
+    }
+    return AssetDatabase::getInstance()->Load<GltfModelAsset>(decoded->filePath_, uint64_t(uintptr_t(decoded->layout_)),
+        [&]() -> shared_ptr<GltfModelAsset>
+        {
+            decoded->createBuffers();
+            return decoded;
+        });
+}
+
+
+void GltfModelAsset::createBuffers()
+{
+    UNIDX_PROFILE_SCOPE("GltfModelAsset::createBuffers");
+
+    for (size_t i = 0; i < submesh_.size(); ++i)
+    {
+        SubMesh* sub = submesh_[i].get();
+        if (packedVertices_.empty())
+        {
+            createBuffer_(sub);
+            continue;
+        }
+
+        // 変換済みのファイルの詰めた頂点からそのまま作る
+        if (packedVertices_[i] != nullptr)
+        {
+            sub->createVertexBuffer(const_cast<std::byte*>(packedVertices_[i]));
+        }
+        if (!sub->indices.empty())
+        {
+            sub->createIndexBuffer();
+        }
+    }
+    packedVertices_.clear();
+}
+
+
+void GltfModelAsset::setParallelDecode(bool enabled)
+{
+    parallelDecode = enabled;
+}
+
+
+bool GltfModelAsset::isParallelDecode()
+{
+    return parallelDecode;
+}
+
+
+bool GltfModelAsset::getAddressModeUV(int texIndex, D3D11_TEXTURE_ADDRESS_MODE& u, D3D11_TEXTURE_ADDRESS_MODE& v) const
+{
+    if (texIndex < 0 || texIndex >= int(textureWraps_.size()))
+    {
+        return false;
+    }
+    u = textureWraps_[texIndex].u;
+    v = textureWraps_[texIndex].v;
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// ノードの GameObject を作る
+// サブメッシュと頂点バッファは参照するだけで、コピーしない
+// -----------------------------------------------------------------------------
+void GltfModelAsset::Instantiate(GameObject* parent, vector<GameObject*>& roots, vector<MeshRenderer*>& renderers) const
+{
+    UNIDX_PROFILE_SCOPE("GltfModelAsset::Instantiate");
+    assert(parent);
+
+    vector<GameObject*> created(nodes_.size(), nullptr);
+    for (size_t i = 0; i < nodes_.size(); ++i)
+    {
+        const Node& node = nodes_[i];
+
+        // GameObject を作成
+        unique_ptr<GameObject> go = make_unique<GameObject>();
+        go->SetName(node.name);
+        go->transform->localScale = node.scale;
+        go->transform->localRotation = node.rotation;
+        go->transform->localPosition = node.position;
+
+        // メッシュを持っていればアタッチ（プリミティブごとのサブメッシュをすべて）
+        if (node.mesh >= 0)
+        {
+            auto* r = go->AddComponent<MeshRenderer>();
+            renderers.push_back(r);
+            const MeshRange& range = meshes_[node.mesh];
+            for (uint32_t s = range.first; s < range.first + range.count; ++s)
+            {
+                r->mesh.submesh.push_back(submesh_[s]);
             }
+        }
 
-            sub->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-            submesh.push_back(sub);
+        // 親を設定
+        GameObject* ptr = go.get();
+        GameObject* parentGO = node.parent >= 0 ? created[node.parent] : parent;
+        Transform::SetParent(move(go), parentGO->transform);
+        if (node.parent < 0)
+        {
+            roots.push_back(ptr);
         }
+        created[i] = ptr;
     }
+}
 
-    // ノードから階層構造を作りながら姿勢を取得
-    int sceneIndex = model->defaultScene >= 0 ? model->defaultScene : 0;
-    const auto& scene = model->scenes[sceneIndex];
-    for (int nodeIndex : scene.nodes)
+
+// -----------------------------------------------------------------------------
+// 読み込み済みのモデルからノードを作る
+// -----------------------------------------------------------------------------
+bool GltfModel::Load(shared_ptr<const GltfModelAsset> asset)
+{
+    UNIDX_PROFILE_SCOPE("GltfModel::load");
+
+    model = std::move(asset);
+    if (model == nullptr)
     {
-        createNodeRecursive(*model.get(), nodeIndex, gameObject);
+        return false;
     }
+    model->Instantiate(gameObject, nodes_, renderer);
     return true;
 }
 
 
+// -----------------------------------------------------------------------------
+// このモデルの指定インデクスのテクスチャのラップモード
+// -----------------------------------------------------------------------------
+void GltfModel::GetAddressModeUV(int texIndex, D3D11_TEXTURE_ADDRESS_MODE& u, D3D11_TEXTURE_ADDRESS_MODE& v) const
+{
+    u = D3D11_TEXTURE_ADDRESS_WRAP;
+    v = D3D11_TEXTURE_ADDRESS_WRAP;
+    if (model != nullptr)
+    {
+        model->getAddressModeUV(texIndex, u, v);
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // Textureのラップモードをこのモデルの指定インデクスのテクスチャ設定に合わせる
 // -----------------------------------------------------------------------------
 void GltfModel::SetAddressModeUV(Texture* texture, int texIndex) const
 {
-    const tinygltf::Texture& tex = model->textures[texIndex];
+    D3D11_TEXTURE_ADDRESS_MODE u, v;
+    GetAddressModeUV(texIndex, u, v);
+    texture->wrapModeU = u;
+    texture->wrapModeV = v;
+}
+
+
+
+// -----------------------------------------------------------------------------
+// シーンファイルへの書き出しと読み込み
+// -----------------------------------------------------------------------------
+void GltfModel::Serialize(SceneWriter& writer) const
+{
+    writer.writeString(model != nullptr ? model->getFilePath() : wstring());
+    writer.writeVertexType(model != nullptr ? model->getVertexLayout() : nullptr);
+    writer.write(uint32_t(materials.size()));
+    for (auto& material : materials)
+    {
+        writer.writeMaterial(material);
+    }
 
-    int samplerIndex = tex.sampler; // -1 の場合あり
-    tinygltf::Sampler sampler;
-    if (samplerIndex >= 0 && samplerIndex < model->samplers.size()) {
-        sampler = model->samplers[samplerIndex];
+    for (GameObject* node : nodes_)
+    {
+        writer.excludeChild(node);
     }
-    else {
-        // デフォルト扱い
-        sampler.wrapS = 10497; // REPEAT
-        sampler.wrapT = 10497; // REPEAT
-        sampler.magFilter = -1; // 未指定
-        sampler.minFilter = -1; // 未指定
-    }
-
-    // 例: DirectX のアドレッシングモードへマッピング
-    auto ToDXAddr = [](int wrap) {
-        switch (wrap) {
-        case 10497: return D3D11_TEXTURE_ADDRESS_WRAP;   // GL_REPEAT
-        case 33648: return D3D11_TEXTURE_ADDRESS_MIRROR; // GL_MIRRORED_REPEAT
-        case 33071: return D3D11_TEXTURE_ADDRESS_CLAMP;  // GL_CLAMP_TO_EDGE
-        default:    return D3D11_TEXTURE_ADDRESS_WRAP;
+}
+
+
+void GltfModel::Deserialize(SceneReader& reader)
+{
+    wstring path(reader.readString());
+    const SceneVertexType* vertex = reader.readVertexType();
+
+    vector<shared_ptr<Material>> loadMaterials;
+    uint32_t count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < count && !reader.hasFailed(); ++i)
+    {
+        if (auto material = reader.readMaterial())
+        {
+            loadMaterials.push_back(material);
         }
-    };
-    texture->wrapModeU = ToDXAddr(sampler.wrapS);
-    texture->wrapModeV = ToDXAddr(sampler.wrapT);
+    }
+
+    if (path.empty() || vertex == nullptr)
+    {
+        return;
+    }
+
+    // モデルを読み込んでノードを作り直す（シーンの読み込み中ならデコードは済んでいる）
+    Load(reader.loadModel(path, *vertex));
+    for (auto& material : loadMaterials)
+    {
+        AddMaterial(material);
+    }
 }
 
 }
@@ -47,13 +47,16 @@ void Image::OnEnable()
 {
 	UIBehaviour::OnEnable();
 
-	// sp̒萔obt@
-	D3D11_BUFFER_DESC desc{};
-	desc.ByteWidth = sizeof(VSConstantBuffer0);
-	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	desc.CPUAccessFlags = 0;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBuffer0.GetAddressOf());
+	// sp̒萔obt@iwbhX[hł͍Ȃj
+	if (D3DManager::isAvailable())
+	{
+		D3D11_BUFFER_DESC desc{};
+		desc.ByteWidth = sizeof(VSConstantBuffer0);
+		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		desc.CPUAccessFlags = 0;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		D3DManager::getInstance()->GetDevice()->CreateBuffer(&desc, nullptr, constantBuffer0.GetAddressOf());
+	}
 
 	mesh->positions = std::span<const Vector3>(image_positions, std::size(image_positions));
 	mesh->uv = std::span<const Vector2>(image_uvs, std::size(image_uvs));
@@ -94,6 +97,7 @@ void Image::Render(const Matrix& proj) const
 
 	// 萔obt@XV
 	D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBuffer0.Get(), 0, nullptr, &cb, 0, 0);
+	D3DManager::getInstance()->getFrameStats().addUpload(sizeof(cb));
 
 	mesh->Render();
 }
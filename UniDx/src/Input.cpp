@@ -1,10 +1,44 @@
 ﻿#include "pch.h"
 #include <UniDx/Input.h>
 
+#include <mutex>
+
 namespace UniDx{
 
 std::unique_ptr<DirectX::Keyboard> Input::keyboard;
-DirectX::Keyboard::State Input::nowKeyState;
-DirectX::Keyboard::State Input::prevKeyState;
+
+
+void Input::initialize(bool useKeyboard)
+{
+    // キーの状態はエンジンごと
+    if (getInstance() == nullptr)
+    {
+        create();
+    }
+    getInstance()->useKeyboard_ = useKeyboard;
+
+    // キーボードはプロセスでひとつ。複数のエンジンのスレッドから同時に呼ばれても一度だけ作る
+    if (useKeyboard)
+    {
+        static std::once_flag once;
+        std::call_once(once, []() { keyboard = std::make_unique<DirectX::Keyboard>(); });
+    }
+}
+
+
+void Input::update()
+{
+    Input* input = getInstance();
+    if (input == nullptr)
+    {
+        return;
+    }
+    input->prevKeyState = input->nowKeyState;
+    if (input->useKeyboard_)
+    {
+        // GetState() は Windows のメッセージで更新された状態を読むだけ
+        input->nowKeyState = keyboard->GetState();
+    }
+}
 
 }
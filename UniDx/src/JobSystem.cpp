@@ -0,0 +1,324 @@
+﻿#include "pch.h"
+#include <UniDx/JobSystem.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include <UniDx/Profiler.h>
+
+
+namespace UniDx
+{
+
+thread_local size_t JobSystem::queueIndex_ = 0;
+
+
+JobSystem::~JobSystem()
+{
+    Finalize();
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドを起動
+// -----------------------------------------------------------------------------
+void JobSystem::Initialize(int workerCount)
+{
+    assert(!running_);
+
+    if (workerCount < 0)
+    {
+        int cores = (int)std::thread::hardware_concurrency();
+        workerCount = std::max(cores - 1, 0);
+    }
+
+    queues_.clear();
+    for (int i = 0; i < workerCount + 1; ++i)
+    {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+
+    running_ = true;
+    for (int i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back([this, i]() { workerMain(i + 1); });
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドを停止
+// -----------------------------------------------------------------------------
+void JobSystem::Finalize()
+{
+    if (!running_)
+    {
+        return;
+    }
+
+    // 残っているジョブを片付ける
+    while (tryRunOne()) {}
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        running_ = false;
+    }
+    wakeUp_.notify_all();
+
+    for (auto& w : workers_)
+    {
+        w.join();
+    }
+    workers_.clear();
+    queues_.clear();
+}
+
+
+// -----------------------------------------------------------------------------
+// ジョブを投入
+// -----------------------------------------------------------------------------
+void JobSystem::schedule(JobFunc job, JobCounter* counter, const JobCounter* dependency)
+{
+    if (counter != nullptr)
+    {
+        counter->count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Job j{ std::move(job), counter };
+
+    // インライン実行
+    if (workers_.empty())
+    {
+        if (dependency != nullptr)
+        {
+            wait(*dependency);
+        }
+        execute(j);
+        return;
+    }
+
+    // 依存先が終わっていなければ、終わるまでキューに入れない
+    if (dependency != nullptr && parkUntilDone(dependency, j))
+    {
+        return;
+    }
+
+    push(queueIndex_, std::move(j));
+}
+
+
+// -----------------------------------------------------------------------------
+// カウンタが完了するまで待つ
+// -----------------------------------------------------------------------------
+void JobSystem::wait(const JobCounter& counter)
+{
+    while (!counter.isDone())
+    {
+        // 待っている間も他のジョブを実行する
+        if (!tryRunOne())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 範囲を分割して並列実行
+// -----------------------------------------------------------------------------
+void JobSystem::parallelFor(size_t begin, size_t end, const RangeFunc& func, size_t chunkSize)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    size_t count = end - begin;
+    if (chunkSize == 0)
+    {
+        // 1スレッドあたり4分割程度にして、処理時間のばらつきをスティールで吸収する
+        size_t threads = workers_.size() + 1;
+        chunkSize = std::max<size_t>((count + threads * 4 - 1) / (threads * 4), 1);
+    }
+
+    // 分割する必要がなければそのまま実行
+    if (workers_.empty() || count <= chunkSize)
+    {
+        func(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    for (size_t b = begin; b < end; b += chunkSize)
+    {
+        size_t e = std::min(b + chunkSize, end);
+        schedule([&func, b, e]() { func(b, e); }, &counter);
+    }
+    wait(counter);
+}
+
+
+void JobSystem::push(size_t queueIndex, Job&& job)
+{
+    WorkQueue& q = *queues_[queueIndex];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back(std::move(job));
+    }
+    queuedJobs_.fetch_add(1, std::memory_order_release);
+    wakeUp_.notify_one();
+}
+
+
+// 自分のキューの末尾から取り出す
+bool JobSystem::popLocal(size_t queueIndex, Job& job)
+{
+    WorkQueue& q = *queues_[queueIndex];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.jobs.empty())
+    {
+        return false;
+    }
+    job = std::move(q.jobs.back());
+    q.jobs.pop_back();
+    queuedJobs_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+// 他のキューの先頭から盗む
+bool JobSystem::steal(size_t queueIndex, Job& job)
+{
+    size_t n = queues_.size();
+    for (size_t i = 1; i < n; ++i)
+    {
+        WorkQueue& q = *queues_[(queueIndex + i) % n];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.jobs.empty())
+        {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            queuedJobs_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// ジョブをひとつ実行する。実行できるものがなければ false
+bool JobSystem::tryRunOne()
+{
+    if (queues_.empty())
+    {
+        return false;
+    }
+
+    Job job;
+    if (!popLocal(queueIndex_, job) && !steal(queueIndex_, job))
+    {
+        return false;
+    }
+
+    execute(job);
+    return true;
+}
+
+
+void JobSystem::execute(Job& job)
+{
+    UNIDX_PROFILE_SCOPE("Job");
+    job.func();
+
+    // 最後のジョブが終わったら、このカウンタを待っていたジョブをキューに入れる
+    if (job.counter != nullptr &&
+        job.counter->count_.fetch_sub(1, std::memory_order_acq_rel) == (JobCounter::WaitingBit | 1))
+    {
+        resumeWaiting(job.counter);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 依存先が完了するまでジョブを止めておく
+// 既に完了していれば止めずに false を返す
+// -----------------------------------------------------------------------------
+bool JobSystem::parkUntilDone(const JobCounter* dependency, Job& job)
+{
+    std::lock_guard<std::mutex> lock(waitingMutex_);
+
+    // 印を付けるのと完了を確かめるのを一度に行う
+    // 印が付いていれば、最後のジョブを終えたスレッドが resumeWaiting() を呼ぶ
+    int prev = dependency->count_.fetch_or(JobCounter::WaitingBit, std::memory_order_acq_rel);
+    if ((prev & ~JobCounter::WaitingBit) == 0)
+    {
+        // 既に完了していた
+        // 印が前から付いていたなら resumeWaiting() が外すので、自分で付けたときだけ外す
+        // その間に次のジョブが登録されていたら、印はそのジョブの完了時に外される
+        if ((prev & JobCounter::WaitingBit) == 0)
+        {
+            int expected = JobCounter::WaitingBit;
+            dependency->count_.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    waiting_.emplace(dependency, std::move(job));
+    return true;
+}
+
+
+void JobSystem::resumeWaiting(const JobCounter* counter)
+{
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(waitingMutex_);
+
+        // 再利用されて既に次のジョブが登録されていれば、それが終わったときに入れる
+        if ((counter->count_.load(std::memory_order_acquire) & ~JobCounter::WaitingBit) != 0)
+        {
+            return;
+        }
+
+        auto range = waiting_.equal_range(counter);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            ready.push_back(std::move(it->second));
+        }
+        waiting_.erase(range.first, range.second);
+
+        // 印を外すと isDone() になり、カウンタが破棄されうるので、これ以降は触らない
+        counter->count_.fetch_and(~JobCounter::WaitingBit, std::memory_order_release);
+    }
+
+    for (auto& job : ready)
+    {
+        push(queueIndex_, std::move(job));
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// ワーカースレッドのメイン
+// -----------------------------------------------------------------------------
+void JobSystem::workerMain(size_t queueIndex)
+{
+    queueIndex_ = queueIndex;
+    Profiler::setThreadName(("Worker " + std::to_string(queueIndex)).c_str());
+
+    while (running_)
+    {
+        if (tryRunOne())
+        {
+            continue;
+        }
+
+        // 仕事がなければ投入されるまで眠る
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wakeUp_.wait_for(lock, std::chrono::milliseconds(1),
+            [this]() { return !running_ || queuedJobs_.load(std::memory_order_acquire) > 0; });
+    }
+}
+
+} // namespace UniDx
@@ -0,0 +1,226 @@
+﻿#include "pch.h"
+#include <UniDx/LODGroup.h>
+
+#include <UniDx/LODManager.h>
+#include <UniDx/Renderer.h>
+#include <UniDx/SceneSerializer.h>
+
+#include <algorithm>
+
+
+namespace UniDx
+{
+
+LODGroup::~LODGroup()
+{
+    // Component のデストラクタからは OnDisable が呼ばれないので、ここで登録を外す
+    if (LODManager::getInstance() != nullptr)
+    {
+        LODManager::getInstance()->unregisterGroup(this);
+    }
+    for (MeshRenderer* r : renderers_)
+    {
+        r->lodGroup_ = nullptr;
+    }
+}
+
+
+void LODGroup::OnEnable()
+{
+    if (!boundsValid_)
+    {
+        RecalculateBounds();
+    }
+    if (LODManager::getInstance() != nullptr)
+    {
+        LODManager::getInstance()->registerGroup(this);
+    }
+}
+
+
+void LODGroup::OnDisable()
+{
+    if (LODManager::getInstance() != nullptr)
+    {
+        LODManager::getInstance()->unregisterGroup(this);
+    }
+
+    // 無効の間は元のメッシュで描く
+    applyLOD(0);
+}
+
+
+// -----------------------------------------------------------------------------
+// 自身と子の MeshRenderer を集め、まとめた範囲を計算し直す
+// -----------------------------------------------------------------------------
+void LODGroup::RecalculateBounds()
+{
+    for (MeshRenderer* r : renderers_)
+    {
+        r->lodGroup_ = nullptr;
+        r->lodLevel = 0;
+    }
+    renderers_.clear();
+    collectRenderers(gameObject);
+
+    // サブメッシュの頂点の範囲をワールド座標で求め、このオブジェクトのローカル座標に戻す
+    bool any = false;
+    Vector3 mn, mx;
+    for (MeshRenderer* r : renderers_)
+    {
+        const Matrix& world = r->transform->getLocalToWorldMatrix();
+        for (auto& sub : r->mesh.submesh)
+        {
+            if (sub->positions.empty()) continue;
+
+            Vector3 localMin = sub->positions[0];
+            Vector3 localMax = localMin;
+            for (const Vector3& p : sub->positions)
+            {
+                localMin = Vector3::Min(localMin, p);
+                localMax = Vector3::Max(localMax, p);
+            }
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                Vector3 p(corner & 1 ? localMax.x : localMin.x, corner & 2 ? localMax.y : localMin.y, corner & 4 ? localMax.z : localMin.z);
+                p = Vector3::Transform(p, world);
+                mn = any ? Vector3::Min(mn, p) : p;
+                mx = any ? Vector3::Max(mx, p) : p;
+                any = true;
+            }
+        }
+    }
+
+    if (any)
+    {
+        Vector3 extent = mx - mn;
+        Vector3 scale = transform->getLossyScale();
+        float maxScale = std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z), 1e-6f });
+        localReferencePoint_ = Vector3::Transform((mn + mx) * 0.5f, transform->getLocalToWorldMatrix().Invert());
+        size_ = std::max({ extent.x, extent.y, extent.z }) / maxScale;
+    }
+    else
+    {
+        localReferencePoint_ = Vector3::Zero;
+        size_ = 0.0f;
+    }
+    boundsValid_ = true;
+    applyLOD(currentLOD_);
+}
+
+
+void LODGroup::collectRenderers(GameObject* object)
+{
+    for (auto& c : object->GetComponents())
+    {
+        if (auto r = dynamic_cast<MeshRenderer*>(c.get()))
+        {
+            // 子が別の LODGroup を持っていれば、そちらに任せる
+            if (r->lodGroup_ == nullptr)
+            {
+                r->lodGroup_ = this;
+                renderers_.push_back(r);
+            }
+        }
+    }
+    for (auto& child : object->transform->getChildGameObjects())
+    {
+        if (child->GetComponent<LODGroup>(true) == nullptr)
+        {
+            collectRenderers(&*child);
+        }
+    }
+}
+
+
+void LODGroup::removeRenderer(MeshRenderer* renderer)
+{
+    auto it = std::find(renderers_.begin(), renderers_.end(), renderer);
+    if (it != renderers_.end())
+    {
+        renderers_.erase(it);
+    }
+}
+
+
+void LODGroup::ForceLOD(int lod)
+{
+    forcedLOD_ = lod;
+    if (lod >= 0)
+    {
+        applyLOD(lod);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// カメラから見た大きさで LOD を選ぶ
+// -----------------------------------------------------------------------------
+void LODGroup::updateLOD(const Vector3& cameraPosition, float screenScale)
+{
+    if (forcedLOD_ >= 0 || size_ <= 0.0f)
+    {
+        return;
+    }
+
+    // 画面の高さに対する割合
+    Vector3 scale = transform->getLossyScale();
+    float worldSize = size_ * std::max({ std::abs(scale.x), std::abs(scale.y), std::abs(scale.z) });
+    float distance = Vector3::Distance(cameraPosition, transform->TransformPoint(localReferencePoint_));
+    float height = distance > 0.0f ? worldSize * screenScale / distance : FLT_MAX;
+
+    // 境目の近くで行き来しないように、細かくするときは少し大きく、粗くするときは少し小さくなってから切り替える
+    const int levelCount = int(screenRelativeHeights.size());
+    int lod = std::min(currentLOD_, levelCount);
+    while (lod > 0 && height > screenRelativeHeights[lod - 1] * (1.0f + hysteresis))
+    {
+        --lod;
+    }
+    while (lod < levelCount && height < screenRelativeHeights[lod] * (1.0f - hysteresis))
+    {
+        ++lod;
+    }
+
+    if (lod != currentLOD_)
+    {
+        applyLOD(lod);
+    }
+}
+
+
+void LODGroup::applyLOD(int lod)
+{
+    currentLOD_ = lod;
+    for (MeshRenderer* r : renderers_)
+    {
+        r->lodLevel = lod;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// シーンファイルへの書き出しと読み込み
+// -----------------------------------------------------------------------------
+void LODGroup::Serialize(SceneWriter& writer) const
+{
+    writer.write(hysteresis);
+    writer.write(uint32_t(screenRelativeHeights.size()));
+    for (float h : screenRelativeHeights)
+    {
+        writer.write(h);
+    }
+}
+
+
+void LODGroup::Deserialize(SceneReader& reader)
+{
+    reader.read(hysteresis);
+    uint32_t count = reader.read<uint32_t>();
+    screenRelativeHeights.clear();
+    for (uint32_t i = 0; i < count && !reader.hasFailed(); ++i)
+    {
+        screenRelativeHeights.push_back(reader.read<float>());
+    }
+}
+
+} // namespace UniDx
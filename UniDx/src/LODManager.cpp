@@ -0,0 +1,55 @@
+﻿#include "pch.h"
+#include <UniDx/LODManager.h>
+
+#include <UniDx/Camera.h>
+#include <UniDx/LODGroup.h>
+#include <UniDx/Profiler.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace UniDx
+{
+
+// LODGroupを登録
+void LODManager::registerGroup(LODGroup* group)
+{
+    if (std::find(groups_.begin(), groups_.end(), group) == groups_.end())
+    {
+        groups_.push_back(group);
+    }
+}
+
+
+// LODGroupの登録を解除
+void LODManager::unregisterGroup(LODGroup* group)
+{
+    auto it = std::find(groups_.begin(), groups_.end(), group);
+    if (it != groups_.end())
+    {
+        // 順番は関係ないので末尾と入れ替えて消す
+        *it = groups_.back();
+        groups_.pop_back();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// すべての LODGroup の LOD を選ぶ
+// -----------------------------------------------------------------------------
+void LODManager::updateLODs(const Camera& camera)
+{
+    UNIDX_PROFILE_SCOPE("LODManager::updateLODs");
+
+    // 距離 1 で画面の高さに映る長さの逆数。大きさ / 距離 にかけると画面の高さに対する割合になる
+    const Vector3 cameraPosition = camera.transform->getWorldPosition();
+    const float screenScale = 0.5f / std::tan(DirectX::XMConvertToRadians(camera.fov) * 0.5f);
+
+    for (LODGroup* group : groups_)
+    {
+        group->updateLOD(cameraPosition, screenScale);
+    }
+}
+
+} // namespace UniDx
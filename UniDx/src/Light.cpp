@@ -2,6 +2,7 @@
 #include <UniDx/Light.h>
 
 #include <UniDx/LightManager.h>
+#include <UniDx/SceneSerializer.h>
 
 
 namespace UniDx{
@@ -17,4 +18,26 @@ void Light::OnDisable()
     LightManager::getInstance()->unregisterLight(this);
 }
 
+
+void Light::Serialize(SceneWriter& writer) const
+{
+    Behaviour::Serialize(writer);
+    writer.write(color);
+    writer.write(type);
+    writer.write(intensity);
+    writer.write(range);
+    writer.write(spotAngle);
+}
+
+
+void Light::Deserialize(SceneReader& reader)
+{
+    Behaviour::Deserialize(reader);
+    reader.read(color);
+    reader.read(type);
+    reader.read(intensity);
+    reader.read(range);
+    reader.read(spotAngle);
+}
+
 }
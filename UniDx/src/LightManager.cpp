@@ -3,6 +3,7 @@
 
 #include <UniDx/Light.h>
 #include <UniDx/D3DManager.h>
+#include <UniDx/LinearAllocator.h>
 
 
 namespace UniDx
@@ -67,8 +68,9 @@ void LightManager::updateLightCBuffer()
     }
 
     // --- GPULight作成 ---
-    gpuLights_.clear();
-    gpuLights_.reserve(lights_.size());
+    // 毎フレーム作り直すのでフレーム用のメモリに置く
+    TransientVector<GPULight> gpuLights(FrameMemory::getInstance()->frame());
+    gpuLights.reserve(lights_.size());
     for (Light* l : lights_)
     {
         GPULight g{};
@@ -76,31 +78,40 @@ void LightManager::updateLightCBuffer()
         g.color.A(l->intensity);
         g.type = static_cast<uint32_t>(l->type);
 
-        auto world = l->transform->getLocalToWorldMatrix();       // ワールド行列取得
+        // Transformが変化したときだけワールド行列から姿勢を取り直す
+        uint64_t version = l->transform->getChangeVersion();
+        if (l->transformVersion_ != version)
+        {
+            const Matrix& world = l->transform->getLocalToWorldMatrix();
+            l->positionWS_ = world.Translation();
+            l->directionWS_ = -world.Forward();
+            l->transformVersion_ = version;
+        }
 
         switch (l->type)
         {
         case LightType_Directional:
-            g.positionOrDirWS = -world.Forward(); // 方向
+            g.positionOrDirWS = l->directionWS_; // 方向
             break;
         case LightType_Point:
-            g.positionOrDirWS = world.Translation();
+            g.positionOrDirWS = l->positionWS_;
             g.rangeOrInvCos = 1.0f / l->range;
             break;
         case LightType_Spot:
-            g.positionOrDirWS = world.Translation();
-            g.spotDirWS = -world.Forward();
+            g.positionOrDirWS = l->positionWS_;
+            g.spotDirWS = l->directionWS_;
             g.rangeOrInvCos = 1.0f / l->range;
             g.spotOuterCos = cosf(DirectX::XMConvertToRadians(l->spotAngle * 0.5f));
             break;
         }
-        gpuLights_.push_back(g);
+        gpuLights.push_back(g);
     }
 
     // --- バッファ容量を確保 ---
-    if (capacity_ < gpuLights_.size() || lightBuf_ == nullptr)
+    if (capacity_ < gpuLights.size() || lightBuf_ == nullptr)
     {
-        capacity_ = gpuLights_.size();
+        uploadedLights_.clear();
+        capacity_ = gpuLights.size();
         D3D11_BUFFER_DESC bd{};
         bd.ByteWidth = UINT(sizeof(GPULight) * capacity_);
         bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
@@ -120,16 +131,21 @@ void LightManager::updateLightCBuffer()
     }
 
     // --- Map & Copy ---
-    if (!gpuLights_.empty())
+    // 前回と内容が同じなら書き込みを省略
+    if (!gpuLights.empty() &&
+        (gpuLights.size() != uploadedLights_.size()
+            || memcmp(gpuLights.data(), uploadedLights_.data(), sizeof(GPULight) * gpuLights.size()) != 0))
     {
         D3D11_MAPPED_SUBRESOURCE ms{};
         D3DManager::getInstance()->GetContext()->Map(lightBuf_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
-        memcpy(ms.pData, gpuLights_.data(), sizeof(GPULight) * gpuLights_.size());
+        memcpy(ms.pData, gpuLights.data(), sizeof(GPULight) * gpuLights.size());
         D3DManager::getInstance()->GetContext()->Unmap(lightBuf_.Get(), 0);
+        D3DManager::getInstance()->getFrameStats().addUpload(sizeof(GPULight) * gpuLights.size());
+        uploadedLights_.assign(gpuLights.begin(), gpuLights.end());
     }
     /*
     // --- LightCount CB 更新 ---
-    struct { uint32_t Count; float pad[3]; } meta = { uint32_t(gpuLights_.size()) };
+    struct { uint32_t Count; float pad[3]; } meta = { uint32_t(gpuLights.size()) };
     if (!metaCB_)
     {
         D3D11_BUFFER_DESC bd{};
@@ -0,0 +1,136 @@
+﻿#include "pch.h"
+#include <UniDx/LinearAllocator.h>
+
+#include <algorithm>
+#include <atomic>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    thread_local uint64_t threadAllocationCount = 0;
+    std::atomic<bool> allocationCounterEnabled = false;
+
+    std::byte* alignPointer(std::byte* p, size_t alignment)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(p);
+        return p + ((alignment - address % alignment) % alignment);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// LinearAllocator
+// -----------------------------------------------------------------------------
+LinearAllocator::LinearAllocator(size_t capacity) :
+    buffer_(new std::byte[capacity]),
+    capacity_(capacity)
+{
+}
+
+
+LinearAllocator::~LinearAllocator()
+{
+    reset();
+    delete[] buffer_;
+}
+
+
+void* LinearAllocator::allocate(size_t size, size_t alignment)
+{
+    std::byte* p = alignPointer(buffer_ + offset_, alignment);
+    if (p + size <= buffer_ + capacity_)
+    {
+        offset_ = size_t(p + size - buffer_);
+        return p;
+    }
+
+    // 入りきらないので今回はヒープから取り、次の reset() で容量を増やす
+    size_t blockSize = size + alignment;
+    std::byte* block = new std::byte[blockSize];
+    overflow_.push_back(block);
+    overflowBytes_ += blockSize;
+    overflowCount_++;
+    return alignPointer(block, alignment);
+}
+
+
+void LinearAllocator::reset()
+{
+    if (!overflow_.empty())
+    {
+        for (std::byte* block : overflow_)
+        {
+            delete[] block;
+        }
+        overflow_.clear();
+
+        // 今回の使用量がひとつのバッファに入るように作り直す
+        size_t used = offset_ + overflowBytes_;
+        size_t capacity = capacity_;
+        while (capacity < used)
+        {
+            capacity *= 2;
+        }
+        delete[] buffer_;
+        buffer_ = new std::byte[capacity];
+        capacity_ = capacity;
+        overflowBytes_ = 0;
+    }
+    offset_ = 0;
+}
+
+
+// -----------------------------------------------------------------------------
+// FrameMemory
+// -----------------------------------------------------------------------------
+FrameMemory::FrameMemory() :
+    frame_(FrameCapacity),
+    fixedStep_{ LinearAllocator(FixedStepCapacity), LinearAllocator(FixedStepCapacity) }
+{
+}
+
+
+void FrameMemory::beginFrame()
+{
+    frame_.reset();
+}
+
+
+void FrameMemory::beginFixedStep()
+{
+    // 前のステップのものは残したまま、その前のステップのものを解放する
+    fixedStepIndex_ = 1 - fixedStepIndex_;
+    fixedStep_[fixedStepIndex_].reset();
+}
+
+
+// -----------------------------------------------------------------------------
+// AllocationCounter
+// -----------------------------------------------------------------------------
+bool AllocationCounter::isEnabled()
+{
+    return allocationCounterEnabled.load(std::memory_order_relaxed);
+}
+
+
+void AllocationCounter::setEnabled(bool enabled)
+{
+    allocationCounterEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+void AllocationCounter::recordAllocation() noexcept
+{
+    threadAllocationCount++;
+}
+
+
+uint64_t AllocationCounter::getThreadCount()
+{
+    return threadAllocationCount;
+}
+
+} // namespace UniDx
@@ -0,0 +1,65 @@
+﻿#include "pch.h"
+#include <UniDx/MappedFile.h>
+
+
+namespace UniDx
+{
+
+bool MappedFile::open(const std::wstring& path)
+{
+    close();
+
+    file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart == 0)
+    {
+        // 空のファイルはマップできない
+        close();
+        return false;
+    }
+
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr)
+    {
+        close();
+        return false;
+    }
+    size_ = size_t(fileSize.QuadPart);
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+    size_ = 0;
+}
+
+} // namespace UniDx
@@ -96,6 +96,7 @@ bool Material::setForRender() const
 
     // ブレンド
     D3DManager::getInstance()->GetContext()->OMSetBlendState(blendState.Get(), NULL, 0xffffffff);
+    D3DManager::getInstance()->getFrameStats().stateChanges += 2;
 
     // 定数バッファ更新
     VSConstantBuffer1 cb{};
@@ -105,6 +106,7 @@ bool Material::setForRender() const
     D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(1, 1, cbs);
     D3DManager::getInstance()->GetContext()->PSSetConstantBuffers(1, 1, cbs);
     D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBuffer1.Get(), 0, nullptr, &cb, 0, 0);
+    D3DManager::getInstance()->getFrameStats().addUpload(sizeof(cb));
 
     return true;
 }
@@ -124,6 +126,18 @@ void Material::AddTexture(std::shared_ptr<Texture> tex)
 // -----------------------------------------------------------------------------
 void Material::OnEnable()
 {
+    // ヘッドレスモードではGPUリソースを作らない
+    if (!D3DManager::isAvailable())
+    {
+        return;
+    }
+
+    // 複数のレンダラーで共有していても作るのは一度だけ
+    if (constantBuffer1 != nullptr)
+    {
+        return;
+    }
+
     // デプスステート作成
     D3D11_DEPTH_STENCIL_DESC dsDesc = {};
     dsDesc.DepthEnable = TRUE; // 深度テスト有効
@@ -152,6 +166,8 @@ void Material::OnEnable()
 // -----------------------------------------------------------------------------
 void Material::setBlendMode(BlendMode e)
 {
+    blendMode = e;
+
     D3D11_BLEND_DESC blendDesc = {};
     blendDesc.AlphaToCoverageEnable = FALSE;
     blendDesc.IndependentBlendEnable = FALSE;
@@ -3,11 +3,19 @@
 
 #include <UniDx/D3DManager.h>
 
+#include <algorithm>
+
 namespace UniDx{
 
 
 void SubMesh::createVertexBuffer(void* data)
 {
+    // ヘッドレスモードではGPUリソースを作らない
+    if (!D3DManager::isAvailable())
+    {
+        return;
+    }
+
     // 事前に設定されたstrideと位置の数でデータサイズを計算
     UINT byteSize = static_cast<UINT>(stride * positions.size());
 
@@ -28,10 +36,51 @@ void SubMesh::createVertexBuffer(void* data)
 }
 
 
+bool SubMesh::narrowIndices(std::span<const uint32_t> src, std::vector<uint16_t>& dst)
+{
+    uint32_t maxIndex = 0;
+    for (uint32_t index : src)
+    {
+        maxIndex = std::max(maxIndex, index);
+    }
+    if (maxIndex >= 0xFFFF)
+    {
+        return false;
+    }
+
+    dst.resize(src.size());
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        dst[i] = static_cast<uint16_t>(src[i]);
+    }
+    return true;
+}
+
+
 void SubMesh::createIndexBuffer()
 {
+    createIndexBuffer(indices, indexBuffer, indexFormat);
+    for (auto& lod : lods)
+    {
+        createIndexBuffer(lod.indices, lod.indexBuffer, lod.indexFormat);
+    }
+}
+
+
+void SubMesh::createIndexBuffer(std::span<const uint32_t> src, ComPtr<ID3D11Buffer>& buffer, DXGI_FORMAT& format)
+{
+    // 16bit に収まるならインデックスを縮めて、メモリと帯域を半分にする
+    std::vector<uint16_t> narrow;
+    format = narrowIndices(src, narrow) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+    if (!D3DManager::isAvailable() || src.empty())
+    {
+        return;
+    }
+
     // データサイズを計算
-    UINT byteSize = static_cast<UINT>(indices.size() * sizeof(uint32_t));
+    const void* data = format == DXGI_FORMAT_R16_UINT ? static_cast<const void*>(narrow.data()) : src.data();
+    UINT byteSize = static_cast<UINT>(src.size() * (format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t)));
 
     // 作成するバッファの仕様を決める
     D3D11_BUFFER_DESC vbDesc = {};
@@ -43,14 +92,14 @@ void SubMesh::createIndexBuffer()
     vbDesc.CPUAccessFlags = 0;
 
     // 上の仕様を渡して頂点バッファを作ってもらう
-    D3D11_SUBRESOURCE_DATA initData = { &indices.front(), byteSize, 0};	// 書き込むデータ
+    D3D11_SUBRESOURCE_DATA initData = { data, byteSize, 0};	// 書き込むデータ
 
     // 頂点バッファの作成
-    D3DManager::getInstance()->GetDevice()->CreateBuffer(&vbDesc, &initData, &indexBuffer);
+    D3DManager::getInstance()->GetDevice()->CreateBuffer(&vbDesc, &initData, &buffer);
 }
 
 
-void SubMesh::Render() const
+void SubMesh::Render(int lod) const
 {
     // 頂点バッファを描画で使えるようにセットする
     UINT offset = 0;
@@ -59,17 +108,34 @@ void SubMesh::Render() const
     // プロミティブ・トポロジーをセット
     D3DManager::getInstance()->GetContext()->IASetPrimitiveTopology(topology);
 
+    // 使うインデックス
+    std::span<const uint32_t> drawIndices = indices;
+    ID3D11Buffer* drawBuffer = indexBuffer.Get();
+    DXGI_FORMAT drawFormat = indexFormat;
+    if (lod > 0 && !lods.empty())
+    {
+        const SubMeshLOD& l = lods[std::min(size_t(lod), lods.size()) - 1];
+        drawIndices = l.indices;
+        drawBuffer = l.indexBuffer.Get();
+        drawFormat = l.indexFormat;
+    }
+
     // GPUへの描画命令発行
-    if (indices.size() > 0 && indexBuffer)
+    RenderStats& stats = D3DManager::getInstance()->getFrameStats();
+    stats.drawCalls++;
+    if (drawIndices.size() > 0 && drawBuffer)
     {
         // インデックスバッファを使う場合
-        D3DManager::getInstance()->GetContext()->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-        D3DManager::getInstance()->GetContext()->DrawIndexed(static_cast<UINT>(indices.size()), 0, 0);
+        D3DManager::getInstance()->GetContext()->IASetIndexBuffer(drawBuffer, drawFormat, 0);
+        D3DManager::getInstance()->GetContext()->DrawIndexed(static_cast<UINT>(drawIndices.size()), 0, 0);
+        stats.indexedDrawCalls++;
+        stats.primitives += drawIndices.size();
     }
     else
     {
         // 頂点データのみ場合
         D3DManager::getInstance()->GetContext()->Draw(static_cast<UINT>(positions.size()), 0);
+        stats.primitives += positions.size();
     }
 }
 
@@ -0,0 +1,488 @@
+﻿#include "pch.h"
+#include <UniDx/MeshCache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <cstring>
+
+#include <UniDx/GltfModel.h>
+#include <UniDx/SceneSerializer.h>
+#include <UniDx/AssetDatabase.h>
+#include <UniDx/MappedFile.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/MeshOptimizer.h>
+#include <UniDx/MeshSimplifier.h>
+
+
+namespace UniDx
+{
+
+using namespace CookedMeshFile;
+
+namespace
+{
+    std::mutex directoryMutex;
+    std::wstring cacheDirectory = L"Cache/Mesh";
+
+    // FNV-1a
+    constexpr uint64_t HashBasis = 14695981039346656037ull;
+
+    uint64_t hashBytes(const void* data, size_t size, uint64_t hash = HashBasis)
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ p[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // 頂点の型のハッシュ（セマンティクス、フォーマット、オフセット）
+    uint64_t hashLayout(const SceneVertexType& vertex)
+    {
+        uint64_t hash = HashBasis;
+        for (size_t i = 0; i < vertex.layoutSize; ++i)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& e = vertex.layout[i];
+            hash = hashBytes(e.SemanticName, std::strlen(e.SemanticName), hash);
+            uint32_t values[] = { e.SemanticIndex, uint32_t(e.Format), e.InputSlot, e.AlignedByteOffset };
+            hash = hashBytes(values, sizeof(values), hash);
+        }
+
+        // 並べ替えたメッシュや LOD を作ったものは別のファイルにする
+        if (MeshOptimizer::isEnabled())
+        {
+            hash = hashBytes("MeshOptimizer", 13, hash);
+        }
+        if (int lodCount = MeshSimplifier::getImportLODCount(); lodCount > 0)
+        {
+            hash = hashBytes(&lodCount, sizeof(lodCount), hash);
+        }
+        return hash;
+    }
+
+    // 元のファイルの情報
+    struct SourceInfo
+    {
+        uint64_t size = 0;
+        int64_t time = 0;
+    };
+
+    bool getSourceInfo(const std::wstring& path, SourceInfo& info)
+    {
+        std::error_code ec;
+        std::filesystem::path p(path);
+        info.size = std::filesystem::file_size(p, ec);
+        if (ec) return false;
+        info.time = int64_t(std::filesystem::last_write_time(p, ec).time_since_epoch().count());
+        return !ec;
+    }
+
+    bool hashSource(const std::wstring& path, uint64_t& hash)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            return false;
+        }
+        hash = hashBytes(file.data(), file.size());
+        return true;
+    }
+
+    // テーブルがファイルに収まっているか
+    bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+    {
+        return offset <= fileSize && count * size <= fileSize - offset;
+    }
+
+    size_t alignData(size_t offset)
+    {
+        return (offset + DataAlignment - 1) & ~size_t(DataAlignment - 1);
+    }
+
+    // サブメッシュの属性
+    std::span<const std::byte> attributeBytes(const SubMesh& sub, uint32_t attribute)
+    {
+        switch (attribute)
+        {
+        case Attribute_Position: return std::as_bytes(sub.positions);
+        case Attribute_Normal:   return std::as_bytes(sub.normals);
+        case Attribute_Color:    return std::as_bytes(sub.colors);
+        case Attribute_UV:       return std::as_bytes(sub.uv);
+        case Attribute_UV2:      return std::as_bytes(sub.uv2);
+        case Attribute_UV3:      return std::as_bytes(sub.uv3);
+        case Attribute_UV4:      return std::as_bytes(sub.uv4);
+        default:                 return {};
+        }
+    }
+
+    // ファイルの中の属性の配列を参照する
+    template<typename T>
+    bool bindAttribute(const MappedFile& file, const SubMeshRecord& r, uint32_t attribute, std::span<const T>& out)
+    {
+        if ((r.attributes & (1u << attribute)) == 0)
+        {
+            return true;
+        }
+        uint64_t offset = r.attributeOffset[attribute];
+        if (offset % alignof(T) != 0 || !fits(offset, r.vertexCount, sizeof(T), file.size()))
+        {
+            return false;
+        }
+        out = std::span<const T>(reinterpret_cast<const T*>(file.data() + offset), r.vertexCount);
+        return true;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 置き場所
+// -----------------------------------------------------------------------------
+void MeshCache::SetDirectory(const std::wstring& directory)
+{
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    cacheDirectory = directory;
+}
+
+
+std::wstring MeshCache::GetDirectory()
+{
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    return cacheDirectory;
+}
+
+
+std::wstring MeshCache::GetCookedPath(const std::wstring& sourcePath, const SceneVertexType& vertex)
+{
+    std::wstring directory = GetDirectory();
+    if (directory.empty())
+    {
+        return std::wstring();
+    }
+
+    // 同じ名前の別のファイルと区別するため、正規化したパスと頂点の型のハッシュを付ける
+    std::wstring normalized = AssetDatabase::NormalizePath(sourcePath);
+    uint64_t hash = hashBytes(normalized.data(), normalized.size() * sizeof(wchar_t), hashLayout(vertex));
+
+    std::wstring suffix = L"_0000000000000000.umesh";
+    for (int i = 0; i < 16; ++i)
+    {
+        suffix[16 - i] = L"0123456789abcdef"[(hash >> (i * 4)) & 0xf];
+    }
+    std::filesystem::path path = std::filesystem::path(directory) / std::filesystem::path(sourcePath).stem();
+    return path.wstring() + suffix;
+}
+
+
+// -----------------------------------------------------------------------------
+// 読み込み
+// -----------------------------------------------------------------------------
+std::shared_ptr<GltfModelAsset> MeshCache::Load(const std::wstring& sourcePath, const SceneVertexType& vertex)
+{
+    UNIDX_PROFILE_SCOPE("MeshCache::Load");
+
+    std::wstring cookedPath = GetCookedPath(sourcePath, vertex);
+    if (cookedPath.empty())
+    {
+        return nullptr;
+    }
+
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(cookedPath) || file->size() < sizeof(Header))
+    {
+        return nullptr;
+    }
+
+    Header header;
+    std::memcpy(&header, file->data(), sizeof(Header));
+    if (header.magic != Magic || header.version != Version || header.charSize != sizeof(wchar_t)
+        || header.fileSize != file->size() || header.layoutHash != hashLayout(vertex))
+    {
+        return nullptr;
+    }
+
+    // 元のファイルが変わっていれば使わない
+    SourceInfo source;
+    if (!getSourceInfo(sourcePath, source) || source.size != header.sourceSize)
+    {
+        return nullptr;
+    }
+    if (source.time != header.sourceTime)
+    {
+        uint64_t hash;
+        if (!hashSource(sourcePath, hash) || hash != header.sourceHash)
+        {
+            return nullptr;
+        }
+    }
+
+    uint64_t size = file->size();
+    if (!fits(header.nodeOffset, header.nodeCount, sizeof(NodeRecord), size)
+        || !fits(header.meshOffset, header.meshCount, sizeof(MeshRecord), size)
+        || !fits(header.subMeshOffset, header.subMeshCount, sizeof(SubMeshRecord), size)
+        || !fits(header.textureOffset, header.textureCount, sizeof(TextureRecord), size)
+        || !fits(header.lodOffset, header.lodCount, sizeof(LODRecord), size)
+        || header.charOffset % alignof(wchar_t) != 0 || header.charOffset > size)
+    {
+        return nullptr;
+    }
+    const std::byte* data = file->data();
+    const wchar_t* chars = reinterpret_cast<const wchar_t*>(data + header.charOffset);
+    uint64_t charCount = (size - header.charOffset) / sizeof(wchar_t);
+
+    auto asset = std::make_shared<GltfModelAsset>();
+    asset->filePath_ = sourcePath;
+    asset->layout_ = vertex.layout;
+
+    // ノード
+    for (uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        NodeRecord r;
+        std::memcpy(&r, data + header.nodeOffset + i * sizeof(NodeRecord), sizeof(NodeRecord));
+        if (uint64_t(r.nameOffset) + r.nameLength > charCount || r.parent >= int32_t(i)
+            || r.mesh >= int32_t(header.meshCount))
+        {
+            return nullptr;
+        }
+        asset->nodes_.push_back(GltfModelAsset::Node{ std::wstring(chars + r.nameOffset, r.nameLength),
+            r.position, r.rotation, r.scale, r.parent < 0 ? -1 : r.parent, r.mesh < 0 ? -1 : r.mesh });
+    }
+
+    // メッシュ
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        MeshRecord r;
+        std::memcpy(&r, data + header.meshOffset + i * sizeof(MeshRecord), sizeof(MeshRecord));
+        if (uint64_t(r.first) + r.count > header.subMeshCount)
+        {
+            return nullptr;
+        }
+        asset->meshes_.push_back(GltfModelAsset::MeshRange{ r.first, r.count });
+    }
+
+    // テクスチャのラップモード
+    for (uint32_t i = 0; i < header.textureCount; ++i)
+    {
+        TextureRecord r;
+        std::memcpy(&r, data + header.textureOffset + i * sizeof(TextureRecord), sizeof(TextureRecord));
+        asset->textureWraps_.push_back(GltfModelAsset::TextureWrap{
+            D3D11_TEXTURE_ADDRESS_MODE(r.wrapU), D3D11_TEXTURE_ADDRESS_MODE(r.wrapV) });
+    }
+
+    // サブメッシュ
+    // 頂点バッファはファイルの中の詰めた頂点からそのまま作り、属性とインデックスはファイルを参照する
+    for (uint32_t i = 0; i < header.subMeshCount; ++i)
+    {
+        SubMeshRecord r;
+        std::memcpy(&r, data + header.subMeshOffset + i * sizeof(SubMeshRecord), sizeof(SubMeshRecord));
+        if (!fits(r.vertexOffset, r.vertexCount, header.stride, size)
+            || r.indexOffset % alignof(uint32_t) != 0 || !fits(r.indexOffset, r.indexCount, sizeof(uint32_t), size))
+        {
+            return nullptr;
+        }
+
+        auto sub = std::make_shared<SubMesh>();
+        sub->topology = D3D11_PRIMITIVE_TOPOLOGY(r.topology);
+        sub->mappedFile = file;
+        if (!bindAttribute(*file, r, Attribute_Position, sub->positions)
+            || !bindAttribute(*file, r, Attribute_Normal, sub->normals)
+            || !bindAttribute(*file, r, Attribute_Color, sub->colors)
+            || !bindAttribute(*file, r, Attribute_UV, sub->uv)
+            || !bindAttribute(*file, r, Attribute_UV2, sub->uv2)
+            || !bindAttribute(*file, r, Attribute_UV3, sub->uv3)
+            || !bindAttribute(*file, r, Attribute_UV4, sub->uv4)
+            || sub->positions.size() != r.vertexCount)
+        {
+            return nullptr;
+        }
+        sub->indices = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(data + r.indexOffset), r.indexCount);
+
+        // LOD のインデックスもファイルを参照する
+        if (uint64_t(r.lodFirst) + r.lodCount > header.lodCount)
+        {
+            return nullptr;
+        }
+        for (uint32_t l = r.lodFirst; l < r.lodFirst + r.lodCount; ++l)
+        {
+            LODRecord lod;
+            std::memcpy(&lod, data + header.lodOffset + l * sizeof(LODRecord), sizeof(LODRecord));
+            if (lod.indexOffset % alignof(uint32_t) != 0 || !fits(lod.indexOffset, lod.indexCount, sizeof(uint32_t), size))
+            {
+                return nullptr;
+            }
+            SubMeshLOD subLod;
+            subLod.indices = std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(data + lod.indexOffset), lod.indexCount);
+            subLod.error = lod.error;
+            sub->lods.push_back(subLod);
+        }
+
+        // 頂点バッファは GltfModelAsset::createBuffers() でファイルの中の詰めた頂点から作る
+        sub->stride = header.stride;
+        asset->packedVertices_.push_back(r.vertexCount > 0 ? data + r.vertexOffset : nullptr);
+        asset->submesh_.push_back(sub);
+        asset->bounds_.push_back(r.bounds);
+    }
+
+    return asset;
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出し
+// -----------------------------------------------------------------------------
+bool MeshCache::Save(const GltfModelAsset& asset, const SceneVertexType& vertex)
+{
+    UNIDX_PROFILE_SCOPE("MeshCache::Save");
+
+    const std::wstring& sourcePath = asset.getFilePath();
+    std::wstring cookedPath = GetCookedPath(sourcePath, vertex);
+    if (cookedPath.empty() || vertex.interleave == nullptr)
+    {
+        return false;
+    }
+
+    Header header{};
+    header.magic = Magic;
+    header.version = Version;
+    header.charSize = sizeof(wchar_t);
+    header.layoutHash = hashLayout(vertex);
+
+    SourceInfo source;
+    if (!getSourceInfo(sourcePath, source) || !hashSource(sourcePath, header.sourceHash))
+    {
+        return false;
+    }
+    header.sourceSize = source.size;
+    header.sourceTime = source.time;
+
+    // テーブル
+    std::vector<NodeRecord> nodes;
+    std::wstring chars;
+    for (const auto& node : asset.nodes_)
+    {
+        nodes.push_back(NodeRecord{ uint32_t(chars.size()), uint32_t(node.name.size()), node.parent, node.mesh,
+            node.position, node.rotation, node.scale });
+        chars += node.name;
+    }
+
+    std::vector<MeshRecord> meshes;
+    for (const auto& mesh : asset.meshes_)
+    {
+        meshes.push_back(MeshRecord{ mesh.first, mesh.count });
+    }
+
+    std::vector<TextureRecord> textures;
+    for (const auto& wrap : asset.textureWraps_)
+    {
+        textures.push_back(TextureRecord{ int32_t(wrap.u), int32_t(wrap.v) });
+    }
+
+    header.nodeCount = uint32_t(nodes.size());
+    header.meshCount = uint32_t(meshes.size());
+    header.subMeshCount = uint32_t(asset.submesh_.size());
+    header.textureCount = uint32_t(textures.size());
+    for (const auto& sub : asset.submesh_)
+    {
+        header.lodCount += uint32_t(sub->lods.size());
+    }
+    header.nodeOffset = sizeof(Header);
+    header.meshOffset = header.nodeOffset + uint32_t(nodes.size() * sizeof(NodeRecord));
+    header.subMeshOffset = header.meshOffset + uint32_t(meshes.size() * sizeof(MeshRecord));
+    header.textureOffset = header.subMeshOffset + uint32_t(header.subMeshCount * sizeof(SubMeshRecord));
+    header.lodOffset = header.textureOffset + uint32_t(textures.size() * sizeof(TextureRecord));
+    header.charOffset = header.lodOffset + uint32_t(header.lodCount * sizeof(LODRecord));
+
+    // データ
+    std::vector<std::byte> data;
+    size_t dataOffset = alignData(header.charOffset + chars.size() * sizeof(wchar_t));
+    auto append = [&](std::span<const std::byte> bytes) -> uint64_t
+    {
+        size_t offset = alignData(dataOffset + data.size());
+        data.resize(offset - dataOffset);
+        data.insert(data.end(), bytes.begin(), bytes.end());
+        return offset;
+    };
+
+    std::vector<SubMeshRecord> subMeshes;
+    std::vector<LODRecord> lods;
+    std::vector<std::byte> vertices;
+    for (size_t i = 0; i < asset.submesh_.size(); ++i)
+    {
+        SubMesh* sub = asset.submesh_[i].get();
+
+        SubMeshRecord r{};
+        r.topology = uint32_t(sub->topology);
+        r.vertexCount = uint32_t(sub->positions.size());
+        r.indexCount = uint32_t(sub->indices.size());
+        r.bounds = i < asset.bounds_.size() ? asset.bounds_[i] : Bounds(Vector3::Zero, Vector3::Zero);
+
+        // 頂点の型に合わせて詰めた頂点
+        vertex.interleave(sub, vertices);
+        if (r.vertexCount > 0)
+        {
+            header.stride = uint32_t(vertices.size() / r.vertexCount);
+        }
+        r.vertexOffset = append(vertices);
+
+        for (uint32_t a = 0; a < Attribute_Count; ++a)
+        {
+            std::span<const std::byte> bytes = attributeBytes(*sub, a);
+            if (!bytes.empty())
+            {
+                r.attributes |= 1u << a;
+                r.attributeOffset[a] = append(bytes);
+            }
+        }
+        r.indexOffset = append(std::as_bytes(sub->indices));
+
+        r.lodFirst = uint32_t(lods.size());
+        r.lodCount = uint32_t(sub->lods.size());
+        for (const SubMeshLOD& lod : sub->lods)
+        {
+            lods.push_back(LODRecord{ uint32_t(lod.indices.size()), lod.error, append(std::as_bytes(lod.indices)) });
+        }
+        subMeshes.push_back(r);
+    }
+    header.fileSize = dataOffset + data.size();
+
+    // 書きかけのファイルを読まないように、別名で書いてから置き換える
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), ec);
+    std::filesystem::path tempPath = std::filesystem::path(cookedPath + L".tmp");
+    {
+        std::ofstream out(tempPath, std::ios::binary);
+        if (!out)
+        {
+            Debug::Log(L"変換済みのメッシュを書き出せません: " + cookedPath);
+            return false;
+        }
+        auto write = [&](const void* p, size_t size) { out.write(static_cast<const char*>(p), std::streamsize(size)); };
+        write(&header, sizeof(header));
+        write(nodes.data(), nodes.size() * sizeof(NodeRecord));
+        write(meshes.data(), meshes.size() * sizeof(MeshRecord));
+        write(subMeshes.data(), subMeshes.size() * sizeof(SubMeshRecord));
+        write(textures.data(), textures.size() * sizeof(TextureRecord));
+        write(lods.data(), lods.size() * sizeof(LODRecord));
+        write(chars.data(), chars.size() * sizeof(wchar_t));
+        std::vector<std::byte> padding(dataOffset - (header.charOffset + chars.size() * sizeof(wchar_t)));
+        write(padding.data(), padding.size());
+        write(data.data(), data.size());
+        if (!out)
+        {
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, std::filesystem::path(cookedPath), ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    Debug::Log(L"変換済みのメッシュを書き出しました: " + cookedPath);
+    return true;
+}
+
+} // namespace UniDx
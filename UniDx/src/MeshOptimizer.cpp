@@ -0,0 +1,452 @@
+﻿#include "pch.h"
+#include <UniDx/MeshOptimizer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    std::atomic<bool> optimizerEnabled = false;
+
+    // 頂点ごとに、その頂点を使う三角形の一覧
+    struct TriangleAdjacency
+    {
+        std::vector<uint32_t> offsets;      // 頂点ごとの triangles の先頭（頂点の数 + 1 個）
+        std::vector<uint32_t> triangles;
+
+        TriangleAdjacency(std::span<const uint32_t> indices, size_t vertexCount)
+            : offsets(vertexCount + 1, 0), triangles(indices.size())
+        {
+            for (uint32_t index : indices)
+            {
+                offsets[index + 1]++;
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                triangles[fill[indices[i]]++] = uint32_t(i / 3);
+            }
+        }
+    };
+
+    // FIFO の頂点キャッシュ
+    // 時刻を使って、最後に入れてから cacheSize 回以内に入れた頂点をキャッシュにあるとみなす
+    class FifoCache
+    {
+    public:
+        FifoCache(size_t vertexCount, int cacheSize) : stamps_(vertexCount, 0), cacheSize_(cacheSize), time_(cacheSize + 1) {}
+
+        // キャッシュに無ければ入れて true を返す
+        bool miss(uint32_t v)
+        {
+            if (time_ - stamps_[v] > uint32_t(cacheSize_))
+            {
+                stamps_[v] = time_++;
+                return true;
+            }
+            return false;
+        }
+
+        // キャッシュを空にする
+        void reset()
+        {
+            time_ += cacheSize_ + 1;
+        }
+
+    private:
+        std::vector<uint32_t> stamps_;
+        int cacheSize_;
+        uint32_t time_;
+    };
+
+    // 三角形リストとして扱えるか
+    bool isTriangleList(std::span<const uint32_t> indices, size_t vertexCount)
+    {
+        if (indices.empty() || indices.size() % 3 != 0)
+        {
+            return false;
+        }
+        return std::all_of(indices.begin(), indices.end(), [&](uint32_t i) { return i < vertexCount; });
+    }
+
+    // 属性をサブメッシュ自身の配列に置く
+    template<typename T>
+    void ensureOwned(OwnedSubMesh& sub, std::span<const T>& target,
+        void (OwnedSubMesh::*resize)(size_t), const std::vector<T>& (OwnedSubMesh::*storage)())
+    {
+        if (target.empty() || target.data() == (sub.*storage)().data())
+        {
+            return;
+        }
+        std::vector<T> copy(target.begin(), target.end());
+        (sub.*resize)(copy.size());
+        std::memcpy(const_cast<std::vector<T>&>((sub.*storage)()).data(), copy.data(), copy.size() * sizeof(T));
+    }
+
+    // remap[古い番号] = 新しい番号 で属性を並べ替える
+    template<typename T>
+    void remapAttribute(OwnedSubMesh& sub, std::span<const T> target, const std::vector<uint32_t>& remap, size_t newCount,
+        void (OwnedSubMesh::*resize)(size_t), const std::vector<T>& (OwnedSubMesh::*storage)())
+    {
+        if (target.empty())
+        {
+            return;
+        }
+        std::vector<T> old(target.begin(), target.end());
+        (sub.*resize)(newCount);
+        auto& data = const_cast<std::vector<T>&>((sub.*storage)());
+        for (size_t i = 0; i < old.size(); ++i)
+        {
+            if (remap[i] != UINT32_MAX)
+            {
+                data[remap[i]] = old[i];
+            }
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// まとめて最適化
+// -----------------------------------------------------------------------------
+void MeshOptimizer::Optimize(OwnedSubMesh& sub)
+{
+    if (!isTriangleList(sub.indices, sub.positions.size()))
+    {
+        return;
+    }
+
+    // 並べ替えるので、マップしたファイルを参照しているものはコピーする
+    ensureOwned(sub, sub.positions, &OwnedSubMesh::resizePositions, &OwnedSubMesh::mutablePositions);
+    ensureOwned(sub, sub.normals, &OwnedSubMesh::resizeNormals, &OwnedSubMesh::mutableNormals);
+    ensureOwned(sub, sub.colors, &OwnedSubMesh::resizeColors, &OwnedSubMesh::mutableColors);
+    ensureOwned(sub, sub.uv, &OwnedSubMesh::resizeUV, &OwnedSubMesh::mutableUV);
+    ensureOwned(sub, sub.uv2, &OwnedSubMesh::resizeUV2, &OwnedSubMesh::mutableUV2);
+    ensureOwned(sub, sub.uv3, &OwnedSubMesh::resizeUV3, &OwnedSubMesh::mutableUV3);
+    ensureOwned(sub, sub.uv4, &OwnedSubMesh::resizeUV4, &OwnedSubMesh::mutableUV4);
+    ensureOwned(sub, sub.indices, &OwnedSubMesh::resizeIndices, &OwnedSubMesh::mutableIndices);
+
+    auto& indices = const_cast<std::vector<uint32_t>&>(sub.mutableIndices());
+    OptimizeVertexCache(indices, sub.positions.size());
+    OptimizeOverdraw(indices, sub.positions);
+    OptimizeVertexFetch(sub);
+}
+
+
+// -----------------------------------------------------------------------------
+// 頂点キャッシュの最適化
+// Tipsify (Sander, Nehab, Barczak 2007 "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+// 今の頂点のまわりの三角形を扇状に出し、次はキャッシュに残っていそうな頂点に移る
+// -----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, int cacheSize)
+{
+    if (!isTriangleList(indices, vertexCount))
+    {
+        return;
+    }
+
+    const size_t triangleCount = indices.size() / 3;
+    TriangleAdjacency adjacency(indices, vertexCount);
+
+    // まだ出していない三角形の数
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<uint32_t> stamps(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;      // 最近使った頂点。行き詰まったときの戻り先
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t time = uint32_t(cacheSize) + 1;
+    size_t cursor = 0;                  // 行き詰まったときに順に探す位置
+
+    // 最初の頂点
+    int64_t fan = 0;
+    while (fan < int64_t(vertexCount) && live[size_t(fan)] == 0)
+    {
+        ++fan;
+    }
+    if (fan >= int64_t(vertexCount))
+    {
+        return;
+    }
+
+    while (fan >= 0)
+    {
+        // fan のまわりのまだ出していない三角形を出す
+        candidates.clear();
+        for (uint32_t k = adjacency.offsets[size_t(fan)]; k < adjacency.offsets[size_t(fan) + 1]; ++k)
+        {
+            uint32_t t = adjacency.triangles[k];
+            if (emitted[t])
+            {
+                continue;
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t v = indices[t * 3 + c];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - stamps[v] > uint32_t(cacheSize))
+                {
+                    stamps[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // 次の頂点は、残りの三角形を出してもキャッシュに残っているもののうち最も古いもの
+        fan = -1;
+        int64_t best = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0)
+            {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - stamps[v] + 2 * live[v] <= uint32_t(cacheSize))
+            {
+                priority = time - stamps[v];
+            }
+            if (priority > best)
+            {
+                best = priority;
+                fan = v;
+            }
+        }
+
+        // 行き詰まったら最近使った頂点、それもなければ番号順に残っているものを探す
+        if (fan < 0)
+        {
+            while (!deadEnd.empty())
+            {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0)
+                {
+                    fan = v;
+                    break;
+                }
+            }
+        }
+        if (fan < 0)
+        {
+            while (cursor < vertexCount && live[cursor] == 0)
+            {
+                ++cursor;
+            }
+            if (cursor < vertexCount)
+            {
+                fan = int64_t(cursor);
+            }
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+
+// -----------------------------------------------------------------------------
+// オーバードローの最適化
+// 三角形の並びを、キャッシュの効率を threshold 倍以上悪くしない範囲でまとまりに分け、
+// メッシュの中心から外を向いているまとまりから先に描く（手前にきやすく、後ろの面が深度テストで落ちる）
+// -----------------------------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Vector3> positions, float threshold, int cacheSize)
+{
+    if (!isTriangleList(indices, positions.size()))
+    {
+        return;
+    }
+
+    const size_t triangleCount = indices.size() / 3;
+    FifoCache cache(positions.size(), cacheSize);
+
+    // 3 頂点ともキャッシュに無い三角形で区切る（Tipsify が行き詰まって飛んだ場所）
+    std::vector<uint32_t> hard;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int misses = cache.miss(indices[t * 3]) + cache.miss(indices[t * 3 + 1]) + cache.miss(indices[t * 3 + 2]);
+        if (misses == 3)
+        {
+            hard.push_back(uint32_t(t));
+        }
+    }
+    hard.push_back(uint32_t(triangleCount));
+
+    // 区切りの中を、ACMR が全体の threshold 倍以下に収まったところでさらに区切る
+    std::vector<uint32_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h)
+    {
+        uint32_t begin = hard[h];
+        uint32_t end = hard[h + 1];
+
+        cache.reset();
+        size_t totalMisses = 0;
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            totalMisses += cache.miss(indices[t * 3]) + cache.miss(indices[t * 3 + 1]) + cache.miss(indices[t * 3 + 2]);
+        }
+        float limit = float(totalMisses) / float(end - begin) * threshold;
+
+        cache.reset();
+        clusters.push_back(begin);
+        size_t misses = 0;
+        uint32_t start = begin;
+        for (uint32_t t = begin; t < end; ++t)
+        {
+            misses += cache.miss(indices[t * 3]) + cache.miss(indices[t * 3 + 1]) + cache.miss(indices[t * 3 + 2]);
+            if (t + 1 < end && float(misses) / float(t - start + 1) <= limit)
+            {
+                clusters.push_back(t + 1);
+                cache.reset();
+                misses = 0;
+                start = t + 1;
+            }
+        }
+    }
+    clusters.push_back(uint32_t(triangleCount));
+
+    // メッシュの中心（面積で重み付け）
+    Vector3 meshCenter = Vector3::Zero;
+    float meshArea = 0.0f;
+    std::vector<Vector3> clusterCenters(clusters.size() - 1, Vector3::Zero);
+    std::vector<Vector3> clusterNormals(clusters.size() - 1, Vector3::Zero);
+    for (size_t c = 0; c + 1 < clusters.size(); ++c)
+    {
+        float clusterArea = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const Vector3& p0 = positions[indices[t * 3]];
+            const Vector3& p1 = positions[indices[t * 3 + 1]];
+            const Vector3& p2 = positions[indices[t * 3 + 2]];
+            Vector3 normal = (p1 - p0).Cross(p2 - p0);  // 長さは面積の 2 倍
+            float area = normal.Length();
+            Vector3 center = (p0 + p1 + p2) / 3.0f;
+
+            clusterCenters[c] += center * area;
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+        meshCenter += clusterCenters[c];
+        meshArea += clusterArea;
+        clusterCenters[c] = clusterArea > 0.0f ? clusterCenters[c] / clusterArea : positions[indices[clusters[c] * 3]];
+        clusterNormals[c].Normalize();
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCenter /= meshArea;
+    }
+
+    // 外を向いているものから
+    std::vector<float> sortKey(clusters.size() - 1);
+    std::vector<uint32_t> order(clusters.size() - 1);
+    for (size_t c = 0; c < order.size(); ++c)
+    {
+        sortKey[c] = (clusterCenters[c] - meshCenter).Dot(clusterNormals[c]);
+        order[c] = uint32_t(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+    {
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+
+// -----------------------------------------------------------------------------
+// 頂点フェッチの最適化
+// -----------------------------------------------------------------------------
+size_t MeshOptimizer::OptimizeVertexFetch(OwnedSubMesh& sub)
+{
+    const size_t vertexCount = sub.positions.size();
+    if (!isTriangleList(sub.indices, vertexCount))
+    {
+        return vertexCount;
+    }
+    ensureOwned(sub, sub.indices, &OwnedSubMesh::resizeIndices, &OwnedSubMesh::mutableIndices);
+
+    // 最初に使われた順に新しい番号を振る
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    auto& indices = const_cast<std::vector<uint32_t>&>(sub.mutableIndices());
+    uint32_t next = 0;
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    remapAttribute(sub, sub.positions, remap, next, &OwnedSubMesh::resizePositions, &OwnedSubMesh::mutablePositions);
+    remapAttribute(sub, sub.normals, remap, next, &OwnedSubMesh::resizeNormals, &OwnedSubMesh::mutableNormals);
+    remapAttribute(sub, sub.colors, remap, next, &OwnedSubMesh::resizeColors, &OwnedSubMesh::mutableColors);
+    remapAttribute(sub, sub.uv, remap, next, &OwnedSubMesh::resizeUV, &OwnedSubMesh::mutableUV);
+    remapAttribute(sub, sub.uv2, remap, next, &OwnedSubMesh::resizeUV2, &OwnedSubMesh::mutableUV2);
+    remapAttribute(sub, sub.uv3, remap, next, &OwnedSubMesh::resizeUV3, &OwnedSubMesh::mutableUV3);
+    remapAttribute(sub, sub.uv4, remap, next, &OwnedSubMesh::resizeUV4, &OwnedSubMesh::mutableUV4);
+    return next;
+}
+
+
+// -----------------------------------------------------------------------------
+// 頂点キャッシュの効率
+// -----------------------------------------------------------------------------
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, int cacheSize)
+{
+    VertexCacheStatistics stats;
+    if (!isTriangleList(indices, vertexCount))
+    {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    for (uint32_t index : indices)
+    {
+        stats.transformedCount += cache.miss(index);
+        if (!used[index])
+        {
+            used[index] = true;
+            stats.vertexCount++;
+        }
+    }
+    stats.triangleCount = indices.size() / 3;
+    stats.acmr = float(stats.transformedCount) / float(stats.triangleCount);
+    stats.atvr = float(stats.transformedCount) / float(stats.vertexCount);
+    return stats;
+}
+
+
+void MeshOptimizer::setEnabled(bool enabled)
+{
+    optimizerEnabled = enabled;
+}
+
+
+bool MeshOptimizer::isEnabled()
+{
+    return optimizerEnabled;
+}
+
+} // namespace UniDx
@@ -0,0 +1,444 @@
+﻿#include "pch.h"
+#include <UniDx/MeshSimplifier.h>
+
+#include <UniDx/MeshOptimizer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    std::atomic<int> importLODCount = 0;
+
+    // 平面までの距離の二乗の和を表す対称行列（面積で重み付け）
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double weight = 0;
+
+        void addPlane(const Vector3& n, double d, double w)
+        {
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        // p に置いたときの平面までの距離の二乗の平均
+        double error(const Vector3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z
+                + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return std::max(e, 0.0) / std::max(weight, 1e-20);
+        }
+    };
+
+    // 辺を潰す候補（from の位置の頂点を to の位置に寄せる）
+    struct Collapse
+    {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    // 位置ごとにまとめた頂点で辺を潰していく
+    class Simplifier
+    {
+    public:
+        Simplifier(std::span<const uint32_t> indices, std::span<const Vector3> positions)
+            : positions_(positions), triangles_(indices.begin(), indices.end())
+        {
+            weldPositions();
+            buildAdjacency();
+            lockBorders();
+            computeQuadrics();
+        }
+
+        float run(size_t targetIndexCount, float targetError)
+        {
+            // 誤差はメッシュの大きさに対する割合で指定される
+            Vector3 mn = positions_.empty() ? Vector3::Zero : positions_[0];
+            Vector3 mx = mn;
+            for (const Vector3& p : positions_)
+            {
+                mn = Vector3::Min(mn, p);
+                mx = Vector3::Max(mx, p);
+            }
+            Vector3 extent = mx - mn;
+            double scale = std::max({ double(extent.x), double(extent.y), double(extent.z), 1e-20 });
+            double limit = double(targetError) * scale;
+            double limitSq = limit * limit;
+
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+            for (size_t t = 0; t < alive_.size(); ++t)
+            {
+                pushEdges(queue, uint32_t(t));
+            }
+
+            double maxErrorSq = 0.0;
+            while (liveTriangles_ * 3 > targetIndexCount && !queue.empty())
+            {
+                Collapse top = queue.top();
+                queue.pop();
+                if (top.cost > limitSq)
+                {
+                    break;
+                }
+                if (removed_[top.from] || removed_[top.to] || locked_[top.from])
+                {
+                    continue;
+                }
+
+                // 先に潰した辺で誤差が変わっていれば入れ直す
+                double cost = quadrics_[top.from].error(groupPosition(top.to));
+                if (cost > top.cost * (1.0 + 1e-6) + 1e-30)
+                {
+                    queue.push(Collapse{ cost, top.from, top.to });
+                    continue;
+                }
+
+                if (collapse(top.from, top.to))
+                {
+                    maxErrorSq = std::max(maxErrorSq, cost);
+                    for (uint32_t t : groupTriangles_[top.to])
+                    {
+                        if (alive_[t])
+                        {
+                            pushEdges(queue, t);
+                        }
+                    }
+                }
+            }
+            return float(std::sqrt(maxErrorSq) / scale);
+        }
+
+        // 残った三角形を元の順に並べる
+        std::vector<uint32_t> result() const
+        {
+            std::vector<uint32_t> out;
+            out.reserve(liveTriangles_ * 3);
+            for (size_t t = 0; t < alive_.size(); ++t)
+            {
+                if (alive_[t])
+                {
+                    out.insert(out.end(), triangles_.begin() + t * 3, triangles_.begin() + t * 3 + 3);
+                }
+            }
+            return out;
+        }
+
+    private:
+        std::span<const Vector3> positions_;
+        std::vector<uint32_t> triangles_;           // 潰すたびに書き換える
+        std::vector<bool> alive_;
+        size_t liveTriangles_ = 0;
+
+        std::vector<uint32_t> group_;               // 頂点ごとの、同じ位置の頂点のまとまりの番号
+        std::vector<uint32_t> groupVertex_;         // まとまりの代表の頂点
+        std::vector<std::vector<uint32_t>> groupTriangles_;
+        std::vector<Quadric> quadrics_;
+        std::vector<bool> locked_;
+        std::vector<bool> removed_;
+
+        // 潰すときの頂点の寄せ先（作業用）
+        std::unordered_map<uint32_t, uint32_t> remap_;
+
+        const Vector3& groupPosition(uint32_t g) const { return positions_[groupVertex_[g]]; }
+
+        void weldPositions()
+        {
+            struct PositionHash
+            {
+                size_t operator()(const Vector3& p) const
+                {
+                    uint32_t h[3];
+                    std::memcpy(h, &p, sizeof(h));
+                    return size_t(h[0] * 73856093u ^ h[1] * 19349663u ^ h[2] * 83492791u);
+                }
+            };
+            struct PositionEqual
+            {
+                bool operator()(const Vector3& a, const Vector3& b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+            };
+
+            std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> groups;
+            group_.resize(positions_.size());
+            for (size_t v = 0; v < positions_.size(); ++v)
+            {
+                auto [it, inserted] = groups.emplace(positions_[v], uint32_t(groupVertex_.size()));
+                if (inserted)
+                {
+                    groupVertex_.push_back(uint32_t(v));
+                }
+                group_[v] = it->second;
+            }
+        }
+
+        void buildAdjacency()
+        {
+            size_t triangleCount = triangles_.size() / 3;
+            alive_.assign(triangleCount, true);
+            liveTriangles_ = triangleCount;
+            groupTriangles_.resize(groupVertex_.size());
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                uint32_t g0 = group_[triangles_[t * 3]];
+                uint32_t g1 = group_[triangles_[t * 3 + 1]];
+                uint32_t g2 = group_[triangles_[t * 3 + 2]];
+                if (g0 == g1 || g1 == g2 || g2 == g0)
+                {
+                    // はじめから潰れている三角形は捨てる
+                    alive_[t] = false;
+                    liveTriangles_--;
+                    continue;
+                }
+                groupTriangles_[g0].push_back(uint32_t(t));
+                groupTriangles_[g1].push_back(uint32_t(t));
+                groupTriangles_[g2].push_back(uint32_t(t));
+            }
+            removed_.assign(groupVertex_.size(), false);
+        }
+
+        // 三角形ひとつだけが使う辺（開いた縁）と、3 つ以上が使う辺の頂点は動かさない
+        void lockBorders()
+        {
+            locked_.assign(groupVertex_.size(), false);
+            std::unordered_map<uint64_t, uint32_t> edges;
+            for (size_t t = 0; t < alive_.size(); ++t)
+            {
+                if (!alive_[t]) continue;
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint32_t a = group_[triangles_[t * 3 + c]];
+                    uint32_t b = group_[triangles_[t * 3 + (c + 1) % 3]];
+                    edges[uint64_t(std::min(a, b)) << 32 | std::max(a, b)]++;
+                }
+            }
+            for (const auto& [key, count] : edges)
+            {
+                if (count != 2)
+                {
+                    locked_[uint32_t(key >> 32)] = true;
+                    locked_[uint32_t(key & 0xffffffffu)] = true;
+                }
+            }
+        }
+
+        void computeQuadrics()
+        {
+            quadrics_.assign(groupVertex_.size(), Quadric());
+            for (size_t t = 0; t < alive_.size(); ++t)
+            {
+                if (!alive_[t]) continue;
+                const Vector3& p0 = positions_[triangles_[t * 3]];
+                const Vector3& p1 = positions_[triangles_[t * 3 + 1]];
+                const Vector3& p2 = positions_[triangles_[t * 3 + 2]];
+                Vector3 n = (p1 - p0).Cross(p2 - p0);
+                float length = n.Length();
+                if (length <= 0.0f) continue;
+                n /= length;
+                double d = -double(n.Dot(p0));
+                double area = length * 0.5;
+                for (int c = 0; c < 3; ++c)
+                {
+                    quadrics_[group_[triangles_[t * 3 + c]]].addPlane(n, d, area);
+                }
+            }
+        }
+
+        template<typename Queue>
+        void pushEdges(Queue& queue, uint32_t t)
+        {
+            if (!alive_[t]) return;
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t a = group_[triangles_[t * 3 + c]];
+                uint32_t b = group_[triangles_[t * 3 + (c + 1) % 3]];
+                if (!locked_[a]) queue.push(Collapse{ quadrics_[a].error(groupPosition(b)), a, b });
+                if (!locked_[b]) queue.push(Collapse{ quadrics_[b].error(groupPosition(a)), b, a });
+            }
+        }
+
+        // 三角形の中で、まとまり g に属する頂点の位置（なければ -1）
+        int corner(uint32_t t, uint32_t g) const
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                if (group_[triangles_[t * 3 + c]] == g) return c;
+            }
+            return -1;
+        }
+
+        // from のまとまりの頂点を to のまとまりの頂点に寄せる。寄せられなければ false
+        bool collapse(uint32_t from, uint32_t to)
+        {
+            // 辺を共有している三角形から、from の各頂点の寄せ先を決める
+            // 継ぎ目では UV などの続いている側の頂点に寄せる
+            remap_.clear();
+            bool edgeExists = false;
+            for (uint32_t t : groupTriangles_[from])
+            {
+                if (!alive_[t]) continue;
+                int cf = corner(t, from);
+                int ct = corner(t, to);
+                if (ct < 0) continue;
+                edgeExists = true;
+                uint32_t vf = triangles_[t * 3 + cf];
+                uint32_t vt = triangles_[t * 3 + ct];
+                auto [it, inserted] = remap_.emplace(vf, vt);
+                if (!inserted && it->second != vt)
+                {
+                    return false;   // 同じ頂点の寄せ先が二通りある
+                }
+            }
+            if (!edgeExists)
+            {
+                return false;
+            }
+
+            // 残る三角形がすべて寄せられ、裏返らないか
+            const Vector3& target = groupPosition(to);
+            for (uint32_t t : groupTriangles_[from])
+            {
+                if (!alive_[t] || corner(t, to) >= 0) continue;
+                int cf = corner(t, from);
+                if (remap_.find(triangles_[t * 3 + cf]) == remap_.end())
+                {
+                    return false;
+                }
+
+                Vector3 p[3] = { positions_[triangles_[t * 3]], positions_[triangles_[t * 3 + 1]], positions_[triangles_[t * 3 + 2]] };
+                Vector3 before = (p[1] - p[0]).Cross(p[2] - p[0]);
+                p[cf] = target;
+                Vector3 after = (p[1] - p[0]).Cross(p[2] - p[0]);
+                if (before.Dot(after) <= 0.0f)
+                {
+                    return false;
+                }
+            }
+
+            // 寄せる
+            for (uint32_t t : groupTriangles_[from])
+            {
+                if (!alive_[t]) continue;
+                if (corner(t, to) >= 0)
+                {
+                    alive_[t] = false;
+                    liveTriangles_--;
+                    continue;
+                }
+                int cf = corner(t, from);
+                triangles_[t * 3 + cf] = remap_[triangles_[t * 3 + cf]];
+                groupTriangles_[to].push_back(t);
+            }
+            for (auto& [vf, vt] : remap_)
+            {
+                group_[vf] = to;
+            }
+            quadrics_[to].add(quadrics_[from]);
+            removed_[from] = true;
+            groupTriangles_[from].clear();
+
+            // 消えた三角形と重複を取り除く
+            auto& list = groupTriangles_[to];
+            list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t) { return !alive_[t]; }), list.end());
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            return true;
+        }
+    };
+}
+
+
+// -----------------------------------------------------------------------------
+// 簡略化
+// -----------------------------------------------------------------------------
+std::vector<uint32_t> MeshSimplifier::Simplify(std::span<const uint32_t> indices, std::span<const Vector3> positions,
+    size_t targetIndexCount, float targetError, float* resultError)
+{
+    if (resultError != nullptr)
+    {
+        *resultError = 0.0f;
+    }
+    if (indices.size() % 3 != 0
+        || std::any_of(indices.begin(), indices.end(), [&](uint32_t i) { return i >= positions.size(); }))
+    {
+        return std::vector<uint32_t>(indices.begin(), indices.end());
+    }
+
+    Simplifier simplifier(indices, positions);
+    float error = simplifier.run(targetIndexCount, targetError);
+    if (resultError != nullptr)
+    {
+        *resultError = error;
+    }
+    return simplifier.result();
+}
+
+
+// -----------------------------------------------------------------------------
+// LOD の作成
+// -----------------------------------------------------------------------------
+void MeshSimplifier::GenerateLODs(OwnedSubMesh& sub, int levelCount, float ratio, float targetError)
+{
+    if (sub.topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST || sub.indices.empty())
+    {
+        return;
+    }
+
+    size_t previous = sub.indices.size();
+    for (int level = 1; level <= levelCount; ++level)
+    {
+        size_t target = size_t(double(sub.indices.size()) * std::pow(double(ratio), level)) / 3 * 3;
+        float error = 0.0f;
+        std::vector<uint32_t> lod = Simplify(sub.indices, sub.positions, target, targetError, &error);
+
+        // あまり減らなくなったらそれより粗い段は作らない
+        if (lod.empty() || double(lod.size()) > double(previous) * 0.9)
+        {
+            break;
+        }
+        if (MeshOptimizer::isEnabled())
+        {
+            MeshOptimizer::OptimizeVertexCache(lod, sub.positions.size());
+        }
+        previous = lod.size();
+        sub.addLOD(std::move(lod), error);
+    }
+}
+
+
+void MeshSimplifier::setImportLODCount(int count)
+{
+    importLODCount = std::max(count, 0);
+}
+
+
+int MeshSimplifier::getImportLODCount()
+{
+    return importLODCount;
+}
+
+} // namespace UniDx
@@ -5,6 +5,8 @@
 
 #include <UniDx/Collider.h>
 #include <UniDx/Rigidbody.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/LinearAllocator.h>
 
 
 namespace UniDx
@@ -16,9 +18,32 @@ namespace UniDx
     void PhysicsShape::initialize(Collider* collider)
     {
         collider_ = collider;
+        boundsVersion_ = 0;
         // moveBounds
     }
 
+    // ワールド空間における空間境界を取得
+    Bounds PhysicsShape::getBounds()
+    {
+        if (collider_->attachedRigidbody != nullptr)
+        {
+            return collider_->getBounds();
+        }
+
+        // 静的なコライダーは動いたときか center, size, radius が変わったときだけ再計算
+        uint64_t version = collider_->transform->getChangeVersion();
+        Bounds shape = collider_->getShapeBounds();
+        if (version != boundsVersion_ ||
+            Vector3(shape.Center) != Vector3(shapeBounds_.Center) ||
+            Vector3(shape.Extents) != Vector3(shapeBounds_.Extents))
+        {
+            bounds_ = collider_->getBounds();
+            shapeBounds_ = shape;
+            boundsVersion_ = version;
+        }
+        return bounds_;
+    }
+
     // 衝突対象の新旧を調べて OnTrigger～, OnCollidion～ を呼ぶ
     void PhysicsShape::collideCallback()
     {
@@ -174,7 +199,7 @@ namespace UniDx
         {
             shape.initOtherNew();
 
-            Bounds bounds = shape.getCollider()->getBounds();
+            Bounds bounds = shape.getBounds();
             auto rb = shape.getCollider()->attachedRigidbody;
             if (rb != nullptr)
             {
@@ -198,32 +223,40 @@ namespace UniDx
     // 位置補正法（射影法）による物理計算のシミュレート
     void Physics::simulatePositionCorrection(float step)
     {
-        initializeSimulate(step);
+        {
+            UNIDX_PROFILE_SCOPE("Physics::Initialize");
+            initializeSimulate(step);
+        }
+
+        LinearAllocator& stepMemory = FrameMemory::getInstance()->fixedStep();
+        TransientVector<PotentialPair> potentialPairs(stepMemory);
+        TransientVector<PotentialPair> potentialPairsTrigger(stepMemory);
 
         // まずは当たりそうなペアをAABBで判定して抽出
-        potentialPairs.clear();
-        potentialPairsTrigger.clear();
-        for (size_t i = 0; i < physicsShapes.size(); ++i)
         {
-            for (size_t j = i + 1; j < physicsShapes.size(); ++j)
+            UNIDX_PROFILE_SCOPE("Physics::BroadPhase");
+            for (size_t i = 0; i < physicsShapes.size(); ++i)
             {
-                if (physicsShapes[i].moveBounds.Intersects(physicsShapes[j].moveBounds))
+                for (size_t j = i + 1; j < physicsShapes.size(); ++j)
                 {
-                    // 同じ Rigidbody に属しているコンパウンド同士は自己衝突なのでスキップ
-                    auto rbA = physicsShapes[i].getCollider()->attachedRigidbody;
-                    auto rbB = physicsShapes[j].getCollider()->attachedRigidbody;
-                    if (rbA && rbA == rbB) continue;
-
-                    // ペアを記憶
-                    if (physicsShapes[i].getCollider()->isTrigger || physicsShapes[j].getCollider()->isTrigger)
+                    if (physicsShapes[i].moveBounds.Intersects(physicsShapes[j].moveBounds))
                     {
-                        // トリガー
-                        potentialPairsTrigger.push_back({ &physicsShapes[i], &physicsShapes[j] });
-                    }
-                    else
-                    {
-                        // コリジョン
-                        potentialPairs.push_back({ &physicsShapes[i], &physicsShapes[j] });
+                        // 同じ Rigidbody に属しているコンパウンド同士は自己衝突なのでスキップ
+                        auto rbA = physicsShapes[i].getCollider()->attachedRigidbody;
+                        auto rbB = physicsShapes[j].getCollider()->attachedRigidbody;
+                        if (rbA && rbA == rbB) continue;
+
+                        // ペアを記憶
+                        if (physicsShapes[i].getCollider()->isTrigger || physicsShapes[j].getCollider()->isTrigger)
+                        {
+                            // トリガー
+                            potentialPairsTrigger.push_back({ &physicsShapes[i], &physicsShapes[j] });
+                        }
+                        else
+                        {
+                            // コリジョン
+                            potentialPairs.push_back({ &physicsShapes[i], &physicsShapes[j] });
+                        }
                     }
                 }
             }
@@ -236,41 +269,50 @@ namespace UniDx
         }
 
         // トリガーチェックする
-        for (auto& pair : potentialPairsTrigger)
         {
-            if (pair.a->getCollider()->intersects(pair.b->getCollider()))
+            UNIDX_PROFILE_SCOPE("Physics::NarrowPhase");
+            for (auto& pair : potentialPairsTrigger)
             {
-                pair.a->addTrigger(pair.b->getCollider());
-                pair.b->addTrigger(pair.a->getCollider());
+                if (pair.a->getCollider()->intersects(pair.b->getCollider()))
+                {
+                    pair.a->addTrigger(pair.b->getCollider());
+                    pair.b->addTrigger(pair.a->getCollider());
+                }
             }
-        }
 
-        // 衝突をチェックする
-        for (auto& pair : potentialPairs)
-        {
-            if (pair.a->getCollider()->checkIntersect(pair.b->getCollider(), pair.a->actor, pair.b->actor))
+            // 衝突をチェックする
+            for (auto& pair : potentialPairs)
             {
-                Collision ca;
-                ca.collider = pair.b->getCollider();
-                pair.a->addCollide(ca);
+                if (pair.a->getCollider()->checkIntersect(pair.b->getCollider(), pair.a->actor, pair.b->actor))
+                {
+                    Collision ca;
+                    ca.collider = pair.b->getCollider();
+                    pair.a->addCollide(ca);
 
-                Collision cb;
-                cb.collider = pair.a->getCollider();
-                pair.b->addCollide(cb);
+                    Collision cb;
+                    cb.collider = pair.a->getCollider();
+                    pair.b->addCollide(cb);
+                }
             }
         }
 
         // 衝突で生じた補正を含めて位置と速度を解決する
-        for (auto& act : physicsActors)
         {
-            act.second.getRigidbody()->solveCorrection(act.second.getCorrectPositionBounds(), act.second.getCorrectVelocityBounds());
+            UNIDX_PROFILE_SCOPE("Physics::Solve");
+            for (auto& act : physicsActors)
+            {
+                act.second.getRigidbody()->solveCorrection(act.second.getCorrectPositionBounds(), act.second.getCorrectVelocityBounds());
+            }
         }
 
         // OnTrigger～, OnCollision～等のコールバックを呼び出す
         // TODO: 当たったRigidbodyがついているGameObjectでも呼び出す
-        for (auto& shape : physicsShapes)
         {
-            shape.collideCallback();
+            UNIDX_PROFILE_SCOPE("Physics::Callbacks");
+            for (auto& shape : physicsShapes)
+            {
+                shape.collideCallback();
+            }
         }
     }
 
@@ -280,8 +322,10 @@ namespace UniDx
     {
         initializeSimulate(step);
 
+        LinearAllocator& stepMemory = FrameMemory::getInstance()->fixedStep();
+
         // まずは当たりそうなペアをAABBで判定して抽出
-        potentialPairs.clear();
+        TransientVector<PotentialPair> potentialPairs(stepMemory);
         for (size_t i = 0; i < physicsShapes.size(); ++i)
         {
             for (size_t j = i + 1; j < physicsShapes.size(); ++j)
@@ -300,7 +344,7 @@ namespace UniDx
         }
 
         // 形状ごとに実衝突を確定する
-        manifolds.clear();
+        TransientVector<ContactManifold> manifolds(stepMemory);
         for (auto& pair : potentialPairs)
         {
             ContactManifold m;
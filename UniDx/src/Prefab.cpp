@@ -0,0 +1,110 @@
+﻿#include "pch.h"
+#include <UniDx/Prefab.h>
+
+#include <UniDx/SceneManager.h>
+
+
+namespace UniDx
+{
+
+Prefab::Prefab(Factory factory, size_t poolCapacity) :
+    factory_(std::move(factory)),
+    poolCapacity_(poolCapacity)
+{
+    pool_.reserve(poolCapacity_);
+}
+
+
+Prefab::~Prefab()
+{
+}
+
+
+void Prefab::setPoolCapacity(size_t capacity)
+{
+    poolCapacity_ = capacity;
+    if (pool_.size() > poolCapacity_)
+    {
+        pool_.resize(poolCapacity_);
+    }
+    pool_.reserve(poolCapacity_);
+}
+
+
+void Prefab::Prewarm(size_t count)
+{
+    count = std::min(count, poolCapacity_);
+    while (pool_.size() < count)
+    {
+        auto object = factory_();
+        object->prefab_ = weak_from_this();
+        object->SetActive(false);
+        pool_.push_back(std::move(object));
+    }
+}
+
+
+unique_ptr<GameObject> Prefab::create(bool& fromPool)
+{
+    if (!pool_.empty())
+    {
+        auto object = std::move(pool_.back());
+        pool_.pop_back();
+        fromPool = true;
+        return object;
+    }
+
+    auto object = factory_();
+    if (poolCapacity_ > 0)
+    {
+        object->prefab_ = weak_from_this();
+    }
+    fromPool = false;
+    return object;
+}
+
+
+bool Prefab::release(unique_ptr<GameObject>& object)
+{
+    if (pool_.size() >= poolCapacity_)
+    {
+        return false;
+    }
+
+    object->SetActive(false);
+    pool_.push_back(std::move(object));
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// Instantiate / Destroy
+// -----------------------------------------------------------------------------
+GameObject* Instantiate(const std::shared_ptr<Prefab>& prefab, const Vector3& position, const Quaternion& rotation, Transform* parent)
+{
+    bool fromPool = false;
+    auto object = prefab->create(fromPool);
+    object->transform->localPosition = position;
+    object->transform->localRotation = rotation;
+
+    // プールから取り出したものはシーンに追加するときにアクティブにする
+    return SceneManager::getInstance()->instantiate(std::move(object), parent, fromPool);
+}
+
+
+GameObject* Instantiate(unique_ptr<GameObject> object, Transform* parent)
+{
+    return SceneManager::getInstance()->instantiate(std::move(object), parent, false);
+}
+
+
+void Destroy(GameObject* object, float delay)
+{
+    if (object == nullptr)
+    {
+        return;
+    }
+    SceneManager::getInstance()->destroy(object, delay);
+}
+
+} // namespace UniDx
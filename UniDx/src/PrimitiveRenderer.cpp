@@ -3,6 +3,10 @@
 
 #include <UniDx/Texture.h>
 #include <UniDx/Camera.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/SceneSerializer.h>
+
+#include <mutex>
 
 // キューブの1面あたり4頂点、3面で12頂点、2セットで24頂点
 namespace {
@@ -61,6 +65,27 @@ namespace UniDx {
 void CubeRenderer::OnEnable()
 {
     MeshRenderer::OnEnable();
+    createMesh();
+
+    // 再度有効になったときは作り直さない。ヘッドレスモードではGPUリソースを作らない
+    SubMesh* submesh = mesh.submesh.front().get();
+    if (submesh->vertexBuffer != nullptr || !D3DManager::isAvailable())
+    {
+        return;
+    }
+    if (createBufer_ != nullptr)
+    {
+        createBufer_(submesh);
+    }
+}
+
+
+void CubeRenderer::createMesh()
+{
+    if (!mesh.submesh.empty())
+    {
+        return;
+    }
 
     // メッシュの初期化
     auto submesh = std::make_unique<SubMesh>();
@@ -68,17 +93,36 @@ void CubeRenderer::OnEnable()
     submesh->uv = std::span<const Vector2>(cube_uvs, std::size(cube_uvs));
     submesh->normals = std::span<const Vector3>(cube_normals, std::size(cube_normals));
     submesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    if (createBufer_ != nullptr)
-    {
-        createBufer_(submesh.get());
-    }
 
     mesh.submesh.push_back(std::move(submesh));
 }
 
 
+// 頂点の型とマテリアル。メッシュは有効化したときに作る
+void CubeRenderer::Serialize(SceneWriter& writer) const
+{
+    writer.writeVertexType(vertexLayout_);
+    serializeMaterials(writer);
+}
+
+
+void CubeRenderer::Deserialize(SceneReader& reader)
+{
+    if (const SceneVertexType* vertex = reader.readVertexType())
+    {
+        createBufer_ = vertex->createBuffer;
+        vertexLayout_ = vertex->layout;
+    }
+    deserializeMaterials(reader);
+}
+
+
 void SphereRenderer::createVertex()
 {
+    // 複数のエンジンのスレッドから同時に作らないように
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
     if (indices.size() > 0)
     {
         return;
@@ -133,6 +177,27 @@ std::vector<uint32_t> SphereRenderer::indices;
 void SphereRenderer::OnEnable()
 {
     MeshRenderer::OnEnable();
+    createMesh();
+
+    // 再度有効になったときは作り直さない。ヘッドレスモードではGPUリソースを作らない
+    SubMesh* submesh = mesh.submesh.front().get();
+    if (submesh->vertexBuffer != nullptr || !D3DManager::isAvailable())
+    {
+        return;
+    }
+    if (createBufer_ != nullptr)
+    {
+        createBufer_(submesh);
+    }
+}
+
+
+void SphereRenderer::createMesh()
+{
+    if (!mesh.submesh.empty())
+    {
+        return;
+    }
 
     createVertex();
 
@@ -142,12 +207,26 @@ void SphereRenderer::OnEnable()
     submesh->uv = std::span<const Vector2>(uvs.data(), uvs.size());
     submesh->indices = std::span<const uint32_t>(indices.data(), indices.size());
     submesh->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    if (createBufer_ != nullptr)
-    {
-        createBufer_(submesh.get());
-    }
 
     mesh.submesh.push_back(std::move(submesh));
 }
 
+
+void SphereRenderer::Serialize(SceneWriter& writer) const
+{
+    writer.writeVertexType(vertexLayout_);
+    serializeMaterials(writer);
+}
+
+
+void SphereRenderer::Deserialize(SceneReader& reader)
+{
+    if (const SceneVertexType* vertex = reader.readVertexType())
+    {
+        createBufer_ = vertex->createBuffer;
+        vertexLayout_ = vertex->layout;
+    }
+    deserializeMaterials(reader);
+}
+
 }
\ No newline at end of file
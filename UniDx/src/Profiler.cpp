@@ -0,0 +1,289 @@
+﻿#include "pch.h"
+#include <UniDx/Profiler.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <iomanip>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+    const clock::time_point epoch = clock::now();
+
+    struct ProfileEvent
+    {
+        const char* name;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // スレッドごとのリングバッファ
+    // 書き込むのは所有スレッドだけなので、ロックせずに書き込み数を進める
+    // 書き出しは書き込みと並行して読むので、上書きを始める前に claimed を進めておき、
+    // 読んだ後に claimed を見て、読んでいる間に上書きされたイベントを捨てる
+    struct ThreadBuffer
+    {
+        uint32_t threadId = 0;
+        std::string name;
+        std::unique_ptr<ProfileEvent[]> events;
+        std::atomic<uint64_t> claimed = 0;  // 書き込みを始めたイベントの数
+        std::atomic<uint64_t> written = 0;  // 書き込みを終えたイベントの数
+        uint64_t captureStart = 0;          // 計測を開始したときの written（registryMutex で保護）
+    };
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;  // スレッドが終了しても書き出せるように保持する
+
+    std::atomic<bool> capturing = false;
+    uint64_t captureBegin = 0;
+    uint64_t captureEnd = 0;
+    double captureDuration = 0.0;
+    std::wstring capturePath;
+
+    thread_local ThreadBuffer* localBuffer = nullptr;
+
+    ThreadBuffer* getLocalBuffer()
+    {
+        if (localBuffer == nullptr)
+        {
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->events = std::make_unique<ProfileEvent[]>(Profiler::EventCapacity);
+
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffer->threadId = uint32_t(buffers.size() + 1);
+            if (buffer->name.empty())
+            {
+                buffer->name = "Thread " + std::to_string(buffer->threadId);
+            }
+            localBuffer = buffer.get();
+            buffers.push_back(std::move(buffer));
+        }
+        return localBuffer;
+    }
+
+    // イベントの読み書き
+    // 書き出し中のスレッドと同じ場所を触ることがあるので、フィールドごとに atomic で読み書きする
+    void storeEvent(ProfileEvent& slot, const ProfileEvent& e)
+    {
+        std::atomic_ref<const char*>(slot.name).store(e.name, std::memory_order_relaxed);
+        std::atomic_ref<uint64_t>(slot.begin).store(e.begin, std::memory_order_relaxed);
+        std::atomic_ref<uint64_t>(slot.end).store(e.end, std::memory_order_relaxed);
+    }
+
+    ProfileEvent loadEvent(ProfileEvent& slot)
+    {
+        return ProfileEvent{
+            std::atomic_ref<const char*>(slot.name).load(std::memory_order_relaxed),
+            std::atomic_ref<uint64_t>(slot.begin).load(std::memory_order_relaxed),
+            std::atomic_ref<uint64_t>(slot.end).load(std::memory_order_relaxed) };
+    }
+
+    // JSON 文字列のエスケープ
+    void writeJsonString(std::ofstream& out, const char* s)
+    {
+        out << '"';
+        for (; *s != '\0'; ++s)
+        {
+            char c = *s;
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                out << ' ';
+            }
+            else
+            {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 計測開始・終了
+// -----------------------------------------------------------------------------
+void Profiler::BeginCapture(double durationSeconds, const std::wstring& outputPath)
+{
+    {
+        // ここより前のイベントは、上書きされても失われたとは数えない
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& buffer : buffers)
+        {
+            buffer->captureStart = buffer->written.load(std::memory_order_acquire);
+        }
+    }
+
+    captureBegin = now();
+    captureEnd = UINT64_MAX;
+    captureDuration = durationSeconds;
+    capturePath = outputPath;
+    capturing = true;
+}
+
+
+void Profiler::EndCapture()
+{
+    capturing = false;
+    captureEnd = now();
+}
+
+
+bool Profiler::isCapturing()
+{
+    return capturing.load(std::memory_order_relaxed);
+}
+
+
+// -----------------------------------------------------------------------------
+// 時間指定の計測の終了
+// -----------------------------------------------------------------------------
+void Profiler::endFrame()
+{
+    if (!isCapturing() || captureDuration <= 0.0)
+    {
+        return;
+    }
+
+    double elapsed = double(now() - captureBegin) * 1e-9;
+
+    // 複数のエンジンから呼ばれても書き出しは一度だけ
+    if (elapsed >= captureDuration && capturing.exchange(false))
+    {
+        captureEnd = now();
+        if (WriteChromeTrace(capturePath))
+        {
+            Debug::Log(L"プロファイラのトレースを書き出しました: " + capturePath);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// マーカーの記録
+// -----------------------------------------------------------------------------
+uint64_t Profiler::now()
+{
+    // 0 は「計測していない」を表すので 1 から始める
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count()) + 1;
+}
+
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+    // 計測の終了後に閉じたスコープは記録しない（書き出し中のバッファを上書きしないように）
+    if (!isCapturing())
+    {
+        return;
+    }
+
+    ThreadBuffer* buffer = getLocalBuffer();
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    buffer->claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    storeEvent(buffer->events[index % EventCapacity], ProfileEvent{ name, begin, end });
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadBuffer* buffer = getLocalBuffer();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    buffer->name = name;
+}
+
+
+// -----------------------------------------------------------------------------
+// Chrome トレース形式で書き出し
+// chrome://tracing や https://ui.perfetto.dev で開ける
+// -----------------------------------------------------------------------------
+bool Profiler::WriteChromeTrace(const std::wstring& path)
+{
+    std::ofstream out(std::filesystem::path(path), std::ios::binary);
+    if (!out)
+    {
+        Debug::Log(L"トレースファイルを開けません: " + path);
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    uint64_t totalDropped = 0;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : buffers)
+    {
+        // スレッド名
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+        writeJsonString(out, buffer->name.c_str());
+        out << "}}";
+
+        // リングバッファに残っている範囲
+        // 計測の開始より後に書かれて、すでに上書きされたものは失われている
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t start = written > EventCapacity ? written - EventCapacity : 0;
+        uint64_t dropped = start > buffer->captureStart ? start - buffer->captureStart : 0;
+        for (uint64_t i = start; i < written; ++i)
+        {
+            ProfileEvent e = loadEvent(buffer->events[i % EventCapacity]);
+
+            // 読んでいる間に所有スレッドが上書きを始めていたら、読んだ値は壊れているかもしれない
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer->claimed.load(std::memory_order_relaxed) > i + EventCapacity)
+            {
+                if (i >= buffer->captureStart)
+                {
+                    ++dropped;
+                }
+                continue;
+            }
+
+            if (e.begin < captureBegin || e.end > captureEnd)
+            {
+                continue;
+            }
+
+            out << ",\n{\"name\":";
+            writeJsonString(out, e.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << double(e.begin - captureBegin) * 1e-3
+                << ",\"dur\":" << double(e.end - e.begin) * 1e-3 << "}";
+        }
+
+        // 失われたイベントの数を、計測の開始位置にスレッドのインスタントイベントとして残す
+        if (dropped > 0)
+        {
+            out << ",\n{\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":0,\"args\":{\"count\":" << dropped << "}}";
+            totalDropped += dropped;
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << totalDropped << "}}\n";
+
+    if (totalDropped > 0)
+    {
+        Debug::Log(L"プロファイラ: リングバッファの上書きで " + std::to_wstring(totalDropped) + L" 個のイベントが失われました（1スレッドあたり "
+            + std::to_wstring(EventCapacity) + L" 個まで保持）");
+    }
+    return bool(out);
+}
+
+} // namespace UniDx
@@ -0,0 +1,104 @@
+﻿#include "pch.h"
+#include <UniDx/RenderStatsView.h>
+
+#include <string>
+#include <cwchar>
+#include <atomic>
+
+#include <UniDx/D3DManager.h>
+#include <UniDx/TextMesh.h>
+#include <UniDx/Input.h>
+#include <UniDx/Time.h>
+#include <UniDx/SceneSerializer.h>
+#include <UniDx/AssetDatabase.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    std::atomic<bool> visibleByDefault = false;
+}
+
+
+void RenderStatsView::setVisibleByDefault(bool visible)
+{
+    visibleByDefault = visible;
+}
+
+
+bool RenderStatsView::isVisibleByDefault()
+{
+    return visibleByDefault;
+}
+
+
+void RenderStatsView::Start()
+{
+    textMesh = GetComponent<TextMesh>(true);
+    if (textMesh != nullptr)
+    {
+        textMesh->enabled = visible;
+    }
+}
+
+
+void RenderStatsView::Serialize(SceneWriter& writer) const
+{
+    Behaviour::Serialize(writer);
+    writer.write(toggleKey);
+    writer.write(visible);
+}
+
+
+void RenderStatsView::Deserialize(SceneReader& reader)
+{
+    Behaviour::Deserialize(reader);
+    reader.read(toggleKey);
+    reader.read(visible);
+}
+
+
+void RenderStatsView::LateUpdate()
+{
+    if (textMesh == nullptr || !D3DManager::isAvailable())
+    {
+        return;
+    }
+
+    // 表示の切り替え
+    if (Input::GetKeyDown(toggleKey))
+    {
+        visible = !visible;
+        textMesh->enabled = visible;
+    }
+    if (!visible)
+    {
+        return;
+    }
+
+    const RenderStats& stats = D3DManager::getInstance()->getLastFrameStats();
+
+    wchar_t frameTime[32];
+    std::swprintf(frameTime, std::size(frameTime), L"%.2f", Time::unscaledDeltaTime * 1000.0f);
+
+    std::wstring str;
+    str.append(L"Frame: ").append(frameTime).append(L" ms\n");
+    str.append(L"Draw: ").append(std::to_wstring(stats.drawCalls));
+    str.append(L" (Indexed ").append(std::to_wstring(stats.indexedDrawCalls)).append(L")\n");
+    str.append(L"Primitives: ").append(std::to_wstring(stats.primitives)).append(L"\n");
+    str.append(L"Shader: ").append(std::to_wstring(stats.shaderBinds));
+    str.append(L"  Texture: ").append(std::to_wstring(stats.textureBinds));
+    str.append(L"  State: ").append(std::to_wstring(stats.stateChanges)).append(L"\n");
+    str.append(L"Upload: ").append(std::to_wstring(stats.bufferUploads));
+    str.append(L" (").append(std::to_wstring(stats.uploadBytes)).append(L" bytes)\n");
+
+    AssetDatabase::Stats assets = AssetDatabase::getInstance()->getStats();
+    str.append(L"Assets: ").append(std::to_wstring(assets.liveCount));
+    str.append(L" (Hit ").append(std::to_wstring(assets.hits));
+    str.append(L"  Miss ").append(std::to_wstring(assets.misses)).append(L")");
+    textMesh->text = str;
+}
+
+} // namespace UniDx
@@ -6,6 +6,8 @@
 #include <UniDx/Camera.h>
 #include <UniDx/Material.h>
 #include <UniDx/SceneManager.h>
+#include <UniDx/SceneSerializer.h>
+#include <UniDx/LODGroup.h>
 
 namespace UniDx{
 
@@ -21,6 +23,18 @@ void Renderer::OnEnable()
         material->OnEnable();
     }
 
+    // ヘッドレスモードではGPUリソースを作らない
+    if (!D3DManager::isAvailable())
+    {
+        return;
+    }
+
+    // 再度有効になったときは作り直さない
+    if (constantBuffer0 != nullptr)
+    {
+        return;
+    }
+
     // 行列用の定数バッファ生成
     D3D11_BUFFER_DESC desc{};
     desc.ByteWidth = sizeof(VSConstantBuffer0);
@@ -46,6 +60,7 @@ void Renderer::updatePositionCameraCBuffer(const UniDx::Camera& camera) const
     ID3D11Buffer* cbs[1] = { constantBuffer0.Get() };
     D3DManager::getInstance()->GetContext()->VSSetConstantBuffers(0, 1, cbs);
     D3DManager::getInstance()->GetContext()->UpdateSubresource(constantBuffer0.Get(), 0, nullptr, &cb, 0, 0);
+    D3DManager::getInstance()->getFrameStats().addUpload(sizeof(cb));
 }
 
 
@@ -63,6 +78,41 @@ bool Renderer::setMaterialForRender() const
 }
 
 
+// -----------------------------------------------------------------------------
+// マテリアルの書き出しと読み込み
+// -----------------------------------------------------------------------------
+void Renderer::serializeMaterials(SceneWriter& writer) const
+{
+    writer.write(uint32_t(materials.size()));
+    for (auto& material : materials)
+    {
+        writer.writeMaterial(material);
+    }
+}
+
+
+void Renderer::deserializeMaterials(SceneReader& reader)
+{
+    uint32_t count = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < count && !reader.hasFailed(); ++i)
+    {
+        if (auto material = reader.readMaterial())
+        {
+            AddMaterial(material);
+        }
+    }
+}
+
+
+MeshRenderer::~MeshRenderer()
+{
+    if (lodGroup_ != nullptr)
+    {
+        lodGroup_->removeRenderer(this);
+    }
+}
+
+
 // -----------------------------------------------------------------------------
 // メッシュを使って描画
 // -----------------------------------------------------------------------------
@@ -83,7 +133,7 @@ void MeshRenderer::Render(const Camera& camera) const
     //-----------------------------
     // 描画実行
     //-----------------------------
-    mesh.Render();
+    mesh.Render(lodLevel);
 }
 
 }
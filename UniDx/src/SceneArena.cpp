@@ -0,0 +1,195 @@
+﻿#include "pch.h"
+#include <UniDx/SceneArena.h>
+
+#include <new>
+#include <atomic>
+
+#include <UniDx/Object.h>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    thread_local SceneArena* currentArena = nullptr;
+    std::atomic<bool> arenaEnabled = true;
+
+    // チャンクの先頭に置いて、持ち主のアリーナと破棄されていない Object の数を記録する
+    // アリーナが先に破棄されたら arena を nullptr にする
+    struct alignas(16) ChunkHeader
+    {
+        SceneArena* arena;
+        size_t liveCount;
+    };
+
+    // Object の前に置いて、どこから確保したかを記録する（ヒープなら nullptr）
+    // 16バイトにしてアライメントを保つ
+    struct alignas(16) AllocationHeader
+    {
+        ChunkHeader* chunk;
+    };
+
+    constexpr size_t Alignment = alignof(AllocationHeader);
+
+    constexpr size_t alignUp(size_t size)
+    {
+        return (size + Alignment - 1) & ~(Alignment - 1);
+    }
+
+    std::byte* newChunk(SceneArena* arena, size_t size)
+    {
+        auto memory = static_cast<std::byte*>(::operator new(size, std::align_val_t(Alignment)));
+        new (memory) ChunkHeader{ arena, 0 };
+        return memory;
+    }
+
+    void deleteChunk(std::byte* memory)
+    {
+        ::operator delete(memory, std::align_val_t(Alignment));
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// SceneArena
+// -----------------------------------------------------------------------------
+SceneArena::~SceneArena()
+{
+    for (std::byte* memory : chunks_)
+    {
+        auto chunk = reinterpret_cast<ChunkHeader*>(memory);
+        if (chunk->liveCount == 0)
+        {
+            deleteChunk(memory);
+        }
+        else
+        {
+            // シーンより長く生きている Object がある（プールに保持されているなど）
+            // そのチャンクだけ残し、最後の Object の破棄で解放する
+            chunk->arena = nullptr;
+        }
+    }
+}
+
+
+void* SceneArena::allocate(size_t size)
+{
+    size = sizeof(AllocationHeader) + alignUp(size);
+    usedBytes_ += size;
+    liveCount_++;
+
+    std::byte* block;
+    std::byte* memory;
+
+    // 大きなものは専用のチャンクにして、使いかけのチャンクはそのまま続けて使う
+    if (size > ChunkSize / 4)
+    {
+        memory = newChunk(this, sizeof(ChunkHeader) + size);
+        chunks_.push_back(memory);
+        block = memory + sizeof(ChunkHeader);
+    }
+    else
+    {
+        if (size > remaining_)
+        {
+            currentChunk_ = newChunk(this, ChunkSize);
+            chunks_.push_back(currentChunk_);
+            cursor_ = currentChunk_ + sizeof(ChunkHeader);
+            remaining_ = ChunkSize - sizeof(ChunkHeader);
+        }
+        memory = currentChunk_;
+        block = cursor_;
+        cursor_ += size;
+        remaining_ -= size;
+    }
+
+    auto chunk = reinterpret_cast<ChunkHeader*>(memory);
+    chunk->liveCount++;
+
+    auto header = new (block) AllocationHeader{ chunk };
+    return header + 1;
+}
+
+
+void SceneArena::deallocate(void* p)
+{
+    // Object ごとには解放せず、チャンクの数だけ減らす
+    auto header = static_cast<AllocationHeader*>(p) - 1;
+    ChunkHeader* chunk = header->chunk;
+    chunk->liveCount--;
+
+    if (chunk->arena != nullptr)
+    {
+        chunk->arena->liveCount_--;
+    }
+    else if (chunk->liveCount == 0)
+    {
+        // アリーナが先に破棄されていて、チャンクの最後の Object だった
+        deleteChunk(reinterpret_cast<std::byte*>(chunk));
+    }
+}
+
+
+SceneArena* SceneArena::current()
+{
+    return arenaEnabled.load(std::memory_order_relaxed) ? currentArena : nullptr;
+}
+
+
+void SceneArena::setEnabled(bool enabled)
+{
+    arenaEnabled = enabled;
+}
+
+
+bool SceneArena::isEnabled()
+{
+    return arenaEnabled;
+}
+
+
+SceneArena::Scope::Scope(SceneArena* arena) : prev_(currentArena)
+{
+    currentArena = arena;
+}
+
+
+SceneArena::Scope::~Scope()
+{
+    currentArena = prev_;
+}
+
+
+// -----------------------------------------------------------------------------
+// Object の確保と解放
+// -----------------------------------------------------------------------------
+void* Object::operator new(size_t size)
+{
+    SceneArena* arena = SceneArena::current();
+    if (arena != nullptr)
+    {
+        return arena->allocate(size);
+    }
+
+    auto header = new (::operator new(sizeof(AllocationHeader) + size)) AllocationHeader{ nullptr };
+    return header + 1;
+}
+
+
+void Object::operator delete(void* p)
+{
+    if (p == nullptr) return;
+
+    auto header = static_cast<AllocationHeader*>(p) - 1;
+    if (header->chunk != nullptr)
+    {
+        SceneArena::deallocate(p);
+    }
+    else
+    {
+        ::operator delete(header);
+    }
+}
+
+} // namespace UniDx
@@ -2,8 +2,18 @@
 #include <UniDx/SceneManager.h>
 
 #include <memory>
+#include <algorithm>
+#include <chrono>
+#include <string>
 
 #include <UniDx/Material.h>
+#include <UniDx/Prefab.h>
+#include <UniDx/Time.h>
+#include <UniDx/SceneSerializer.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/AssetDatabase.h>
 
 
 namespace UniDx{
@@ -11,12 +21,320 @@ namespace UniDx{
 using namespace std;
 
 
+SceneManager::~SceneManager()
+{
+	destroyScene();
+}
+
+
+// 今のシーンを破棄して、かかった時間を返す
+double SceneManager::destroyScene()
+{
+	if (activeScene == nullptr) return 0.0;
+
+	// 破棄の予約はシーンの GameObject を指しているので先に捨てる
+	pendingDestroys_.clear();
+
+	auto start = std::chrono::steady_clock::now();
+	activeScene = nullptr;
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	Debug::Log(L"シーンの破棄: " + std::to_wstring(ms) + L" ms");
+	return ms;
+}
+
+
+void SceneManager::setSceneFile(const std::wstring& sceneFile, const std::wstring& saveFile)
+{
+	sceneFile_ = sceneFile;
+	saveFile_ = saveFile;
+}
+
+
 // シーン作成
 void SceneManager::createScene()
 {
-	activeScene = std::move(CreateDefaultScene());
+	auto start = std::chrono::steady_clock::now();
+
+	// 構築中に作られる GameObject とコンポーネントはアリーナに詰めて置く
+	auto arena = SceneArena::isEnabled() ? std::make_unique<SceneArena>() : nullptr;
+	{
+		SceneArena::Scope scope(arena.get());
+		if (!sceneFile_.empty())
+		{
+			activeScene = SceneSerializer::Load(sceneFile_);
+		}
+		if (activeScene == nullptr)
+		{
+			activeScene = std::move(CreateDefaultScene());
+			if (!saveFile_.empty())
+			{
+				SceneSerializer::Save(activeScene.get(), saveFile_);
+			}
+		}
+	}
+	activeScene->setArena(std::move(arena));
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	buildMilliseconds_ = ms;
+	std::wstring log = L"シーンの構築: " + std::to_wstring(ms) + L" ms";
+	if (activeScene->getArena() != nullptr)
+	{
+		log += L" (アリーナ " + std::to_wstring(activeScene->getArena()->getUsedBytes() / 1024) + L" KB, "
+			+ std::to_wstring(activeScene->getArena()->getLiveCount()) + L" objects)";
+	}
+	Debug::Log(log);
+	AssetDatabase::getInstance()->LogStats();
 //	defaultMaterial = make_unique<Material>();
 //	defaultMaterial->shader.compile<VertexPN>(L"Resource/DefaultShade.hlsl");
 }
 
+
+// -----------------------------------------------------------------------------
+// 非同期読み込み
+// -----------------------------------------------------------------------------
+struct SceneManager::LoadJob
+{
+	explicit LoadJob(const std::wstring& path) : loader(path) {}
+
+	SceneLoader loader;
+	JobCounter prepared;	// ワーカーでの準備が終わったか
+};
+
+
+std::shared_ptr<AsyncOperation> SceneManager::LoadSceneAsync(const std::wstring& path, LoadSceneMode mode)
+{
+	auto operation = std::make_shared<AsyncOperation>();
+	auto job = std::make_shared<LoadJob>(path);
+
+	// ファイルの読み込みとデコードはワーカーで行う
+	// ワーカースレッドからは D3DManager を参照できないので、デコードするかはここで決める
+	bool decode = D3DManager::isAvailable();
+	auto prepare = [job, decode]()
+		{
+			UNIDX_PROFILE_SCOPE("LoadSceneAsync");
+			job->loader.prepare(decode);
+		};
+	if (JobSystem::getInstance() != nullptr)
+	{
+		JobSystem::getInstance()->schedule(prepare, &job->prepared);
+	}
+	else
+	{
+		prepare();
+	}
+
+	auto arena = SceneArena::isEnabled() ? std::make_unique<SceneArena>() : nullptr;
+	loading_.push_back(LoadRequest{ std::move(arena), std::make_unique<Scene>(), job, operation, mode, false });
+	return operation;
+}
+
+
+const std::vector<GameObject*>& SceneManager::updateLoading()
+{
+	activated_.clear();
+	if (loading_.empty())
+	{
+		return activated_;
+	}
+
+	UNIDX_PROFILE_SCOPE("SceneManager::updateLoading");
+	using clock = std::chrono::steady_clock;
+	auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(loadingBudget_));
+
+	// 要求された順に進める。先のものが有効になるまで、後のものはワーカーでの準備だけが進む
+	while (!loading_.empty())
+	{
+		LoadRequest& request = loading_.front();
+		SceneLoader& loader = request.job->loader;
+		AsyncOperation& operation = *request.operation;
+
+		if (!request.job->prepared.isDone())
+		{
+			operation.progress_ = loader.getProgress() * 0.9f;
+			break;
+		}
+
+		// GPU リソースと GameObject を期限まで作る
+		if (!request.built && !loader.hasFailed())
+		{
+			SceneArena::Scope scope(request.arena.get());
+			bool done = loader.createAssets(deadline) && loader.createObjects(request.scene.get(), deadline);
+			operation.progress_ = loader.getProgress() * 0.9f;
+			if (!done)
+			{
+				break;
+			}
+			request.built = loader.finish();
+		}
+
+		if (!request.built)
+		{
+			// 失敗。作りかけのシーンはアリーナより先に破棄される
+			Debug::Log(L"シーンの非同期読み込みに失敗しました: " + loader.getPath());
+			auto failed = std::move(request.operation);
+			loading_.pop_front();
+			failed->complete(true);
+			continue;
+		}
+
+		// 有効にしてよくなるまで待つ
+		if (!operation.allowSceneActivation_)
+		{
+			break;
+		}
+
+		activate(request);
+		auto completed = std::move(request.operation);
+		loading_.pop_front();
+		completed->complete(false);
+
+		// 有効にしたシーンの Awake が続くので、1フレームに有効にするのはひとつだけ
+		break;
+	}
+	return activated_;
+}
+
+
+void SceneManager::activate(LoadRequest& request)
+{
+	UNIDX_PROFILE_SCOPE("SceneManager::activate");
+
+	for (auto& root : request.scene->GetRootGameObjects())
+	{
+		activated_.push_back(root.get());
+	}
+
+	// 加算読み込みなら今のシーンにルートを移す
+	if (request.mode == LoadSceneMode_Additive && activeScene != nullptr)
+	{
+		request.scene->MoveRootGameObjects(*activeScene);
+		activeScene->addArena(std::move(request.arena));
+		return;
+	}
+
+	// 今のシーンで予約されていた追加と破棄は捨てる
+	pendingAdds_.clear();
+	for (auto& it : pendingDestroys_)
+	{
+		it.object->destroyQueued_ = false;
+	}
+	pendingDestroys_.clear();
+
+	// ここで今のシーンが破棄される
+	activeScene = std::move(request.scene);
+	activeScene->setArena(std::move(request.arena));
+}
+
+
+// -----------------------------------------------------------------------------
+// 追加の予約
+// 更新中にシーンの配列を変えないように、フレームの終わりにまとめて追加する
+// -----------------------------------------------------------------------------
+GameObject* SceneManager::instantiate(unique_ptr<GameObject> object, Transform* parent, bool activate)
+{
+	GameObject* result = object.get();
+	pendingAdds_.push_back(PendingAdd{ std::move(object), parent, activate });
+	return result;
+}
+
+
+const std::vector<GameObject*>& SceneManager::flushInstantiated()
+{
+	added_.clear();
+
+	// 追加の途中で Instantiate() されたものは次のフレームに回す
+	addBatch_.swap(pendingAdds_);
+	for (auto& it : addBatch_)
+	{
+		GameObject* object = it.object.get();
+		if (it.parent != nullptr)
+		{
+			Transform::SetParent(std::move(it.object), it.parent);
+		}
+		else
+		{
+			activeScene->AddRootGameObject(std::move(it.object));
+		}
+
+		if (it.activate)
+		{
+			object->SetActive(true);
+		}
+		added_.push_back(object);
+	}
+	addBatch_.clear();
+
+	return added_;
+}
+
+
+// -----------------------------------------------------------------------------
+// 破棄の予約
+// -----------------------------------------------------------------------------
+void SceneManager::destroy(GameObject* object, float delay)
+{
+	if (object->destroyQueued_) return;
+
+	object->destroyQueued_ = true;
+	pendingDestroys_.push_back(PendingDestroy{ object, Time::time + delay });
+}
+
+
+void SceneManager::cancelDestroy(GameObject* object)
+{
+	auto it = std::find_if(pendingDestroys_.begin(), pendingDestroys_.end(),
+		[object](const PendingDestroy& d) { return d.object == object; });
+	if (it != pendingDestroys_.end())
+	{
+		*it = pendingDestroys_.back();
+		pendingDestroys_.pop_back();
+	}
+	object->destroyQueued_ = false;
+}
+
+
+void SceneManager::flushDestroyed(float time)
+{
+	// 時刻に達したものを取り出す
+	dueObjects_.clear();
+	for (size_t i = 0; i < pendingDestroys_.size();)
+	{
+		if (pendingDestroys_[i].time <= time)
+		{
+			dueObjects_.push_back(pendingDestroys_[i].object);
+			pendingDestroys_[i] = pendingDestroys_.back();
+			pendingDestroys_.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// 先にすべて階層から外してから破棄する
+	// 親子の両方が予約されていても、外している間はどちらも生きている
+	for (GameObject* object : dueObjects_)
+	{
+		object->destroyQueued_ = false;
+		unique_ptr<GameObject> owned = object->transform->DetachFromParent();
+		if (owned == nullptr)
+		{
+			// シーンにないもの（プールで待機中など）は所有していないので何もしない
+			continue;
+		}
+
+		// プールを使うプレハブから作ったものはプールに戻す
+		auto prefab = object->prefab_.lock();
+		if (prefab != nullptr && prefab->release(owned))
+		{
+			continue;
+		}
+		destroyBatch_.push_back(std::move(owned));
+	}
+	dueObjects_.clear();
+
+	// ここでコンポーネントのデストラクタが呼ばれる
+	destroyBatch_.clear();
+}
+
 }
@@ -0,0 +1,1074 @@
+﻿#include "pch.h"
+#include <UniDx/SceneSerializer.h>
+
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <typeindex>
+
+#include <UniDx/Scene.h>
+#include <UniDx/GameObject.h>
+#include <UniDx/Transform.h>
+#include <UniDx/Texture.h>
+#include <UniDx/Material.h>
+#include <UniDx/Font.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/MappedFile.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/AssetDatabase.h>
+#include <UniDx/Rigidbody.h>
+#include <UniDx/Collider.h>
+#include <UniDx/Light.h>
+#include <UniDx/Camera.h>
+#include <UniDx/PrimitiveRenderer.h>
+#include <UniDx/GltfModel.h>
+#include <UniDx/LODGroup.h>
+#include <UniDx/StaticBatching.h>
+#include <UniDx/Canvas.h>
+#include <UniDx/TextMesh.h>
+#include <UniDx/RenderStatsView.h>
+
+
+namespace UniDx
+{
+
+using namespace SceneFile;
+
+namespace
+{
+    struct ComponentType
+    {
+        std::wstring name;
+        SceneSerializer::Factory factory;
+    };
+
+    // 登録された型
+    // 読み込みは複数のエンジンから同時に行われることがあるのでロックする
+    struct Registry
+    {
+        std::mutex mutex;
+        std::unordered_map<std::type_index, ComponentType> byType;
+        std::unordered_map<std::wstring, ComponentType> byName;
+        std::deque<SceneVertexType> vertices;   // 要素のアドレスが変わらないように deque
+
+        Registry()
+        {
+            add<Rigidbody>(L"Rigidbody");
+            add<AABBCollider>(L"AABBCollider");
+            add<SphereCollider>(L"SphereCollider");
+            add<Light>(L"Light");
+            add<Camera>(L"Camera");
+            add<CubeRenderer>(L"CubeRenderer");
+            add<SphereRenderer>(L"SphereRenderer");
+            add<GltfModel>(L"GltfModel");
+            add<LODGroup>(L"LODGroup");
+            add<StaticBatchRenderer>(L"StaticBatchRenderer");
+            add<Canvas>(L"Canvas");
+            add<TextMesh>(L"TextMesh");
+            add<RenderStatsView>(L"RenderStatsView");
+
+            addVertex<VertexP>(L"VertexP");
+            addVertex<VertexPN>(L"VertexPN");
+            addVertex<VertexPT>(L"VertexPT");
+            addVertex<VertexPC>(L"VertexPC");
+            addVertex<VertexPTC>(L"VertexPTC");
+            addVertex<VertexPNT>(L"VertexPNT");
+            addVertex<VertexPNC>(L"VertexPNC");
+        }
+
+        template<typename T>
+        void add(const std::wstring& name)
+        {
+            add(typeid(T), name, []() -> std::unique_ptr<Component> { return std::make_unique<T>(); });
+        }
+
+        void add(const std::type_info& type, const std::wstring& name, SceneSerializer::Factory factory)
+        {
+            ComponentType entry{ name, factory };
+            byType[std::type_index(type)] = entry;
+            byName[name] = entry;
+        }
+
+        template<typename TVertex>
+        void addVertex(const std::wstring& name)
+        {
+            vertices.push_back(SceneVertexType::Create<TVertex>(name));
+        }
+
+        const ComponentType* find(const std::type_info& type)
+        {
+            auto it = byType.find(std::type_index(type));
+            return it != byType.end() ? &it->second : nullptr;
+        }
+
+        const ComponentType* find(std::wstring_view name)
+        {
+            auto it = byName.find(std::wstring(name));
+            return it != byName.end() ? &it->second : nullptr;
+        }
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // テーブルがファイルに収まっているか
+    bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize)
+    {
+        return offset + count * size <= fileSize;
+    }
+
+    // ファイルの中身をすべて読む
+    bool readAll(const std::wstring& path, std::vector<uint8_t>& data)
+    {
+        std::ifstream in(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            return false;
+        }
+        data.resize(size_t(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size()));
+        return bool(in);
+    }
+
+    // 画像をミップマップまで作って DDS にする（書き出し用）
+    bool cookTexture(const std::wstring& path, DirectX::Blob& dds)
+    {
+        DirectX::ScratchImage image;
+        return Texture::Decode(path, image)
+            && SUCCEEDED(DirectX::SaveToDDSMemory(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::DDS_FLAGS_NONE, dds));
+    }
+
+    // 焼き込んだバイトコードを ID3DBlob にする
+    bool copyBlob(std::span<const std::byte> bytes, ComPtr<ID3DBlob>& blob)
+    {
+        if (bytes.empty() || FAILED(D3DCreateBlob(bytes.size(), &blob)))
+        {
+            return false;
+        }
+        std::memcpy(blob->GetBufferPointer(), bytes.data(), bytes.size());
+        return true;
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 型の登録
+// -----------------------------------------------------------------------------
+void SceneSerializer::registerComponent(const std::type_info& type, const std::wstring& name, Factory factory)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.add(type, name, factory);
+}
+
+
+void SceneSerializer::registerVertex(const SceneVertexType& vertex)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.vertices.push_back(vertex);
+}
+
+
+const SceneVertexType* SceneSerializer::findVertex(const D3D11_INPUT_ELEMENT_DESC* layout)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& v : r.vertices)
+    {
+        if (v.layout == layout) return &v;
+    }
+    return nullptr;
+}
+
+
+const SceneVertexType* SceneSerializer::findVertex(std::wstring_view name)
+{
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& v : r.vertices)
+    {
+        if (v.name == name) return &v;
+    }
+    return nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// SceneWriter
+// -----------------------------------------------------------------------------
+uint32_t SceneWriter::addString(std::wstring_view s)
+{
+    auto it = stringIndex_.find(std::wstring(s));
+    if (it != stringIndex_.end())
+    {
+        return it->second;
+    }
+
+    uint32_t index = uint32_t(strings_.size());
+    strings_.push_back(StringRecord{ uint32_t(chars_.size()), uint32_t(s.size()) });
+    chars_.append(s);
+    stringIndex_.emplace(std::wstring(s), index);
+    return index;
+}
+
+
+uint32_t SceneWriter::addAsset(const Object* asset, AssetType type, const std::function<void()>& writeFields)
+{
+    auto it = assetIndex_.find(asset);
+    if (it != assetIndex_.end())
+    {
+        return it->second;
+    }
+
+    // 書きかけのデータを退避してアセットのフィールドを書く
+    // 依存するアセットはこの中で先に追加されるので、読み込み時には読み込み済みになっている
+    std::vector<std::byte> outer;
+    outer.swap(data_);
+    writeFields();
+
+    AssetRecord record{ type, uint32_t(assetData_.size()), uint32_t(data_.size()) };
+    assetData_.insert(assetData_.end(), data_.begin(), data_.end());
+    data_.swap(outer);
+
+    uint32_t index = uint32_t(assets_.size());
+    assets_.push_back(record);
+    assetIndex_.emplace(asset, index);
+    return index;
+}
+
+
+void SceneWriter::writeBytes(const void* data, size_t size)
+{
+    write(uint32_t(size));
+    const std::byte* p = static_cast<const std::byte*>(data);
+    data_.insert(data_.end(), p, p + size);
+}
+
+
+void SceneWriter::writeTexture(const std::shared_ptr<Texture>& texture)
+{
+    if (texture == nullptr)
+    {
+        write(NullIndex);
+        return;
+    }
+
+    write(addAsset(texture.get(), AssetType_Texture, [this, &texture]()
+        {
+            writeString(texture->getFilePath());
+            write(int32_t(texture->wrapModeU));
+            write(int32_t(texture->wrapModeV));
+
+            // 読み込み時に WIC でデコードしてミップマップを作らなくてよいように DDS を焼き込む
+            // 作れなければ空にして、読み込み時に元の画像を使う
+            DirectX::Blob dds;
+            if (!texture->getFilePath().empty() && !cookTexture(texture->getFilePath(), dds))
+            {
+                Debug::Log(L"シーンの書き出し: テクスチャを焼き込めません " + texture->getFilePath());
+            }
+            writeBytes(dds.GetBufferPointer(), dds.GetBufferSize());
+        }));
+}
+
+
+void SceneWriter::writeMaterial(const std::shared_ptr<Material>& material)
+{
+    if (material == nullptr)
+    {
+        write(NullIndex);
+        return;
+    }
+
+    write(addAsset(material.get(), AssetType_Material, [this, &material]()
+        {
+            writeString(material->shader.getFilePath());
+            writeVertexType(material->shader.getInputLayout().data());
+
+            // 読み込み時にコンパイルしなくてよいようにバイトコードを焼き込む
+            ShaderBytecode bytecode;
+            if (!material->shader.getFilePath().empty() && !Shader::compileBytecode(material->shader.getFilePath(), bytecode))
+            {
+                Debug::Log(L"シーンの書き出し: シェーダーを焼き込めません " + material->shader.getFilePath());
+            }
+            writeBytes(bytecode.vertex ? bytecode.vertex->GetBufferPointer() : nullptr, bytecode.vertex ? bytecode.vertex->GetBufferSize() : 0);
+            writeBytes(bytecode.pixel ? bytecode.pixel->GetBufferPointer() : nullptr, bytecode.pixel ? bytecode.pixel->GetBufferSize() : 0);
+
+            write(material->color);
+            write(int32_t(material->getBlendMode()));
+            write(int32_t(material->depthWrite));
+            write(int32_t(material->ztest));
+            write(int32_t(material->renderingMode));
+
+            auto textures = material->getTextures();
+            write(uint32_t(textures.size()));
+            for (auto& texture : textures)
+            {
+                writeTexture(texture);
+            }
+        }));
+}
+
+
+void SceneWriter::writeFont(const std::shared_ptr<Font>& font)
+{
+    if (font == nullptr)
+    {
+        write(NullIndex);
+        return;
+    }
+
+    write(addAsset(font.get(), AssetType_Font, [this, &font]()
+        {
+            writeString(font->getFilePath());
+        }));
+}
+
+
+void SceneWriter::writeReference(const Component* component)
+{
+    // 参照先がまだ書き出されていないことがあるので、番号は最後に埋める
+    references_.push_back({ data_.size(), component });
+    write(NullIndex);
+}
+
+
+void SceneWriter::writeVertexType(const D3D11_INPUT_ELEMENT_DESC* layout)
+{
+    const SceneVertexType* vertex = layout != nullptr ? SceneSerializer::findVertex(layout) : nullptr;
+    if (layout != nullptr && vertex == nullptr)
+    {
+        Debug::Log(L"シーンの書き出し: 登録されていない頂点の型があります");
+    }
+    writeString(vertex != nullptr ? std::wstring_view(vertex->name) : std::wstring_view());
+}
+
+
+void SceneWriter::writeObject(GameObject* object, uint32_t parent)
+{
+    Transform* transform = object->transform;
+
+    ObjectRecord record{};
+    record.parent = parent;
+    record.name = addString(object->name);
+    record.active = object->activeSelf ? 1 : 0;
+    record.localPosition = transform->localPosition;
+    record.localRotation = transform->localRotation;
+    record.localScale = transform->localScale;
+    record.firstComponent = uint32_t(components_.size());
+
+    uint32_t index = uint32_t(objects_.size());
+    objects_.push_back(record);
+
+    // コンポーネント（Transform はレコードに含めたので飛ばす）
+    uint32_t count = 0;
+    for (auto& component : object->GetComponents())
+    {
+        if (component.get() == transform)
+        {
+            continue;
+        }
+
+        const ComponentType* type = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            type = registry().find(typeid(*component));
+        }
+        if (type == nullptr)
+        {
+            Debug::Log(std::string("シーンの書き出し: 登録されていないコンポーネントを飛ばします ") + typeid(*component).name());
+            continue;
+        }
+
+        ComponentRecord componentRecord{};
+        componentRecord.type = addString(type->name);
+        componentRecord.enabled = component->_enabled ? 1 : 0;
+        componentRecord.dataOffset = uint32_t(data_.size());
+        componentIndex_.emplace(component.get(), uint32_t(components_.size()));
+
+        component->Serialize(*this);
+
+        componentRecord.dataSize = uint32_t(data_.size() - componentRecord.dataOffset);
+        components_.push_back(componentRecord);
+        count++;
+    }
+    objects_[index].componentCount = count;
+
+    // 子（コンポーネントが作り直すものは除く）
+    for (auto& child : transform->getChildGameObjects())
+    {
+        if (!excluded_.contains(child.get()))
+        {
+            writeObject(child.get(), index);
+        }
+    }
+}
+
+
+bool SceneWriter::resolveReferences()
+{
+    bool resolved = true;
+    for (auto& [offset, component] : references_)
+    {
+        uint32_t index = NullIndex;
+        if (component != nullptr)
+        {
+            auto it = componentIndex_.find(component);
+            if (it != componentIndex_.end())
+            {
+                index = it->second;
+            }
+            else
+            {
+                // シーンの外や、書き出されなかったコンポーネントへの参照
+                resolved = false;
+            }
+        }
+        std::memcpy(data_.data() + offset, &index, sizeof(index));
+    }
+    return resolved;
+}
+
+
+// -----------------------------------------------------------------------------
+// SceneReader
+// -----------------------------------------------------------------------------
+std::wstring_view SceneReader::getString(uint32_t index) const
+{
+    if (index >= header_->stringCount)
+    {
+        return std::wstring_view();
+    }
+
+    StringRecord record;
+    std::memcpy(&record, file_ + header_->stringOffset + sizeof(StringRecord) * index, sizeof(record));
+
+    uint64_t charCount = (header_->dataOffset - header_->charOffset) / sizeof(wchar_t);
+    if (uint64_t(record.offset) + record.length > charCount)
+    {
+        return std::wstring_view();
+    }
+    const wchar_t* chars = reinterpret_cast<const wchar_t*>(file_ + header_->charOffset);
+    return std::wstring_view(chars + record.offset, record.length);
+}
+
+
+std::shared_ptr<Object> SceneReader::getAsset(uint32_t index, AssetType type) const
+{
+    if (index >= assets_.size())
+    {
+        return nullptr;
+    }
+
+    AssetRecord record;
+    std::memcpy(&record, file_ + header_->assetOffset + sizeof(AssetRecord) * index, sizeof(record));
+    return record.type == type ? assets_[index] : nullptr;
+}
+
+
+std::span<const std::byte> SceneReader::readBytes()
+{
+    uint32_t size = read<uint32_t>();
+    if (size > size_t(end_ - cursor_))
+    {
+        failed_ = true;
+        cursor_ = end_;
+        return {};
+    }
+    std::span<const std::byte> bytes(cursor_, size);
+    cursor_ += size;
+    return bytes;
+}
+
+
+std::shared_ptr<Texture> SceneReader::readTexture()
+{
+    return std::static_pointer_cast<Texture>(getAsset(read<uint32_t>(), AssetType_Texture));
+}
+
+
+std::shared_ptr<Material> SceneReader::readMaterial()
+{
+    return std::static_pointer_cast<Material>(getAsset(read<uint32_t>(), AssetType_Material));
+}
+
+
+std::shared_ptr<Font> SceneReader::readFont()
+{
+    return std::static_pointer_cast<Font>(getAsset(read<uint32_t>(), AssetType_Font));
+}
+
+
+const SceneVertexType* SceneReader::readVertexType()
+{
+    std::wstring_view name = readString();
+    return name.empty() ? nullptr : SceneSerializer::findVertex(name);
+}
+
+
+std::shared_ptr<const GltfModelAsset> SceneReader::loadModel(const std::wstring& path, const SceneVertexType& vertex)
+{
+    for (auto& model : models_)
+    {
+        if (model.asset != nullptr && model.vertex == &vertex && model.path == path)
+        {
+            // 共有に加えた後は AssetDatabase から返される
+            return GltfModelAsset::Register(std::move(model.asset));
+        }
+    }
+    return GltfModelAsset::Load(path, vertex);
+}
+
+
+void SceneReader::setRange(uint32_t offset, uint32_t size)
+{
+    uint64_t begin = uint64_t(header_->dataOffset) + offset;
+    if (begin + size > header_->fileSize)
+    {
+        // 範囲外なので何も読めないようにする
+        failed_ = true;
+        cursor_ = end_ = file_;
+        return;
+    }
+    cursor_ = file_ + begin;
+    end_ = cursor_ + size;
+}
+
+
+// -----------------------------------------------------------------------------
+// 書き出し
+// -----------------------------------------------------------------------------
+bool SceneSerializer::Save(Scene* scene, const std::wstring& path)
+{
+    UNIDX_PROFILE_SCOPE("SceneSerializer::Save");
+
+    // テクスチャの焼き込みで WIC を使うので、このスレッドで COM を初期化しておく
+    HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    SceneWriter writer;
+    for (auto& root : scene->GetRootGameObjects())
+    {
+        writer.writeObject(root.get(), NullIndex);
+    }
+
+    if (SUCCEEDED(com))
+    {
+        CoUninitialize();
+    }
+    if (!writer.resolveReferences())
+    {
+        Debug::Log(L"シーンの書き出し: 書き出されないコンポーネントへの参照は nullptr になります");
+    }
+
+    // 配置を決める
+    Header header{};
+    header.magic = Magic;
+    header.version = Version;
+    header.charSize = uint16_t(sizeof(wchar_t));
+    header.objectCount = uint32_t(writer.objects_.size());
+    header.componentCount = uint32_t(writer.components_.size());
+    header.assetCount = uint32_t(writer.assets_.size());
+    header.stringCount = uint32_t(writer.strings_.size());
+    header.objectOffset = uint32_t(sizeof(Header));
+    header.componentOffset = header.objectOffset + uint32_t(sizeof(ObjectRecord) * writer.objects_.size());
+    header.assetOffset = header.componentOffset + uint32_t(sizeof(ComponentRecord) * writer.components_.size());
+    header.stringOffset = header.assetOffset + uint32_t(sizeof(AssetRecord) * writer.assets_.size());
+    header.charOffset = header.stringOffset + uint32_t(sizeof(StringRecord) * writer.strings_.size());
+    header.dataOffset = header.charOffset + uint32_t(sizeof(wchar_t) * writer.chars_.size());
+    header.fileSize = header.dataOffset + uint32_t(writer.data_.size() + writer.assetData_.size());
+
+    // アセットのデータはコンポーネントのデータの後ろに置く
+    for (auto& asset : writer.assets_)
+    {
+        asset.dataOffset += uint32_t(writer.data_.size());
+    }
+
+    std::ofstream out(std::filesystem::path(path), std::ios::binary);
+    if (!out)
+    {
+        Debug::Log(L"シーンファイルを開けません: " + path);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(writer.objects_.data()), sizeof(ObjectRecord) * writer.objects_.size());
+    out.write(reinterpret_cast<const char*>(writer.components_.data()), sizeof(ComponentRecord) * writer.components_.size());
+    out.write(reinterpret_cast<const char*>(writer.assets_.data()), sizeof(AssetRecord) * writer.assets_.size());
+    out.write(reinterpret_cast<const char*>(writer.strings_.data()), sizeof(StringRecord) * writer.strings_.size());
+    out.write(reinterpret_cast<const char*>(writer.chars_.data()), sizeof(wchar_t) * writer.chars_.size());
+    out.write(reinterpret_cast<const char*>(writer.data_.data()), writer.data_.size());
+    out.write(reinterpret_cast<const char*>(writer.assetData_.data()), writer.assetData_.size());
+    if (!out)
+    {
+        Debug::Log(L"シーンファイルの書き込みに失敗しました: " + path);
+        return false;
+    }
+
+    Debug::Log(L"シーンを書き出しました: " + path + L" (" + std::to_wstring(header.objectCount) + L" objects, "
+        + std::to_wstring(header.fileSize) + L" bytes)");
+    return true;
+}
+
+
+// -----------------------------------------------------------------------------
+// 読み込み
+// -----------------------------------------------------------------------------
+std::unique_ptr<Scene> SceneSerializer::Load(const std::wstring& path)
+{
+    UNIDX_PROFILE_SCOPE("SceneSerializer::Load");
+
+    SceneLoader loader(path);
+    if (!loader.prepare(D3DManager::isAvailable()))
+    {
+        return nullptr;
+    }
+
+    // 期限なしで最後まで進める
+    auto scene = std::make_unique<Scene>();
+    loader.createAssets(SceneLoader::Clock::time_point::max());
+    loader.createObjects(scene.get(), SceneLoader::Clock::time_point::max());
+    return loader.finish() ? std::move(scene) : nullptr;
+}
+
+
+// -----------------------------------------------------------------------------
+// SceneLoader
+// -----------------------------------------------------------------------------
+
+// prepare() で用意したアセットのデータ
+struct SceneLoader::PreparedAsset
+{
+    std::wstring path;
+    const SceneVertexType* vertex = nullptr;
+    bool ok = false;
+
+    DirectX::ScratchImage image;    // テクスチャ
+    ShaderBytecode shader;          // マテリアルのシェーダー
+    std::vector<uint8_t> data;      // フォント
+};
+
+
+SceneLoader::SceneLoader(const std::wstring& path) :
+    path_(path),
+    start_(Clock::now())
+{
+}
+
+
+SceneLoader::~SceneLoader()
+{
+}
+
+
+bool SceneLoader::prepare(bool decode)
+{
+    UNIDX_PROFILE_SCOPE("SceneLoader::prepare");
+
+    if (!file_.open(path_))
+    {
+        Debug::Log(L"シーンファイルを開けません: " + path_);
+        failed_ = true;
+        return false;
+    }
+
+    // ヘッダとテーブルの範囲を確かめる
+    if (file_.size() >= sizeof(Header))
+    {
+        std::memcpy(&header_, file_.data(), sizeof(Header));
+    }
+    if (header_.magic != Magic || header_.version != Version || header_.charSize != sizeof(wchar_t)
+        || header_.fileSize != file_.size()
+        || !fits(header_.objectOffset, header_.objectCount, sizeof(ObjectRecord), file_.size())
+        || !fits(header_.componentOffset, header_.componentCount, sizeof(ComponentRecord), file_.size())
+        || !fits(header_.assetOffset, header_.assetCount, sizeof(AssetRecord), file_.size())
+        || !fits(header_.stringOffset, header_.stringCount, sizeof(StringRecord), file_.size())
+        || header_.charOffset > header_.dataOffset || header_.dataOffset > file_.size())
+    {
+        Debug::Log(L"シーンファイルの形式が違います: " + path_);
+        failed_ = true;
+        return false;
+    }
+
+    reader_.file_ = file_.data();
+    reader_.header_ = &header_;
+    prepared_ = std::make_unique<PreparedAsset[]>(header_.assetCount);
+    objectTotal_ = header_.objectCount;
+    assetTotal_ = header_.assetCount;
+
+    // 焼き込まれていない画像は WIC でデコードするので、このスレッドで COM を初期化しておく
+    // すでに初期化されているスレッドでは何もしない
+    HRESULT com = decode ? CoInitializeEx(nullptr, COINIT_MULTITHREADED) : E_FAIL;
+
+    // アセットのうち、GPU を使わずにできるところまで進める
+    for (uint32_t i = 0; i < header_.assetCount && !reader_.hasFailed(); ++i)
+    {
+        AssetRecord record;
+        std::memcpy(&record, file_.data() + header_.assetOffset + sizeof(AssetRecord) * i, sizeof(record));
+        reader_.setRange(record.dataOffset, record.dataSize);
+
+        PreparedAsset& asset = prepared_[i];
+        asset.ok = true;
+        switch (record.type)
+        {
+        case AssetType_Texture:
+        {
+            asset.path = reader_.readString();
+            reader_.read<int32_t>();
+            reader_.read<int32_t>();
+            std::span<const std::byte> dds = reader_.readBytes();
+            if (decode)
+            {
+                // 焼き込んだ DDS はミップマップまで入っているので、そのまま取り出す
+                asset.ok = !dds.empty()
+                    ? SUCCEEDED(DirectX::LoadFromDDSMemory(dds.data(), dds.size(), DirectX::DDS_FLAGS_NONE, nullptr, asset.image))
+                    : Texture::Decode(asset.path, asset.image);
+            }
+        }
+        break;
+
+        case AssetType_Material:
+        {
+            asset.path = reader_.readString();
+            asset.vertex = reader_.readVertexType();
+            std::span<const std::byte> vertex = reader_.readBytes();
+            std::span<const std::byte> pixel = reader_.readBytes();
+            if (decode && asset.vertex != nullptr)
+            {
+                asset.ok = copyBlob(vertex, asset.shader.vertex) && copyBlob(pixel, asset.shader.pixel);
+                if (!asset.ok)
+                {
+                    // 焼き込まれていなければコンパイルする
+                    asset.ok = Shader::compileBytecode(asset.path, asset.shader);
+                }
+            }
+        }
+        break;
+
+        case AssetType_Font:
+            asset.path = reader_.readString();
+            if (decode)
+            {
+                asset.ok = readAll(asset.path, asset.data);
+            }
+            break;
+        }
+        preparedCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (SUCCEEDED(com))
+    {
+        CoUninitialize();
+    }
+
+    if (reader_.hasFailed())
+    {
+        Debug::Log(L"シーンファイルのアセットが壊れています: " + path_);
+        failed_ = true;
+        return false;
+    }
+
+    prepareModels();
+    return true;
+}
+
+
+// GltfModel コンポーネントが使うモデルを先にデコードしておく
+// createObjects() の GltfModel::Deserialize() では頂点バッファを作ってノードを並べるだけになる
+void SceneLoader::prepareModels()
+{
+    UNIDX_PROFILE_SCOPE("SceneLoader::prepareModels");
+
+    std::wstring typeName;
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        auto it = registry().byType.find(typeid(GltfModel));
+        if (it == registry().byType.end())
+        {
+            return;
+        }
+        typeName = it->second.name;
+    }
+
+    // GltfModel::Serialize() はパスと頂点の型を先頭に書く
+    for (uint32_t c = 0; c < header_.componentCount; ++c)
+    {
+        ComponentRecord record;
+        std::memcpy(&record, file_.data() + header_.componentOffset + sizeof(ComponentRecord) * c, sizeof(record));
+        if (reader_.getString(record.type) != typeName)
+        {
+            continue;
+        }
+
+        reader_.setRange(record.dataOffset, record.dataSize);
+        std::wstring path(reader_.readString());
+        const SceneVertexType* vertex = reader_.readVertexType();
+        if (path.empty() || vertex == nullptr || reader_.hasFailed())
+        {
+            continue;
+        }
+
+        auto same = [&](const SceneReader::PreparedModel& m) { return m.vertex == vertex && m.path == path; };
+        if (std::find_if(reader_.models_.begin(), reader_.models_.end(), same) == reader_.models_.end())
+        {
+            reader_.models_.push_back(SceneReader::PreparedModel{ path, vertex, nullptr });
+        }
+    }
+
+    modelTotal_ = uint32_t(reader_.models_.size());
+    for (auto& model : reader_.models_)
+    {
+        model.asset = GltfModelAsset::Decode(model.path, *model.vertex);
+        preparedModelCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+// ファイルの順にアセットを作る
+bool SceneLoader::createAssets(Clock::time_point deadline)
+{
+    UNIDX_PROFILE_SCOPE("SceneLoader::createAssets");
+
+    for (bool first = true; assetCursor_ < header_.assetCount && !failed_; first = false)
+    {
+        if (!first && Clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        AssetRecord record;
+        std::memcpy(&record, file_.data() + header_.assetOffset + sizeof(AssetRecord) * assetCursor_, sizeof(record));
+        reader_.setRange(record.dataOffset, record.dataSize);
+        PreparedAsset& prepared = prepared_[assetCursor_];
+        assetCursor_++;
+
+        switch (record.type)
+        {
+        case AssetType_Texture:
+        {
+            reader_.readString();
+            auto wrapModeU = D3D11_TEXTURE_ADDRESS_MODE(reader_.read<int32_t>());
+            auto wrapModeV = D3D11_TEXTURE_ADDRESS_MODE(reader_.read<int32_t>());
+            std::shared_ptr<Texture> texture;
+            if (prepared.ok)
+            {
+                texture = AssetDatabase::getInstance()->LoadTexture(prepared.path, prepared.image, wrapModeU, wrapModeV);
+            }
+            if (texture == nullptr)
+            {
+                Debug::Log(L"シーンの読み込み: テクスチャを読み込めません " + prepared.path);
+            }
+            prepared.image.Release();
+            reader_.assets_.push_back(texture);
+        }
+        break;
+
+        case AssetType_Material:
+        {
+            auto material = std::make_shared<Material>();
+            reader_.readString();
+            reader_.readVertexType();
+            reader_.readBytes();
+            reader_.readBytes();
+            if (prepared.vertex == nullptr)
+            {
+                if (!prepared.path.empty())
+                {
+                    Debug::Log(L"シーンの読み込み: 頂点の型がわからないのでシェーダーをコンパイルしません " + prepared.path);
+                }
+            }
+            else if (prepared.ok)
+            {
+                material->shader.create(prepared.path, prepared.shader, prepared.vertex->layout, prepared.vertex->layoutSize);
+            }
+            prepared.shader = ShaderBytecode();
+
+            material->color = reader_.read<Color>();
+            BlendMode blendMode = BlendMode(reader_.read<int32_t>());
+            material->depthWrite = D3D11_DEPTH_WRITE_MASK(reader_.read<int32_t>());
+            material->ztest = D3D11_COMPARISON_FUNC(reader_.read<int32_t>());
+            material->renderingMode = RenderingMode(reader_.read<int32_t>());
+            if (blendMode != material->getBlendMode() && D3DManager::isAvailable())
+            {
+                material->setBlendMode(blendMode);
+            }
+
+            uint32_t textureCount = reader_.read<uint32_t>();
+            for (uint32_t t = 0; t < textureCount && !reader_.hasFailed(); ++t)
+            {
+                if (auto texture = reader_.readTexture())
+                {
+                    material->AddTexture(texture);
+                }
+            }
+            reader_.assets_.push_back(material);
+        }
+        break;
+
+        case AssetType_Font:
+        {
+            std::shared_ptr<Font> font;
+            if (prepared.ok)
+            {
+                font = AssetDatabase::getInstance()->LoadFont(prepared.path, prepared.data);
+            }
+            if (font == nullptr)
+            {
+                Debug::Log(L"シーンの読み込み: フォントを読み込めません " + prepared.path);
+            }
+            prepared.data = std::vector<uint8_t>();
+            reader_.assets_.push_back(font);
+        }
+        break;
+
+        default:
+            // 知らない種類は飛ばす（番号がずれないように空で埋める）
+            reader_.assets_.push_back(nullptr);
+            break;
+        }
+
+        if (reader_.hasFailed())
+        {
+            Debug::Log(L"シーンファイルのアセットが壊れています: " + path_);
+            failed_ = true;
+        }
+    }
+    return true;
+}
+
+
+// GameObject とコンポーネントをテーブルの順に作る
+// 親は必ず先に作られているので、作ったその場で親につなぐ
+bool SceneLoader::createObjects(Scene* scene, Clock::time_point deadline)
+{
+    UNIDX_PROFILE_SCOPE("SceneLoader::createObjects");
+
+    if (objects_.empty())
+    {
+        objects_.assign(header_.objectCount, nullptr);
+        reader_.components_.assign(header_.componentCount, nullptr);
+    }
+
+    for (bool first = true; objectCursor_ < header_.objectCount && !failed_; first = false)
+    {
+        if (!first && Clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        uint32_t i = objectCursor_++;
+        ObjectRecord record;
+        std::memcpy(&record, file_.data() + header_.objectOffset + sizeof(ObjectRecord) * i, sizeof(record));
+        if ((record.parent != NullIndex && record.parent >= i)
+            || uint64_t(record.firstComponent) + record.componentCount > header_.componentCount)
+        {
+            Debug::Log(L"シーンファイルの GameObject が壊れています: " + path_);
+            failed_ = true;
+            break;
+        }
+
+        auto object = std::make_unique<GameObject>(reader_.getString(record.name));
+        GameObject* ptr = object.get();
+        ptr->SetActive(record.active != 0);
+        ptr->transform->localPosition = record.localPosition;
+        ptr->transform->localRotation = record.localRotation;
+        ptr->transform->localScale = record.localScale;
+
+        if (record.parent == NullIndex)
+        {
+            scene->AddRootGameObject(std::move(object));
+        }
+        else
+        {
+            Transform::SetParent(std::move(object), objects_[record.parent]->transform);
+        }
+        objects_[i] = ptr;
+
+        for (uint32_t c = record.firstComponent; c < record.firstComponent + record.componentCount; ++c)
+        {
+            ComponentRecord componentRecord;
+            std::memcpy(&componentRecord, file_.data() + header_.componentOffset + sizeof(ComponentRecord) * c, sizeof(componentRecord));
+
+            std::wstring_view typeName = reader_.getString(componentRecord.type);
+            SceneSerializer::Factory factory = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                if (const ComponentType* type = registry().find(typeName))
+                {
+                    factory = type->factory;
+                }
+            }
+            if (factory == nullptr)
+            {
+                Debug::Log(L"シーンの読み込み: 登録されていないコンポーネントを飛ばします " + std::wstring(typeName));
+                continue;
+            }
+
+            std::unique_ptr<Component> component = factory();
+            if (componentRecord.enabled == 0)
+            {
+                component->enabled = false;
+            }
+            Component* raw = component.get();
+            ptr->Add(std::move(component));
+
+            reader_.setRange(componentRecord.dataOffset, componentRecord.dataSize);
+            raw->Deserialize(reader_);
+            reader_.components_[c] = raw;
+        }
+    }
+    return true;
+}
+
+
+bool SceneLoader::finish()
+{
+    if (failed_ || objectCursor_ < header_.objectCount)
+    {
+        return false;
+    }
+
+    // コンポーネント間の参照をポインタに戻す
+    for (auto& fixup : reader_.fixups_)
+    {
+        if (fixup.index < reader_.components_.size() && reader_.components_[fixup.index] != nullptr)
+        {
+            fixup.apply(reader_.components_[fixup.index]);
+        }
+    }
+    reader_.fixups_.clear();
+
+    if (reader_.hasFailed())
+    {
+        Debug::Log(L"シーンファイルのデータが壊れています: " + path_);
+        failed_ = true;
+        return false;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+    Debug::Log(L"シーンを読み込みました: " + path_ + L" (" + std::to_wstring(header_.objectCount) + L" objects, "
+        + std::to_wstring(ms) + L" ms)");
+    return true;
+}
+
+
+float SceneLoader::getProgress() const
+{
+    // prepare() でアセットとモデルをひとつずつ、メインスレッドでアセットと GameObject をひとつずつ進める
+    uint32_t assets = assetTotal_.load(std::memory_order_relaxed);
+    uint32_t total = assets * 2 + modelTotal_.load(std::memory_order_relaxed) + objectTotal_.load(std::memory_order_relaxed);
+    if (total == 0)
+    {
+        return 0.0f;
+    }
+    uint32_t done = preparedCount_.load(std::memory_order_relaxed) + preparedModelCount_.load(std::memory_order_relaxed)
+        + assetCursor_ + objectCursor_;
+    return float(done) / float(total);
+}
+
+} // namespace UniDx
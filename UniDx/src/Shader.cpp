@@ -6,6 +6,8 @@
 #include <SimpleMath.h>
 
 #include <UniDx/D3DManager.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/AssetDatabase.h>
 
 #pragma comment(lib, "d3dcompiler.lib")
 
@@ -13,6 +15,41 @@ using namespace DirectX::SimpleMath;
 
 namespace UniDx
 {
+
+namespace
+{
+	// バイトコードから D3D のシェーダーと入力レイアウトを作る
+	std::shared_ptr<ShaderProgram> createProgram(const ShaderBytecode& bytecode, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
+	{
+		UNIDX_PROFILE_SCOPE("Shader::createProgram");
+
+		auto program = std::make_shared<ShaderProgram>();
+		const ComPtr<ID3DBlob>& compiledVS = bytecode.vertex;
+		const ComPtr<ID3DBlob>& compiledPS = bytecode.pixel;
+
+		// 頂点シェーダー作成
+		if (FAILED(D3DManager::getInstance()->GetDevice()->CreateVertexShader(compiledVS->GetBufferPointer(), compiledVS->GetBufferSize(), nullptr, &program->vertex)))
+		{
+			Debug::Log(L"頂点シェーダーの作成エラー");
+			return nullptr;
+		}
+		// ピクセルシェーダー作成
+		if (FAILED(D3DManager::getInstance()->GetDevice()->CreatePixelShader(compiledPS->GetBufferPointer(), compiledPS->GetBufferSize(), nullptr, &program->pixel)))
+		{
+			Debug::Log(L"ピクセルシェーダーの作成エラー");
+			return nullptr;
+		}
+
+		// 頂点インプットレイアウト作成
+		if (FAILED(D3DManager::getInstance()->GetDevice()->CreateInputLayout(layout, (UINT)layout_size, compiledVS->GetBufferPointer(), compiledVS->GetBufferSize(), &program->inputLayout)))
+		{
+			Debug::Log(L"頂点インプットレイアウトの作成エラー");
+			return nullptr;
+		}
+		return program;
+	}
+}
+
 // 各頂点バッファのレイアウト
 const std::array< D3D11_INPUT_ELEMENT_DESC, 1> VertexP::layout =
 {
@@ -55,10 +92,49 @@ const std::array< D3D11_INPUT_ELEMENT_DESC, 3> VertexPNC::layout =
 
 bool Shader::compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
 {
+	UNIDX_PROFILE_SCOPE("Shader::compile");
+
+	this->filePath = filePath;
+	this->layout = layout;
+	this->layoutSize = layout_size;
+
+	// ヘッドレスモードではコンパイルしない
+	if (!D3DManager::isAvailable())
+	{
+		fileName = std::filesystem::path(filePath).filename();
+		return true;
+	}
+
+	// 同じファイルと頂点レイアウトでコンパイル済みなら共有する
+	program_ = AssetDatabase::getInstance()->Load<ShaderProgram>(filePath, uint64_t(uintptr_t(layout)), [&]() -> std::shared_ptr<ShaderProgram>
+		{
+			ShaderBytecode bytecode;
+			if (!compileBytecode(filePath, bytecode))
+			{
+				return nullptr;
+			}
+			return createProgram(bytecode, layout, layout_size);
+		});
+	if (program_ == nullptr)
+	{
+		return false;
+	}
+
+	std::filesystem::path path(filePath);
+	fileName = path.filename();
+
+	return true;
+}
+
+
+bool Shader::compileBytecode(const std::wstring& filePath, ShaderBytecode& bytecode)
+{
+	UNIDX_PROFILE_SCOPE("Shader::compileBytecode");
+
 	ID3DBlob* error = nullptr;
 
 	// 頂点シェーダーを読み込み＆コンパイル
-	ComPtr<ID3DBlob> compiledVS;
+	ComPtr<ID3DBlob>& compiledVS = bytecode.vertex;
 	if (FAILED(D3DCompileFromFile(filePath.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE, "VS", "vs_5_0", 0, 0, &compiledVS, &error)))
 	{
 		Debug::Log(L"頂点シェーダーのコンパイルエラー");
@@ -70,7 +146,7 @@ bool Shader::compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DES
 		return false;
 	}
 	// ピクセルシェーダーを読み込み＆コンパイル
-	ComPtr<ID3DBlob> compiledPS;
+	ComPtr<ID3DBlob>& compiledPS = bytecode.pixel;
 	if (FAILED(D3DCompileFromFile(filePath.c_str(), nullptr, nullptr, "PS", "ps_5_0", 0, 0, &compiledPS, &error)))
 	{
 		Debug::Log(L"ピクセルシェーダーシェーダーのコンパイルエラー");
@@ -80,24 +156,29 @@ bool Shader::compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DES
 		}
 		return false;
 	}
+	return true;
+}
 
-	// 頂点シェーダー作成
-	if (FAILED(D3DManager::getInstance()->GetDevice()->CreateVertexShader(compiledVS->GetBufferPointer(), compiledVS->GetBufferSize(), nullptr, &m_vertex)))
-	{
-		Debug::Log(L"頂点シェーダーの作成エラー");
-		return false;
-	}
-	// ピクセルシェーダー作成
-	if (FAILED(D3DManager::getInstance()->GetDevice()->CreatePixelShader(compiledPS->GetBufferPointer(), compiledPS->GetBufferSize(), nullptr, &m_pixel)))
+
+bool Shader::create(const std::wstring& filePath, const ShaderBytecode& bytecode, const D3D11_INPUT_ELEMENT_DESC* layout, size_t layout_size)
+{
+	this->filePath = filePath;
+	this->layout = layout;
+	this->layoutSize = layout_size;
+
+	// ヘッドレスモードでは作らない
+	if (!D3DManager::isAvailable())
 	{
-		Debug::Log(L"ピクセルシェーダーの作成エラー");
-		return false;
+		fileName = std::filesystem::path(filePath).filename();
+		return true;
 	}
 
-	// 頂点インプットレイアウト作成
-	if (FAILED(D3DManager::getInstance()->GetDevice()->CreateInputLayout(layout, (UINT)layout_size, compiledVS->GetBufferPointer(), compiledVS->GetBufferSize(), &m_inputLayout)))
+	program_ = AssetDatabase::getInstance()->Load<ShaderProgram>(filePath, uint64_t(uintptr_t(layout)), [&]()
+		{
+			return createProgram(bytecode, layout, layout_size);
+		});
+	if (program_ == nullptr)
 	{
-		Debug::Log(L"頂点インプットレイアウトの作成エラー");
 		return false;
 	}
 
@@ -109,9 +190,12 @@ bool Shader::compile(const std::wstring& filePath, const D3D11_INPUT_ELEMENT_DES
 
 void Shader::setToContext() const
 {
-	D3DManager::getInstance()->GetContext()->VSSetShader(m_vertex.Get(), 0, 0);
-	D3DManager::getInstance()->GetContext()->PSSetShader(m_pixel.Get(), 0, 0);
-	D3DManager::getInstance()->GetContext()->IASetInputLayout(m_inputLayout.Get());
+	const ShaderProgram* program = program_.get();
+	D3DManager::getInstance()->GetContext()->VSSetShader(program != nullptr ? program->vertex.Get() : nullptr, 0, 0);
+	D3DManager::getInstance()->GetContext()->PSSetShader(program != nullptr ? program->pixel.Get() : nullptr, 0, 0);
+	D3DManager::getInstance()->GetContext()->IASetInputLayout(program != nullptr ? program->inputLayout.Get() : nullptr);
+
+	D3DManager::getInstance()->getFrameStats().shaderBinds++;
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,368 @@
+﻿#include "pch.h"
+#include <UniDx/StaticBatching.h>
+
+#include <UniDx/Camera.h>
+#include <UniDx/D3DManager.h>
+#include <UniDx/SceneSerializer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <compare>
+#include <map>
+
+
+namespace UniDx
+{
+
+namespace
+{
+    std::atomic<bool> batchingEnabled = true;
+
+    // 同じ StaticBatchRenderer にまとめるもの
+    struct BatchKey
+    {
+        std::vector<Material*> materials;
+        const SceneVertexType* vertex;
+        int chunkX;
+        int chunkZ;
+
+        auto operator<=>(const BatchKey&) const = default;
+    };
+
+    // 頂点シェーダの入力レイアウトから頂点の型を探す
+    const SceneVertexType* findVertexType(const std::vector<std::shared_ptr<Material>>& materials)
+    {
+        if (materials.empty() || materials.front() == nullptr)
+        {
+            return nullptr;
+        }
+        auto layout = materials.front()->shader.getInputLayout();
+        return layout.empty() ? nullptr : SceneSerializer::findVertex(layout.data());
+    }
+
+    // まとめられるメッシュか（三角形リストだけ）
+    bool isBatchable(const Mesh& mesh)
+    {
+        if (mesh.submesh.empty())
+        {
+            return false;
+        }
+        for (auto& sub : mesh.submesh)
+        {
+            if (sub == nullptr || sub->positions.empty() || sub->topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void collectRenderers(GameObject* object, std::vector<MeshRenderer*>& out)
+    {
+        if (object == nullptr || !object->activeSelf)
+        {
+            return;
+        }
+        for (auto& c : object->GetComponents())
+        {
+            // まとめたものをもう一度まとめない
+            if (auto r = dynamic_cast<MeshRenderer*>(c.get()); r != nullptr && dynamic_cast<StaticBatchRenderer*>(r) == nullptr)
+            {
+                out.push_back(r);
+            }
+        }
+        for (auto& child : object->transform->getChildGameObjects())
+        {
+            collectRenderers(child.get(), out);
+        }
+    }
+
+    // 頂点属性を dst の offset 番目からコピーする。元に無ければ fill で埋める
+    template<typename T>
+    void appendAttribute(std::span<const T> src, size_t count, std::vector<T>& dst, size_t offset, const T& fill)
+    {
+        if (src.size() == count)
+        {
+            std::copy(src.begin(), src.end(), dst.begin() + offset);
+        }
+        else
+        {
+            std::fill(dst.begin() + offset, dst.begin() + offset + count, fill);
+        }
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// 有効化
+// -----------------------------------------------------------------------------
+void StaticBatchRenderer::OnEnable()
+{
+    MeshRenderer::OnEnable();
+
+    // 再度有効になったときは作り直さない
+    if (mesh.submesh.empty())
+    {
+        buildMesh();
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// sources のメッシュを、このオブジェクトのローカル座標に焼き込んでひとつにまとめる
+// -----------------------------------------------------------------------------
+void StaticBatchRenderer::buildMesh()
+{
+    const SceneVertexType* vertex = findVertexType(materials);
+    if (vertex == nullptr)
+    {
+        Debug::Log(L"StaticBatchRenderer: 登録されていない頂点の型なので、まとめられません");
+        return;
+    }
+
+    // 大きさと、どの頂点属性を持つかを数える
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    bool hasNormals = false, hasColors = false, hasUV = false, hasUV2 = false, hasUV3 = false, hasUV4 = false;
+    for (MeshRenderer* source : sources)
+    {
+        if (source == nullptr) continue;
+
+        source->createMesh();
+        for (auto& sub : source->mesh.submesh)
+        {
+            vertexCount += sub->positions.size();
+            indexCount += sub->indices.empty() ? sub->positions.size() : sub->indices.size();
+            hasNormals |= !sub->normals.empty();
+            hasColors |= !sub->colors.empty();
+            hasUV |= !sub->uv.empty();
+            hasUV2 |= !sub->uv2.empty();
+            hasUV3 |= !sub->uv3.empty();
+            hasUV4 |= !sub->uv4.empty();
+        }
+    }
+    if (vertexCount == 0)
+    {
+        return;
+    }
+
+    auto batch = std::make_shared<OwnedSubMesh>();
+    batch->topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    batch->resizePositions(vertexCount);
+    batch->resizeIndices(indexCount);
+    if (hasNormals) batch->resizeNormals(vertexCount);
+    if (hasColors) batch->resizeColors(vertexCount);
+    if (hasUV) batch->resizeUV(vertexCount);
+    if (hasUV2) batch->resizeUV2(vertexCount);
+    if (hasUV3) batch->resizeUV3(vertexCount);
+    if (hasUV4) batch->resizeUV4(vertexCount);
+
+    auto& positions = const_cast<std::vector<Vector3>&>(batch->mutablePositions());
+    auto& normals = const_cast<std::vector<Vector3>&>(batch->mutableNormals());
+    auto& colors = const_cast<std::vector<Color>&>(batch->mutableColors());
+    auto& uv = const_cast<std::vector<Vector2>&>(batch->mutableUV());
+    auto& uv2 = const_cast<std::vector<Vector2>&>(batch->mutableUV2());
+    auto& uv3 = const_cast<std::vector<Vector2>&>(batch->mutableUV3());
+    auto& uv4 = const_cast<std::vector<Vector2>&>(batch->mutableUV4());
+    auto& indices = const_cast<std::vector<uint32_t>&>(batch->mutableIndices());
+
+    const Matrix worldToLocal = transform->getLocalToWorldMatrix().Invert();
+    size_t vertexOffset = 0;
+    size_t indexOffset = 0;
+    for (MeshRenderer* source : sources)
+    {
+        if (source == nullptr) continue;
+
+        // 元のローカル座標からこのオブジェクトのローカル座標へ。法線は逆転置行列で変換する
+        const Matrix toLocal = source->transform->getLocalToWorldMatrix() * worldToLocal;
+        const Matrix normalMatrix = toLocal.Invert().Transpose();
+
+        for (auto& sub : source->mesh.submesh)
+        {
+            const size_t count = sub->positions.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                positions[vertexOffset + i] = Vector3::Transform(sub->positions[i], toLocal);
+            }
+            if (hasNormals)
+            {
+                if (sub->normals.size() == count)
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        Vector3 n = Vector3::TransformNormal(sub->normals[i], normalMatrix);
+                        n.Normalize();
+                        normals[vertexOffset + i] = n;
+                    }
+                }
+                else
+                {
+                    std::fill(normals.begin() + vertexOffset, normals.begin() + vertexOffset + count, Vector3::Zero);
+                }
+            }
+            if (hasColors) appendAttribute(sub->colors, count, colors, vertexOffset, Color(1, 1, 1, 1));
+            if (hasUV) appendAttribute(sub->uv, count, uv, vertexOffset, Vector2::Zero);
+            if (hasUV2) appendAttribute(sub->uv2, count, uv2, vertexOffset, Vector2::Zero);
+            if (hasUV3) appendAttribute(sub->uv3, count, uv3, vertexOffset, Vector2::Zero);
+            if (hasUV4) appendAttribute(sub->uv4, count, uv4, vertexOffset, Vector2::Zero);
+
+            // インデックスが無ければ頂点の順に三角形を作る
+            if (sub->indices.empty())
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    indices[indexOffset++] = uint32_t(vertexOffset + i);
+                }
+            }
+            else
+            {
+                for (uint32_t index : sub->indices)
+                {
+                    indices[indexOffset++] = uint32_t(vertexOffset + index);
+                }
+            }
+            vertexOffset += count;
+        }
+    }
+
+    // まとめた範囲
+    Vector3 mn = positions[0];
+    Vector3 mx = positions[0];
+    for (const Vector3& p : positions)
+    {
+        mn = Vector3::Min(mn, p);
+        mx = Vector3::Max(mx, p);
+    }
+    bounds_ = Bounds((mn + mx) * 0.5f, (mx - mn) * 0.5f);
+
+    if (D3DManager::isAvailable())
+    {
+        vertex->createBuffer(batch.get());
+    }
+    mesh.submesh.push_back(std::move(batch));
+}
+
+
+// -----------------------------------------------------------------------------
+// まとめた範囲が視錐台に入っていれば描画
+// -----------------------------------------------------------------------------
+void StaticBatchRenderer::Render(const Camera& camera) const
+{
+    if (mesh.submesh.empty())
+    {
+        return;
+    }
+
+    DirectX::BoundingBox worldBounds;
+    bounds_.Transform(worldBounds, transform->getLocalToWorldMatrix());
+
+    DirectX::BoundingFrustum frustum(camera.GetProjectionMatrix(16.0f / 9.0f));
+    frustum.Transform(frustum, camera.GetViewMatrix().Invert());
+    if (!frustum.Intersects(worldBounds))
+    {
+        return;
+    }
+
+    MeshRenderer::Render(camera);
+}
+
+
+// -----------------------------------------------------------------------------
+// 元の Renderer への参照とマテリアル。メッシュは有効化したときに作り直す
+// -----------------------------------------------------------------------------
+void StaticBatchRenderer::Serialize(SceneWriter& writer) const
+{
+    writer.write(uint32_t(sources.size()));
+    for (MeshRenderer* source : sources)
+    {
+        writer.writeReference(source);
+    }
+    serializeMaterials(writer);
+}
+
+
+void StaticBatchRenderer::Deserialize(SceneReader& reader)
+{
+    // 参照は後から要素のアドレスに書き込まれるので、先に大きさを決めておく
+    uint32_t count = reader.read<uint32_t>();
+    sources.assign(reader.hasFailed() ? 0 : count, nullptr);
+    for (auto& source : sources)
+    {
+        reader.readReference(source);
+    }
+    deserializeMaterials(reader);
+}
+
+
+// -----------------------------------------------------------------------------
+// マテリアルと空間のチャンクごとにまとめる
+// -----------------------------------------------------------------------------
+int StaticBatching::Combine(std::span<GameObject* const> objects, GameObject* batchRoot, float chunkSize)
+{
+    if (!batchingEnabled || batchRoot == nullptr)
+    {
+        return 0;
+    }
+    chunkSize = std::max(chunkSize, 0.001f);
+
+    std::vector<MeshRenderer*> renderers;
+    for (GameObject* object : objects)
+    {
+        collectRenderers(object, renderers);
+    }
+
+    // Renderer の位置（batchRoot のローカル座標）でチャンクに振り分ける
+    const Matrix worldToRoot = batchRoot->transform->getLocalToWorldMatrix().Invert();
+    std::map<BatchKey, std::vector<MeshRenderer*>> batches;
+    for (MeshRenderer* r : renderers)
+    {
+        const SceneVertexType* vertex = findVertexType(r->materials);
+        r->createMesh();
+        if (vertex == nullptr || !isBatchable(r->mesh))
+        {
+            continue;
+        }
+
+        BatchKey key{};
+        for (auto& material : r->materials)
+        {
+            key.materials.push_back(material.get());
+        }
+        key.vertex = vertex;
+        Vector3 p = Vector3::Transform(r->transform->getWorldPosition(), worldToRoot);
+        key.chunkX = int(std::floor(p.x / chunkSize));
+        key.chunkZ = int(std::floor(p.z / chunkSize));
+        batches[key].push_back(r);
+    }
+
+    for (auto& [key, sources] : batches)
+    {
+        auto batchObject = std::make_unique<GameObject>(L"StaticBatch");
+        auto batch = batchObject->AddComponent<StaticBatchRenderer>();
+        batch->materials = sources.front()->materials;
+        batch->sources = sources;
+
+        // まとめたものが代わりに描くので、元の Renderer は無効にする
+        for (MeshRenderer* r : sources)
+        {
+            r->enabled = false;
+        }
+        Transform::SetParent(std::move(batchObject), batchRoot->transform);
+    }
+    return int(batches.size());
+}
+
+
+void StaticBatching::setEnabled(bool enabled)
+{
+    batchingEnabled = enabled;
+}
+
+
+bool StaticBatching::isEnabled()
+{
+    return batchingEnabled;
+}
+
+} // namespace UniDx
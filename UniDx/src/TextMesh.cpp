@@ -3,6 +3,7 @@
 #include <UniDx/TextMesh.h>
 #include <UniDx/D3DManager.h>
 #include <UniDx/Font.h>
+#include <UniDx/SceneSerializer.h>
 
 using namespace DirectX;
 
@@ -12,6 +13,7 @@ namespace UniDx {
 void TextMesh::Awake()
 {
 	UIBehaviour::Awake();
+	if (!D3DManager::isAvailable()) return;
 	spriteBatch = std::make_unique<SpriteBatch>(D3DManager::getInstance()->GetContext().Get());
 }
 
@@ -29,6 +31,25 @@ void TextMesh::Render(const Matrix& proj) const
     font->getSpriteFont()->DrawString(spriteBatch.get(), text.c_str(), drawPos);
 
     spriteBatch->End();
+
+    // SpriteBatch ͓eNX`̕܂Ƃ߂1ŕ`悷
+    D3DManager::getInstance()->getFrameStats().drawCalls++;
+}
+
+
+void TextMesh::Serialize(SceneWriter& writer) const
+{
+	UIBehaviour::Serialize(writer);
+	writer.writeString(text);
+	writer.writeFont(font);
+}
+
+
+void TextMesh::Deserialize(SceneReader& reader)
+{
+	UIBehaviour::Deserialize(reader);
+	text = reader.readString();
+	font = reader.readFont();
 }
 
 }
@@ -4,6 +4,7 @@
 #include <filesystem>
 
 #include <UniDx/D3DManager.h>
+#include <UniDx/Profiler.h>
 
 
 namespace UniDx
@@ -11,27 +12,66 @@ namespace UniDx
 
 bool Texture::Load(const std::wstring& filePath)
 {
-	// WIC画像を読み込む
-	auto image = std::make_unique<DirectX::ScratchImage>();
-	if (FAILED(DirectX::LoadFromWICFile(filePath.c_str(), DirectX::WIC_FLAGS_NONE, &m_info, *image)))
+	UNIDX_PROFILE_SCOPE("Texture::Load");
+
+	// ヘッドレスモードでは読み込まない
+	if (!D3DManager::isAvailable())
+	{
+		this->filePath = filePath;
+		fileName = std::filesystem::path(filePath).filename();
+		return true;
+	}
+
+	DirectX::ScratchImage image;
+	if (!Decode(filePath, image))
 	{
 		// 失敗
 		m_info = {};
 		return false;
 	}
+	return Create(filePath, image);
+}
+
+
+bool Texture::Decode(const std::wstring& filePath, DirectX::ScratchImage& image)
+{
+	UNIDX_PROFILE_SCOPE("Texture::Decode");
+
+	// WIC画像を読み込む
+	if (FAILED(DirectX::LoadFromWICFile(filePath.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image)))
+	{
+		// 失敗
+		return false;
+	}
 
 	// ミップマップの生成
-	if (m_info.mipLevels == 1)
+	if (image.GetMetadata().mipLevels == 1)
 	{
-		auto mipChain = std::make_unique<DirectX::ScratchImage>();
-		if (SUCCEEDED(DirectX::GenerateMipMaps(image->GetImages(), image->GetImageCount(), image->GetMetadata(), DirectX::TEX_FILTER_DEFAULT, 0, *mipChain)))
+		DirectX::ScratchImage mipChain;
+		if (SUCCEEDED(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_DEFAULT, 0, mipChain)))
 		{
 			image = std::move(mipChain);
 		}
 	}
+	return true;
+}
+
+
+bool Texture::Create(const std::wstring& filePath, const DirectX::ScratchImage& image)
+{
+	UNIDX_PROFILE_SCOPE("Texture::Create");
+
+	// ヘッドレスモードでは作らない
+	if (!D3DManager::isAvailable())
+	{
+		this->filePath = filePath;
+		fileName = std::filesystem::path(filePath).filename();
+		return true;
+	}
 
 	// リソースとシェーダーリソースビューを作成
-	if (FAILED(DirectX::CreateShaderResourceView(D3DManager::getInstance()->GetDevice().Get(), image->GetImages(), image->GetImageCount(), m_info, &m_srv)))
+	m_info = image.GetMetadata();
+	if (FAILED(DirectX::CreateShaderResourceView(D3DManager::getInstance()->GetDevice().Get(), image.GetImages(), image.GetImageCount(), m_info, &m_srv)))
 	{
 		// 失敗
 		m_info = {};
@@ -40,6 +80,7 @@ bool Texture::Load(const std::wstring& filePath)
 
 	std::filesystem::path path(filePath);
 	fileName = path.filename();
+	this->filePath = filePath;
 
 	// サンプラ
 	D3D11_SAMPLER_DESC samplerDesc;
@@ -70,6 +111,8 @@ void Texture::setForRender() const
 	// サンプラのバインド
 	ID3D11SamplerState* pState = samplerState.Get();
 	D3DManager::getInstance()->GetContext()->PSSetSamplers(UNIDX_PS_SLOT_ALBEDO, 1, &pState);
+
+	D3DManager::getInstance()->getFrameStats().textureBinds++;
 }
 
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 ﻿#include "pch.h"
 
+#include <UniDx/SceneManager.h>
+#include <UniDx/Scene.h>
 
 namespace UniDx
 {
@@ -31,7 +33,8 @@ GameObject* Transform::SetParent(Transform * newParent)
         [this](const unique_ptr<GameObject>& ptr) { return ptr->transform == this; });
     assert(it != siblings.end());
 
-    GameObject* gameObject_ptr = it->get();
+    unique_ptr<GameObject> gameObjectPtr = std::move(*it);
+    GameObject* gameObject_ptr = gameObjectPtr.get();
     assert(gameObject_ptr != nullptr);
 
     // 元の親から削除
@@ -43,9 +46,15 @@ GameObject* Transform::SetParent(Transform * newParent)
     if (parent)
     {
         // 新しい親に自分を持つGameObjectを追加
-        parent->children.push_back(std::move(*it));
+        parent->children.push_back(std::move(gameObjectPtr));
+    }
+    else
+    {
+        // 親をなくした場合はシーンのルートに置く
+        SceneManager::getInstance()->GetActiveScene()->AddRootGameObject(std::move(gameObjectPtr));
     }
     m_dirty = true;
+    gameObject_ptr->updateActiveInHierarchy();
 
     return gameObject_ptr;
 }
@@ -64,11 +73,42 @@ void Transform::SetParent(unique_ptr<GameObject> gameObjectPtr, Transform* newPa
     // 新しい親を設定
     gameObjectPtr->transform->parent = newParent;
     gameObjectPtr->transform->m_dirty = true;
+    GameObject* gameObject = gameObjectPtr.get();
     if (newParent)
     {
         // 新しい親に自分を持つGameObjectを追加
         newParent->children.push_back(std::move(gameObjectPtr));
     }
+    gameObject->updateActiveInHierarchy();
+}
+
+
+// 親（またはシーンのルート）から外して所有権を取り出す
+unique_ptr<GameObject> Transform::DetachFromParent()
+{
+    unique_ptr<GameObject> result;
+    if (parent == nullptr)
+    {
+        Scene* scene = SceneManager::getInstance()->GetActiveScene();
+        if (scene != nullptr)
+        {
+            result = scene->ReleaseRootGameObject(gameObject);
+        }
+        return result;
+    }
+
+    auto& siblings = parent->children;
+    auto it = std::find_if(
+        siblings.begin(), siblings.end(),
+        [this](const unique_ptr<GameObject>& ptr) { return ptr->transform == this; });
+    if (it != siblings.end())
+    {
+        result = std::move(*it);
+        siblings.erase(it);
+    }
+    parent = nullptr;
+    m_dirty = true;
+    return result;
 }
 
 
@@ -97,12 +137,23 @@ void Transform::updateMatrices() const
         if (parent) {
             parent->updateMatrices();
             m_worldMatrix = m_localMatrix * parent->m_worldMatrix;
+
+            // 回転とスケールは親のキャッシュから合成し、行列の分解を避ける
+            m_worldRotation = Quaternion::Concatenate(parent->m_worldRotation, _localRotation);
+            m_lossyScale = parent->m_lossyScale * _localScale;
         }
         else {
             m_worldMatrix = m_localMatrix;
+            m_worldRotation = _localRotation;
+            m_lossyScale = _localScale;
         }
+        m_worldPosition = m_worldMatrix.Translation();
         m_dirty = false;
 
+        // 変更を記録
+        m_changeVersion = s_changeVersionCounter.fetch_add(1, std::memory_order_relaxed) + 1;
+        m_hasChanged = true;
+
         // 親の行列が変わったので、子も変わるように
         for (auto& c : children)
         {
@@ -2,6 +2,7 @@
 
 #include <UniDx/Input.h>
 #include <UniDx/Time.h>
+#include <UniDx/SceneSerializer.h>
 
 #include "Player.h"
 
@@ -44,3 +45,17 @@ void CameraBehaviour::Update()
     }
     transform->localRotation = localRot * rot;
 }
+
+
+void CameraBehaviour::Serialize(SceneWriter& writer) const
+{
+    Behaviour::Serialize(writer);
+    writer.writeReference(player);
+}
+
+
+void CameraBehaviour::Deserialize(SceneReader& reader)
+{
+    Behaviour::Deserialize(reader);
+    reader.readReference(player);
+}
@@ -12,4 +12,7 @@ public:
 
     virtual void OnEnable() override;
     virtual void Update() override;
+
+    virtual void Serialize(UniDx::SceneWriter& writer) const override;
+    virtual void Deserialize(UniDx::SceneReader& reader) override;
 };
\ No newline at end of file
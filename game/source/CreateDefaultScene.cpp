@@ -7,10 +7,14 @@
 #include <UniDx/Scene.h>
 #include <UniDx/PrimitiveRenderer.h>
 #include <UniDx/GltfModel.h>
+#include <UniDx/LODGroup.h>
+#include <UniDx/StaticBatching.h>
 #include <UniDx/Canvas.h>
 #include <UniDx/TextMesh.h>
 #include <UniDx/Font.h>
 #include <UniDx/Image.h>
+#include <UniDx/RenderStatsView.h>
+#include <UniDx/AssetDatabase.h>
 
 #include "CameraBehaviour.h"
 #include "Player.h"
@@ -60,16 +64,11 @@ unique_ptr<GameObject> createMap(GameObject* player)
     wallMat->shader.compile<VertexPNT>(L"Resource/AlbedoShade.hlsl");
 
     // 壁テクスチャ作成
-    auto wallTex = std::make_shared<Texture>();
-    wallTex->Load(L"Resource/wall-1.png");
-    wallMat->AddTexture(std::move(wallTex));
-
-    // 敵テクスチャ作成
-    auto enemyTex = std::make_shared<Texture>();
-    enemyTex->Load(L"Resource/Universal_A_Alb.png");
+    wallMat->AddTexture(AssetDatabase::getInstance()->LoadTexture(L"Resource/wall-1.png"));
 
     // マップ作成
     auto map = make_unique<GameObject>();
+    vector<GameObject*> walls;
 
     // 各ブロック作成
     for (int i = 0; i < MapData::getInstance()->getWidth(); i++)
@@ -97,6 +96,7 @@ unique_ptr<GameObject> createMap(GameObject* player)
                 );
 
                 // 壁の親をマップにする
+                walls.push_back(wall.get());
                 Transform::SetParent(move(wall), map->transform);
             }
             break;
@@ -106,6 +106,7 @@ unique_ptr<GameObject> createMap(GameObject* player)
                 // 敵オブジェクトを作成
                 auto enemy = make_unique<GameObject>(L"敵",
                     make_unique<GltfModel>(),
+                    make_unique<LODGroup>(),   // 遠くの敵は簡略化した LOD で描く（-mesh-lod=N で作ったとき）
                     make_unique<Rigidbody>(),
                     make_unique<SphereCollider>(Vector3(0, 0.25f, 0), 1.5f)
                     );
@@ -113,7 +114,7 @@ unique_ptr<GameObject> createMap(GameObject* player)
                 model->Load<VertexPNT>(
                     L"Resource/Pumpkin-carved-lit-a.glb",
                     L"Resource/AlbedoShade.hlsl",
-                    enemyTex);
+                    L"Resource/Universal_A_Alb.png");   // モデルのラップモードで読み込んで敵どうしで共有
 
                 // マテリアルカラーを半透明にする
                 for (auto& mat : model->GetMaterials())
@@ -139,6 +140,9 @@ unique_ptr<GameObject> createMap(GameObject* player)
         }
     }
 
+    // 壁は動かないので、チャンクごとにまとめて描く
+    StaticBatching::Combine(walls, map.get());
+
     return move(map);
 }
 
@@ -182,14 +186,19 @@ unique_ptr<Scene> CreateDefaultScene()
     light->transform->localRotation = Quaternion::CreateFromYawPitchRoll(0.2f, 0.9f, 0);
 
     // -- UI --
-    auto font = make_shared<Font>();
-    font->Load(L"Resource/M PLUS 1.spritefont");
+    auto font = AssetDatabase::getInstance()->LoadFont(L"Resource/M PLUS 1.spritefont");
     auto textMesh = make_unique<TextMesh>();
     textMesh->font = font;
     textMesh->text = L"-";
     auto textObj = make_unique<GameObject>(L"テキスト", textMesh);
     textObj->transform->localPosition = Vector3(100, 20, 0);
 
+    // 描画の統計（最初は隠しておき、F3 か -stats で表示）
+    auto statsText = make_unique<TextMesh>();
+    statsText->font = font;
+    auto statsObj = make_unique<GameObject>(L"描画統計", statsText, make_unique<RenderStatsView>());
+    statsObj->transform->localPosition = Vector3(20, 80, 0);
+
     auto canvas = make_unique<Canvas>();
     canvas->LoadDefaultMaterial(L"Resource");
 
@@ -216,7 +225,8 @@ unique_ptr<Scene> CreateDefaultScene()
 
         make_unique<GameObject>(L"UI",
             move(canvas),
-            move(textObj)
+            move(textObj),
+            move(statsObj)
         )
     );
 }
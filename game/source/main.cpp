@@ -6,6 +6,38 @@
 
 #include <UniDx.h>
 #include <UniDx/Engine.h>
+#include <UniDx/EngineContext.h>
+#include <UniDx/EventBus.h>
+
+#include <UniDx/AccessorDecoder.h>
+#include <UniDx/AssetDatabase.h>
+#include <UniDx/GltfModel.h>
+#include <UniDx/JobSystem.h>
+#include <UniDx/LinearAllocator.h>
+#include <UniDx/MeshCache.h>
+#include <UniDx/MeshOptimizer.h>
+#include <UniDx/MeshSimplifier.h>
+#include <UniDx/Profiler.h>
+#include <UniDx/RenderStatsView.h>
+#include <UniDx/SceneArena.h>
+#include <UniDx/SceneManager.h>
+#include <UniDx/SceneSerializer.h>
+#include <UniDx/StaticBatching.h>
+
+#include "Player.h"
+#include "CameraBehaviour.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
 
 #define MAX_LOADSTRING 100
 
@@ -18,11 +50,52 @@ WCHAR szWindowClass[MAX_LOADSTRING];            // メイン ウィンドウ ク
 using namespace UniDx;
 
 
+#ifdef UNIDX_ENABLE_ALLOCATION_COUNTER
+// グローバルな operator new を置き換えて AllocationCounter で回数を数える
+// 配列版と nothrow 版は既定でこれを呼ぶので置き換えない
+void* operator new(std::size_t size)
+{
+    AllocationCounter::recordAllocation();
+    if (size == 0)
+    {
+        size = 1;
+    }
+    for (;;)
+    {
+        if (void* p = std::malloc(size))
+        {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+#endif
+
+
 // このコード モジュールに含まれる関数の宣言を転送します:
 ATOM                MyRegisterClass(HINSTANCE hInstance);
 BOOL                InitInstance(HINSTANCE, int);
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK    About(HWND, UINT, WPARAM, LPARAM);
+int                 RunHeadless(LPCWSTR cmdLine);
+int                 RunGltfBenchmark(LPCWSTR cmdLine);
+int                 RunJobBenchmark(LPCWSTR cmdLine);
+int                 RunMeshAnalysis();
+int                 RunSelfTest();
+void                StartProfile(LPCWSTR cmdLine);
+void                SetupSceneFile(LPCWSTR cmdLine);
+std::wstring        GetOptionValue(LPCWSTR cmdLine, LPCWSTR option);
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_opt_ HINSTANCE hPrevInstance,
@@ -30,7 +103,78 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
                      _In_ int       nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+#ifdef UNIDX_ENABLE_ALLOCATION_COUNTER
+    AllocationCounter::setEnabled(true);
+#endif
+
+    // -profile=秒数 : 起動から指定秒数の間を計測して trace.json に書き出す
+    StartProfile(lpCmdLine);
+
+    // -no-arena : シーンのアリーナを使わない（構築・破棄時間の比較用）
+    if (wcsstr(lpCmdLine, L"-no-arena") != nullptr)
+    {
+        SceneArena::setEnabled(false);
+    }
+
+    // -load-scene=パス : シーンファイルから読み込む
+    // -save-scene=パス : CreateDefaultScene() で作ったシーンを書き出す
+    SetupSceneFile(lpCmdLine);
+
+    // -bench-gltf : Resource/*.glb の読み込み時間を逐次と並列のデコードで比較して終了
+    if (wcsstr(lpCmdLine, L"-bench-gltf") != nullptr)
+    {
+        return RunGltfBenchmark(lpCmdLine);
+    }
+
+    // -bench-jobs : ジョブシステムの負荷試験と、ジョブが動き出すまでの遅延を計測して終了（失敗があれば終了コード 1）
+    if (wcsstr(lpCmdLine, L"-bench-jobs") != nullptr)
+    {
+        return RunJobBenchmark(lpCmdLine);
+    }
+
+    // -selftest : CPU だけで動くエンジンの部分を確かめて終了（失敗があれば終了コード 1）
+    if (wcsstr(lpCmdLine, L"-selftest") != nullptr)
+    {
+        return RunSelfTest();
+    }
+
+    // -mesh-lod=N : glTF の読み込みで簡略化した LOD を N 段まで作る
+    std::wstring lodOption = GetOptionValue(lpCmdLine, L"-mesh-lod=");
+    if (!lodOption.empty())
+    {
+        MeshSimplifier::setImportLODCount(_wtoi(lodOption.c_str()));
+    }
+
+    // -analyze-mesh : Resource/*.glb の頂点キャッシュの効率を MeshOptimizer の前後で比較して終了
+    if (wcsstr(lpCmdLine, L"-analyze-mesh") != nullptr)
+    {
+        return RunMeshAnalysis();
+    }
+
+    // -optimize-mesh : glTF の読み込みで三角形と頂点を並べ替える
+    if (wcsstr(lpCmdLine, L"-optimize-mesh") != nullptr)
+    {
+        MeshOptimizer::setEnabled(true);
+    }
+
+    // -no-static-batching : マップの壁をまとめずに1つずつ描く（描画回数の比較用）
+    if (wcsstr(lpCmdLine, L"-no-static-batching") != nullptr)
+    {
+        StaticBatching::setEnabled(false);
+    }
+
+    // -stats : 描画の統計を最初から表示する（実行中は F3 で切り替え）
+    if (wcsstr(lpCmdLine, L"-stats") != nullptr)
+    {
+        RenderStatsView::setVisibleByDefault(true);
+    }
+
+    // -headless : ウィンドウとDirect3Dを使わずにゲームロジックと物理だけを実行
+    if (wcsstr(lpCmdLine, L"-headless") != nullptr)
+    {
+        return RunHeadless(lpCmdLine);
+    }
 
     // グローバル文字列を初期化する
     LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
@@ -49,6 +193,1113 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 
 
 
+#ifdef UNIDX_HEADLESS_TARGET
+//
+//  関数: wmain(int, wchar_t*[])
+//
+//  目的: コンソール版（headless.vcxproj）の入り口です。
+//        ウィンドウも Direct3D も作らず、常に -headless として実行します。
+//        -selftest や -bench-gltf などはゲームと同じように使えます。
+//
+int wmain(int argc, wchar_t* argv[])
+{
+    // GetOptionValue() が読めるように、空白を含む値は "" で囲み直す
+    std::wstring cmdLine;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::wstring arg = argv[i];
+        size_t equal = arg.find(L'=');
+        if (equal != std::wstring::npos && arg.find(L' ') != std::wstring::npos)
+        {
+            arg = arg.substr(0, equal + 1) + L'"' + arg.substr(equal + 1) + L'"';
+        }
+        cmdLine += arg;
+        cmdLine += L' ';
+    }
+    cmdLine += L"-headless";
+    return wWinMain(GetModuleHandleW(nullptr), nullptr, cmdLine.data(), SW_HIDE);
+}
+#endif
+
+
+
+//
+//  関数: RunHeadless(LPCWSTR)
+//
+//  目的: ヘッドレスモードでエンジンを実行します。
+//        エンジンごとのフレーム数と updateFrame() の時間、シーンの構築と破棄の時間を
+//        標準出力と headless.txt に書き出します。
+//
+//  コマンドライン:
+//        -fast     : フレーム間で待たずに実行する（ベンチマーク用）
+//        -frames=N : N フレーム実行して終了する
+//        -instances=N : 独立したエンジンを N 個、それぞれ別スレッドで実行する
+//
+namespace
+{
+    // 結果を標準出力とファイルに書く（Release では Debug::Log が何もしないので CI で読めるように）
+    void ReportHeadless(const std::vector<Engine::HeadlessStats>& results)
+    {
+        std::ofstream out("headless.txt", std::ios::binary);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Engine::HeadlessStats& stats = results[i];
+            double average = stats.frames > 0 ? stats.updateMilliseconds / double(stats.frames) : 0.0;
+            wchar_t line[256];
+            swprintf_s(line, L"エンジン %zu: %llu フレーム, 更新 平均 %.3f ms, 最大 %.3f ms, 実時間 %.3f 秒, シーン 構築 %.3f ms, 破棄 %.3f ms",
+                i, (unsigned long long)stats.frames, average, stats.maxUpdateMilliseconds, stats.wallSeconds,
+                stats.sceneBuildMilliseconds, stats.sceneDestroyMilliseconds);
+            Debug::Log(std::wstring(line));
+
+            std::string utf8 = ToUtf8(line) + "\n";
+            out << utf8;
+            fputs(utf8.c_str(), stdout);
+        }
+        fflush(stdout);
+    }
+}
+
+int RunHeadless(LPCWSTR cmdLine)
+{
+    bool fast = wcsstr(cmdLine, L"-fast") != nullptr;
+
+    uint64_t frames = 0;
+    const wchar_t* framesOption = wcsstr(cmdLine, L"-frames=");
+    if (framesOption != nullptr)
+    {
+        frames = wcstoull(framesOption + wcslen(L"-frames="), nullptr, 10);
+    }
+
+    int instances = 1;
+    const wchar_t* instancesOption = wcsstr(cmdLine, L"-instances=");
+    if (instancesOption != nullptr)
+    {
+        instances = std::max(_wtoi(instancesOption + wcslen(L"-instances=")), 1);
+    }
+
+    std::vector<Engine::HeadlessStats> results(instances);
+    if (instances == 1)
+    {
+        // UniDxエンジンのインスタンス作成
+        Engine::create();
+        Engine::getInstance()->InitializeHeadless();
+
+        int result = Engine::getInstance()->HeadlessLoop(60.0, fast, frames);
+        results[0] = Engine::getInstance()->getHeadlessStats();
+        ReportHeadless(results);
+        return result;
+    }
+
+    // ジョブシステムはプロセスで共有するので先に作っておく
+    JobSystem::create();
+    JobSystem::getInstance()->Initialize();
+
+    // エンジンごとに EngineContext を作り、スレッドの現在のコンテキストにする
+    std::vector<std::thread> threads;
+    for (int i = 0; i < instances; ++i)
+    {
+        threads.emplace_back([fast, frames, &stats = results[i]]()
+            {
+                EngineContext context;
+                EngineContext::Scope scope(&context);
+
+                Engine::create();
+                Engine::getInstance()->InitializeHeadless();
+                Engine::getInstance()->HeadlessLoop(60.0, fast, frames);
+                stats = Engine::getInstance()->getHeadlessStats();
+            });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    JobSystem::destroy();
+    ReportHeadless(results);
+    return 0;
+}
+
+
+
+//
+//  関数: RunGltfBenchmark(LPCWSTR)
+//
+//  目的: Resource/*.glb の読み込み時間を、プリミティブの逐次デコードと並列デコードで比較します。
+//        変換済みメッシュのキャッシュは使いません。GPU のバッファは作りません。
+//        続けて AccessorDecoder::Decode を DecodeScalar と比べ、結果が一致するかと時間を調べます。
+//        結果は bench_gltf.txt に書き出します。
+//
+//  コマンドライン:
+//        -bench-gltf=N : ファイルごとに N 回読み込んで最短の時間を使う（省略時は 10）
+//
+namespace
+{
+    template<typename T>
+    bool SameSpan(std::span<const T> a, std::span<const T> b)
+    {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size_bytes()) == 0);
+    }
+
+    // 逐次と並列で同じ結果になっているか
+    bool SameModel(const GltfModelAsset& a, const GltfModelAsset& b)
+    {
+        if (a.getNodes().size() != b.getNodes().size() || a.getSubMeshes().size() != b.getSubMeshes().size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.getSubMeshes().size(); ++i)
+        {
+            const SubMesh& x = *a.getSubMeshes()[i];
+            const SubMesh& y = *b.getSubMeshes()[i];
+            if (!SameSpan(x.positions, y.positions) || !SameSpan(x.normals, y.normals) || !SameSpan(x.colors, y.colors)
+                || !SameSpan(x.uv, y.uv) || !SameSpan(x.uv2, y.uv2) || !SameSpan(x.uv3, y.uv3) || !SameSpan(x.uv4, y.uv4)
+                || !SameSpan(x.indices, y.indices)
+                || memcmp(&a.getSubMeshBounds()[i], &b.getSubMeshBounds()[i], sizeof(Bounds)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // AccessorDecoder で比べる入力
+    struct DecodeCase
+    {
+        const wchar_t* name;
+        int componentType;
+        bool normalized;
+        int components;
+        int dstComponents;
+        size_t padding;     // 要素のあとの空きのバイト数（0 なら詰めて並ぶ）
+    };
+
+    // Decode と DecodeScalar で同じ入力を変換し、結果と時間を比べる
+    bool CompareDecode(const DecodeCase& c, int iterations, std::ofstream& out)
+    {
+        using clock = std::chrono::steady_clock;
+
+        const size_t count = 100003;  // 4 要素ずつにならない端も通す
+        const size_t size = AccessorDecoder::ComponentSize(c.componentType);
+        const size_t stride = size * c.components + c.padding;
+
+        std::vector<uint8_t> src(stride * count);
+        std::mt19937 random(12345);
+        for (auto& b : src)
+        {
+            b = uint8_t(random());
+        }
+        // 符号付きの最小値（-128, -32768）を必ず含める。正規化すると -1 にそろう
+        for (size_t i = 0; i < count; i += 7)
+        {
+            src[i * stride + size - 1] = 0x80;
+            if (size == 2)
+            {
+                src[i * stride] = 0x00;
+            }
+        }
+
+        const float fill[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        std::vector<float> expected(count * c.dstComponents);
+        std::vector<float> actual(count * c.dstComponents);
+        double best[2] = { 1e9, 1e9 };
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = clock::now();
+            AccessorDecoder::DecodeScalar(src.data(), stride, count, c.componentType, c.normalized, c.components, expected.data(), c.dstComponents, fill);
+            best[0] = std::min(best[0], std::chrono::duration<double, std::milli>(clock::now() - start).count());
+
+            start = clock::now();
+            AccessorDecoder::Decode(src.data(), stride, count, c.componentType, c.normalized, c.components, actual.data(), c.dstComponents, fill);
+            best[1] = std::min(best[1], std::chrono::duration<double, std::milli>(clock::now() - start).count());
+        }
+
+        bool same = memcmp(expected.data(), actual.data(), sizeof(float) * actual.size()) == 0;
+        if (c.normalized && (c.componentType == VertexComponent_Byte || c.componentType == VertexComponent_Short))
+        {
+            same = same && actual[0] == -1.0f;
+        }
+
+        wchar_t line[256];
+        swprintf_s(line, L"デコード %ls (stride %zu): 1 成分ずつ %.3f ms, まとめて %.3f ms (%.2f 倍), %ls",
+            c.name, stride, best[0], best[1], best[0] / std::max(best[1], 1e-6), same ? L"一致" : L"不一致");
+        Debug::Log(std::wstring(line));
+        out << ToUtf8(line) << "\n";
+        return same;
+    }
+}
+
+int RunGltfBenchmark(LPCWSTR cmdLine)
+{
+    using clock = std::chrono::steady_clock;
+
+    int iterations = 10;
+    std::wstring value = GetOptionValue(cmdLine, L"-bench-gltf=");
+    if (!value.empty())
+    {
+        iterations = std::max(_wtoi(value.c_str()), 1);
+    }
+
+    JobSystem::create();
+    JobSystem::getInstance()->Initialize();
+    MeshCache::SetDirectory(L"");
+
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(L"Resource", ec))
+    {
+        if (entry.path().extension() == L".glb")
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::ofstream out("bench_gltf.txt", std::ios::binary);
+    std::wstring header = L"ワーカー " + std::to_wstring(JobSystem::getInstance()->getWorkerCount())
+        + L" スレッド, " + std::to_wstring(iterations) + L" 回の最短";
+    Debug::Log(header);
+    out << ToUtf8(header) << "\n";
+
+    for (const auto& file : files)
+    {
+        double best[2] = {};
+        std::shared_ptr<const GltfModelAsset> result[2];
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            GltfModelAsset::setParallelDecode(mode == 1);
+
+            // 読み込み済みのものを返さないように、毎回手放してから読み込む
+            EngineContext context;
+            EngineContext::Scope scope(&context);
+            AssetDatabase::create();
+
+            best[mode] = 1e9;
+            for (int i = 0; i < iterations; ++i)
+            {
+                result[mode].reset();
+                auto start = clock::now();
+                result[mode] = GltfModelAsset::Load<VertexPNT>(file.wstring());
+                best[mode] = std::min(best[mode], std::chrono::duration<double, std::milli>(clock::now() - start).count());
+            }
+        }
+
+        bool same = result[0] != nullptr && result[1] != nullptr && SameModel(*result[0], *result[1]);
+        wchar_t line[512];
+        swprintf_s(line, L"%ls: 逐次 %.2f ms, 並列 %.2f ms (%.2f 倍), %ls",
+            file.filename().c_str(), best[0], best[1], best[0] / std::max(best[1], 1e-6), same ? L"一致" : L"不一致");
+        Debug::Log(std::wstring(line));
+        out << ToUtf8(line) << "\n";
+    }
+
+    GltfModelAsset::setParallelDecode(true);
+    JobSystem::destroy();
+
+    const DecodeCase decodeCases[] =
+    {
+        { L"byte3 正規化",          VertexComponent_Byte,          true,  3, 3, 0 },
+        { L"byte3 正規化, 空きあり", VertexComponent_Byte,          true,  3, 3, 1 },
+        { L"ubyte4 正規化",         VertexComponent_UnsignedByte,  true,  4, 4, 0 },
+        { L"ubyte2 正規化, 空きあり", VertexComponent_UnsignedByte,  true,  2, 2, 6 },
+        { L"short4 正規化",         VertexComponent_Short,         true,  4, 4, 0 },
+        { L"short3 正規化, 空きあり", VertexComponent_Short,         true,  3, 3, 2 },
+        { L"ushort2 正規化",        VertexComponent_UnsignedShort, true,  2, 2, 0 },
+        { L"ushort3 正規化 → 4",    VertexComponent_UnsignedShort, true,  3, 4, 2 },
+        { L"short1 正規化, 空きあり", VertexComponent_Short,         true,  1, 1, 2 },
+        { L"byte3 整数",            VertexComponent_Byte,          false, 3, 3, 1 },
+        { L"float3, 空きあり",       VertexComponent_Float,         false, 3, 3, 8 },
+        { L"float2 → 4",           VertexComponent_Float,         false, 2, 4, 0 },
+    };
+    int mismatches = 0;
+    for (const auto& c : decodeCases)
+    {
+        if (!CompareDecode(c, iterations, out))
+        {
+            ++mismatches;
+        }
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+
+
+//
+//  関数: RunJobBenchmark(LPCWSTR)
+//
+//  目的: ジョブシステムに依存関係つきのジョブを大量に流して、取りこぼしや順序の崩れがないかを確かめます。
+//        あわせて、空のジョブの往復時間と、依存先が終わってから後続のジョブが動き出すまでの時間を計ります。
+//        結果は bench_jobs.txt に書き出し、失敗があれば 1 を返します。
+//
+//  コマンドライン:
+//        -bench-jobs=N : 負荷試験を N 回繰り返す（省略時は 20）
+//
+namespace
+{
+    class JobBenchmarkLog
+    {
+    public:
+        JobBenchmarkLog() : out_("bench_jobs.txt", std::ios::binary) {}
+
+        void write(const std::wstring& line)
+        {
+            Debug::Log(line);
+            out_ << ToUtf8(line) << "\n";
+        }
+
+        void check(bool ok, const std::wstring& name)
+        {
+            write((ok ? L"OK   " : L"失敗 ") + name);
+            failures_ += ok ? 0 : 1;
+        }
+
+        int getFailures() const { return failures_; }
+
+    private:
+        std::ofstream out_;
+        int failures_ = 0;
+    };
+
+
+    // 多数のジョブをひとつのカウンタで待つ
+    bool StressFanOut(JobSystem& jobs)
+    {
+        const int count = 10000;
+        std::atomic<int> sum = 0;
+        JobCounter counter;
+        for (int i = 0; i < count; ++i)
+        {
+            jobs.schedule([&sum]() { sum.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        }
+        jobs.wait(counter);
+        return sum == count;
+    }
+
+
+    // ひとつ前のジョブに依存するジョブを長くつなげ、順番どおりに動くかを確かめる
+    bool StressChain(JobSystem& jobs)
+    {
+        const int count = 1000;
+        std::vector<std::unique_ptr<JobCounter>> counters;
+        for (int i = 0; i < count; ++i)
+        {
+            counters.push_back(std::make_unique<JobCounter>());
+        }
+
+        std::atomic<int> next = 0;
+        std::atomic<bool> ordered = true;
+        for (int i = 0; i < count; ++i)
+        {
+            const JobCounter* dependency = i > 0 ? counters[i - 1].get() : nullptr;
+            jobs.schedule([&next, &ordered, i]()
+                {
+                    if (next.fetch_add(1) != i)
+                    {
+                        ordered = false;
+                    }
+                }, counters[i].get(), dependency);
+        }
+        jobs.wait(*counters.back());
+        return ordered && next == count;
+    }
+
+
+    // 時間のかかるジョブひとつに多数のジョブを依存させ、先に動くものがないかを確かめる
+    bool StressWideDependency(JobSystem& jobs)
+    {
+        const int count = 2000;
+        std::atomic<bool> gateDone = false;
+        std::atomic<int> early = 0;
+        std::atomic<int> ran = 0;
+
+        JobCounter gate;
+        jobs.schedule([&gateDone]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                gateDone = true;
+            }, &gate);
+
+        JobCounter all;
+        for (int i = 0; i < count; ++i)
+        {
+            jobs.schedule([&]()
+                {
+                    early += gateDone ? 0 : 1;
+                    ran++;
+                }, &all, &gate);
+        }
+        jobs.wait(all);
+        return early == 0 && ran == count;
+    }
+
+
+    // ワーカーの中から依存関係つきのジョブを投入する
+    bool StressNestedSchedule(JobSystem& jobs)
+    {
+        const int count = 500;
+        std::atomic<int> ran = 0;
+        std::atomic<int> early = 0;
+        JobCounter outer;
+        std::vector<std::unique_ptr<JobCounter>> inner;
+        for (int i = 0; i < count; ++i)
+        {
+            inner.push_back(std::make_unique<JobCounter>());
+        }
+
+        JobCounter children;
+        for (int i = 0; i < count; ++i)
+        {
+            JobCounter* first = inner[i].get();
+            jobs.schedule([&, first]()
+                {
+                    auto firstDone = std::make_shared<std::atomic<bool>>(false);
+                    jobs.schedule([firstDone]() { *firstDone = true; }, first);
+                    jobs.schedule([&, firstDone]()
+                        {
+                            early += *firstDone ? 0 : 1;
+                            ran++;
+                        }, &children, first);
+                }, &outer);
+        }
+        jobs.wait(outer);
+        jobs.wait(children);
+        return early == 0 && ran == count;
+    }
+
+
+    double Median(std::vector<double>& samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return samples.empty() ? 0.0 : samples[samples.size() / 2];
+    }
+}
+
+int RunJobBenchmark(LPCWSTR cmdLine)
+{
+    using clock = std::chrono::steady_clock;
+
+    int rounds = 20;
+    std::wstring value = GetOptionValue(cmdLine, L"-bench-jobs=");
+    if (!value.empty())
+    {
+        rounds = std::max(_wtoi(value.c_str()), 1);
+    }
+
+    // コアが少なくてもスレッド間の競合が起きるように、ワーカーは最低 2 つ作る
+    JobSystem::create();
+    JobSystem::getInstance()->Initialize(std::max((int)std::thread::hardware_concurrency() - 1, 2));
+    JobSystem& jobs = *JobSystem::getInstance();
+
+    JobBenchmarkLog log;
+    log.write(L"ワーカー " + std::to_wstring(jobs.getWorkerCount()) + L" スレッド, 負荷試験 " + std::to_wstring(rounds) + L" 回");
+
+    // 負荷試験
+    bool fanOut = true;
+    bool chain = true;
+    bool wide = true;
+    bool nested = true;
+    for (int i = 0; i < rounds; ++i)
+    {
+        fanOut = StressFanOut(jobs) && fanOut;
+        chain = StressChain(jobs) && chain;
+        wide = StressWideDependency(jobs) && wide;
+        nested = StressNestedSchedule(jobs) && nested;
+    }
+    log.check(fanOut, L"10000 個のジョブをひとつのカウンタで待つ");
+    log.check(chain, L"1000 段の依存の鎖が順番どおりに動く");
+    log.check(wide, L"2000 個のジョブが依存先より先に動かない");
+    log.check(nested, L"ワーカーの中から依存関係つきのジョブを投入する");
+
+    // 空のジョブを投入してから完了を待ち終えるまで
+    const int samples = 10000;
+    std::vector<double> roundTrip;
+    roundTrip.reserve(samples);
+    for (int i = 0; i < samples; ++i)
+    {
+        JobCounter counter;
+        auto start = clock::now();
+        jobs.schedule([]() {}, &counter);
+        jobs.wait(counter);
+        roundTrip.push_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+    }
+
+    // 依存先のジョブが終わってから後続のジョブが動き出すまで
+    // 待つ側のスレッドはジョブを実行しないよう、完了を眠って待つ
+    std::vector<double> wakeUp;
+    wakeUp.reserve(samples / 10);
+    for (int i = 0; i < samples / 10; ++i)
+    {
+        clock::time_point finished;
+        clock::time_point started;
+        JobCounter first;
+        JobCounter second;
+        jobs.schedule([&finished]()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                finished = clock::now();
+            }, &first);
+        jobs.schedule([&started]() { started = clock::now(); }, &second, &first);
+        while (!second.isDone())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        wakeUp.push_back(std::chrono::duration<double, std::micro>(started - finished).count());
+    }
+
+    wchar_t line[256];
+    swprintf_s(line, L"空のジョブの往復: 中央値 %.2f us", Median(roundTrip));
+    log.write(line);
+    swprintf_s(line, L"依存先の完了から後続の開始まで: 中央値 %.2f us", Median(wakeUp));
+    log.write(line);
+
+    JobSystem::destroy();
+    return log.getFailures() == 0 ? 0 : 1;
+}
+
+
+
+//
+//  関数: RunMeshAnalysis()
+//
+//  目的: Resource/*.glb の頂点キャッシュの効率（ACMR / ATVR）を、
+//        MeshOptimizer で並べ替える前と後で比較します。
+//        -mesh-lod=N を指定していれば、LOD の段ごとの三角形の数と誤差も書き出します。
+//        変換済みメッシュのキャッシュは使いません。GPU のバッファは作りません。
+//        結果は mesh_analysis.txt に書き出します。
+//
+int RunMeshAnalysis()
+{
+    MeshCache::SetDirectory(L"");
+
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(L"Resource", ec))
+    {
+        if (entry.path().extension() == L".glb")
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::ofstream out("mesh_analysis.txt", std::ios::binary);
+    std::wstring header = L"FIFO キャッシュ " + std::to_wstring(MeshOptimizer::DefaultCacheSize) + L" 頂点";
+    Debug::Log(header);
+    out << ToUtf8(header) << "\n";
+
+    for (const auto& file : files)
+    {
+        VertexCacheStatistics total[2];
+        std::vector<size_t> lodTriangles;
+        std::vector<float> lodErrors;
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            MeshOptimizer::setEnabled(mode == 1);
+
+            EngineContext context;
+            EngineContext::Scope scope(&context);
+            AssetDatabase::create();
+
+            auto asset = GltfModelAsset::Load<VertexPNT>(file.wstring());
+            if (asset == nullptr)
+            {
+                continue;
+            }
+            for (const auto& sub : asset->getSubMeshes())
+            {
+                VertexCacheStatistics stats = MeshOptimizer::AnalyzeVertexCache(sub->indices, sub->positions.size());
+                total[mode].vertexCount += stats.vertexCount;
+                total[mode].triangleCount += stats.triangleCount;
+                total[mode].transformedCount += stats.transformedCount;
+            }
+
+            // LOD は段ごとに合計する（段の少ないサブメッシュは最も粗いものを使う）
+            if (mode == 1)
+            {
+                size_t levels = 0;
+                for (const auto& sub : asset->getSubMeshes())
+                {
+                    levels = std::max(levels, sub->lods.size());
+                }
+                lodTriangles.assign(levels, 0);
+                lodErrors.assign(levels, 0.0f);
+                for (const auto& sub : asset->getSubMeshes())
+                {
+                    for (size_t level = 0; level < levels; ++level)
+                    {
+                        const SubMeshLOD* lod = sub->lods.empty() ? nullptr : &sub->lods[std::min(level, sub->lods.size() - 1)];
+                        lodTriangles[level] += (lod != nullptr ? lod->indices.size() : sub->indices.size()) / 3;
+                        lodErrors[level] = std::max(lodErrors[level], lod != nullptr ? lod->error : 0.0f);
+                    }
+                }
+            }
+            total[mode].acmr = float(total[mode].transformedCount) / float(std::max<size_t>(total[mode].triangleCount, 1));
+            total[mode].atvr = float(total[mode].transformedCount) / float(std::max<size_t>(total[mode].vertexCount, 1));
+        }
+
+        wchar_t line[512];
+        swprintf_s(line, L"%ls: 三角形 %zu, 頂点 %zu, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+            file.filename().c_str(), total[0].triangleCount, total[0].vertexCount,
+            total[0].acmr, total[1].acmr, total[0].atvr, total[1].atvr);
+        Debug::Log(std::wstring(line));
+        out << ToUtf8(line) << "\n";
+
+        for (size_t level = 0; level < lodTriangles.size(); ++level)
+        {
+            swprintf_s(line, L"    LOD %zu: 三角形 %zu (%.0f%%), 誤差 %.4f",
+                level + 1, lodTriangles[level], 100.0 * double(lodTriangles[level]) / double(std::max<size_t>(total[0].triangleCount, 1)),
+                lodErrors[level]);
+            Debug::Log(std::wstring(line));
+            out << ToUtf8(line) << "\n";
+        }
+    }
+
+    MeshOptimizer::setEnabled(false);
+    return 0;
+}
+
+
+
+//
+//  関数: RunSelfTest()
+//
+//  目的: エンジンのうち CPU だけで動く部分が期待どおりに動くかを確かめます。
+//        ウィンドウと GPU は使いません。
+//        結果は selftest.txt に書き出し、失敗があれば 1 を返します。
+//
+namespace
+{
+    class SelfTestLog
+    {
+    public:
+        SelfTestLog() : out_("selftest.txt", std::ios::binary) {}
+
+        void check(bool ok, const std::wstring& name)
+        {
+            std::wstring line = (ok ? L"OK   " : L"失敗 ") + name;
+            Debug::Log(line);
+            out_ << ToUtf8(line) << "\n";
+            failures_ += ok ? 0 : 1;
+        }
+
+        // このビルドでは確かめられないもの
+        void skip(const std::wstring& name)
+        {
+            std::wstring line = L"省略 " + name;
+            Debug::Log(line);
+            out_ << ToUtf8(line) << "\n";
+        }
+
+        int getFailures() const { return failures_; }
+
+    private:
+        std::ofstream out_;
+        int failures_ = 0;
+    };
+
+
+    // コルーチンの中で自身の GameObject を破棄する
+    class SelfDestroyBehaviour : public Behaviour
+    {
+    public:
+        // 破棄した後は this に触れないので、引数（コルーチンのフレームにコピーされる）だけを使う
+        Coroutine destroySelf(std::unique_ptr<GameObject>* holder, int* step)
+        {
+            *step = 1;
+            co_await WaitForNextFrame();
+            *step = 2;
+            holder->reset();
+            *step = 3;
+            co_await WaitForNextFrame();
+            *step = 4;
+        }
+    };
+
+    void TestCoroutineDestroysOwner(SelfTestLog& log)
+    {
+        EngineContext context;
+        EngineContext::Scope scope(&context);
+        CoroutineScheduler::create();
+
+        auto holder = std::make_unique<GameObject>(L"SelfDestroy", std::make_unique<SelfDestroyBehaviour>());
+        auto behaviour = holder->GetComponent<SelfDestroyBehaviour>(true);
+        int step = 0;
+        behaviour->StartCoroutine(behaviour->destroySelf(&holder, &step));
+
+        // 1回目の再開で GameObject が破棄され、次の中断でコルーチンも破棄される
+        for (int frame = 1; frame <= 2; ++frame)
+        {
+            CoroutineScheduler::getInstance()->beginFrame(0.0f);
+            CoroutineScheduler::getInstance()->update();
+        }
+
+        log.check(holder == nullptr && step == 3 && CoroutineScheduler::getInstance()->getRunningCount() == 0,
+            L"コルーチンの中で自身の GameObject を破棄する");
+    }
+
+
+    // 待つたびに step を進める
+    Coroutine WaitFrames(int* step)
+    {
+        *step = 1;
+        co_await WaitForNextFrame();
+        *step = 2;
+        co_await WaitForNextFrame();
+        *step = 3;
+    }
+
+    Coroutine WaitSeconds(float seconds, int* step)
+    {
+        *step = 1;
+        co_await WaitForSeconds(seconds);
+        *step = 2;
+    }
+
+    Coroutine WaitFlag(const bool* flag, int* step)
+    {
+        *step = 1;
+        co_await WaitUntil([flag]() { return *flag; });
+        *step = 2;
+    }
+
+    // Engine::updateFrame() と同じ順で、フレームの始めと Update の後を呼ぶ
+    // start はフレームの途中（Update の中）で呼ばれる
+    void RunCoroutineFrame(float time, const std::function<void()>& start = nullptr)
+    {
+        CoroutineScheduler::getInstance()->beginFrame(time);
+        if (start)
+        {
+            start();
+        }
+        CoroutineScheduler::getInstance()->update();
+    }
+
+    void TestCoroutineWaits(SelfTestLog& log)
+    {
+        EngineContext context;
+        EngineContext::Scope scope(&context);
+        CoroutineScheduler::create();
+        auto scheduler = CoroutineScheduler::getInstance();
+
+        // Update の中で開始したものは、そのフレームの update() では再開しない
+        // 再開した後に待ち直したものも、同じ update() では再開しない
+        int frames = 0;
+        RunCoroutineFrame(0.0f, [&]() { scheduler->start(nullptr, WaitFrames(&frames)); });
+        bool sameFrame = frames == 1;
+        RunCoroutineFrame(0.1f);
+        bool nextFrame = frames == 2;
+        RunCoroutineFrame(0.2f);
+        log.check(sameFrame && nextFrame && frames == 3 && scheduler->getRunningCount() == 0,
+            L"WaitForNextFrame は次のフレームに 1 回ずつ再開する");
+
+        // 時刻に達するまで再開しない
+        int seconds = 0;
+        RunCoroutineFrame(1.0f, [&]() { scheduler->start(nullptr, WaitSeconds(0.5f, &seconds)); });
+        RunCoroutineFrame(1.25f);
+        bool early = seconds == 1;
+        RunCoroutineFrame(1.5f);
+        log.check(early && seconds == 2 && scheduler->getRunningCount() == 0,
+            L"WaitForSeconds は時刻に達したフレームで再開する");
+
+        // 0 秒でも、待ち始めたフレームでは再開しない
+        int zero = 0;
+        RunCoroutineFrame(2.0f, [&]() { scheduler->start(nullptr, WaitSeconds(0.0f, &zero)); });
+        bool zeroSameFrame = zero == 1;
+        RunCoroutineFrame(2.1f);
+        log.check(zeroSameFrame && zero == 2, L"WaitForSeconds(0) は次のフレームで再開する");
+
+        // 条件が true になった後の update() で再開する。最初から true なら待たない
+        bool flag = false;
+        int until = 0;
+        RunCoroutineFrame(3.0f, [&]() { scheduler->start(nullptr, WaitFlag(&flag, &until)); });
+        RunCoroutineFrame(3.1f);
+        bool waiting = until == 1;
+        flag = true;
+        RunCoroutineFrame(3.2f);
+        bool resumed = until == 2;
+        int ready = 0;
+        scheduler->start(nullptr, WaitFlag(&flag, &ready));
+        log.check(waiting && resumed && ready == 2 && scheduler->getRunningCount() == 0,
+            L"WaitUntil は条件が true になってから再開する");
+    }
+
+
+    // インデックスが 16bit に収まるかどうかで形式が切り替わる境目を確かめる
+    // D3D がないので createIndexBuffer() はバッファを作らず、形式だけを決める
+    void TestNarrowIndices(SelfTestLog& log)
+    {
+        auto formatOf = [](std::span<const uint32_t> src)
+            {
+                ComPtr<ID3D11Buffer> buffer;
+                DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+                SubMesh::createIndexBuffer(src, buffer, format);
+                return format;
+            };
+
+        const std::vector<uint32_t> below = { 0, 1, 0xFFFE };
+        std::vector<uint16_t> narrow;
+        bool narrowed = SubMesh::narrowIndices(below, narrow);
+        log.check(narrowed && narrow == std::vector<uint16_t>{ 0, 1, 0xFFFE } && formatOf(below) == DXGI_FORMAT_R16_UINT,
+            L"最大インデックス 0xFFFE は 16bit になる");
+
+        // 0xFFFF はストリップの区切りと重なるので 32bit のまま
+        const std::vector<uint32_t> restart = { 0, 1, 0xFFFF };
+        narrow.clear();
+        log.check(!SubMesh::narrowIndices(restart, narrow) && narrow.empty() && formatOf(restart) == DXGI_FORMAT_R32_UINT,
+            L"最大インデックス 0xFFFF は 32bit のまま");
+
+        const std::vector<uint32_t> empty;
+        narrow.clear();
+        log.check(SubMesh::narrowIndices(empty, narrow) && narrow.empty() && formatOf(empty) == DXGI_FORMAT_R16_UINT,
+            L"空のインデックスは 16bit として扱う");
+    }
+
+
+    // プールに残したものなど、アリーナより長く生きる Object を後から破棄する
+    void TestObjectOutlivesArena(SelfTestLog& log)
+    {
+        EngineContext context;
+        EngineContext::Scope scope(&context);
+
+        auto arena = std::make_unique<SceneArena>();
+        std::unique_ptr<GameObject> sceneObject;
+        std::unique_ptr<GameObject> pooledObject;
+        {
+            SceneArena::Scope arenaScope(arena.get());
+            sceneObject = std::make_unique<GameObject>(L"Scene");
+            pooledObject = std::make_unique<GameObject>(L"Pooled");
+        }
+        size_t liveCount = arena->getLiveCount();
+
+        // シーンの Object を破棄してからアリーナを破棄し、残った Object を最後に破棄する
+        sceneObject.reset();
+        bool released = arena->getLiveCount() > 0 && arena->getLiveCount() < liveCount;
+        arena.reset();
+        pooledObject.reset();
+
+        log.check(released, L"アリーナより長く生きる Object を後から破棄する");
+    }
+
+
+    // プロファイラのリングバッファがあふれたときに失われた数を書き出し、
+    // 別のスレッドが書き込んでいる間に書き出しても壊れたイベントを出さないことを確かめる
+    void TestProfilerCapture(SelfTestLog& log)
+    {
+        const std::wstring path = L"selftest_trace.json";
+        auto readTrace = [&path]()
+            {
+                std::ifstream in(std::filesystem::path(path), std::ios::binary);
+                return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            };
+
+        // 1スレッドの容量を 1000 個超えて記録する
+        // 計測の終了後に記録したものは、残っているイベントを上書きしない
+        Profiler::BeginCapture();
+        for (size_t i = 0; i < Profiler::EventCapacity + 1000; ++i)
+        {
+            uint64_t t = Profiler::now();
+            Profiler::record("SelfTestOverflow", t, t);
+        }
+        Profiler::EndCapture();
+        for (size_t i = 0; i < Profiler::EventCapacity; ++i)
+        {
+            uint64_t t = Profiler::now();
+            Profiler::record("SelfTestLate", t, t);
+        }
+        Profiler::WriteChromeTrace(path);
+        std::string trace = readTrace();
+        log.check(trace.find("\"droppedEvents\":1000}") != std::string::npos, L"あふれて失われたイベントの数をトレースに書く");
+        log.check(trace.find("SelfTestOverflow") != std::string::npos && trace.find("SelfTestLate") == std::string::npos,
+            L"計測の終了後はイベントを記録しない");
+
+        // 書き込み中のスレッドのイベントは、どれも長さが 1 マイクロ秒で、古い順に並ぶはず
+        // 読んでいる間に上書きされたものを書き出すと、新しいイベントが古いものの前に混ざる
+        Profiler::BeginCapture();
+        std::atomic<bool> stop = false;
+        std::thread writer([&stop]()
+            {
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    uint64_t t = Profiler::now();
+                    Profiler::record("SelfTestWriter", t, t + 1000);
+                }
+            });
+
+        size_t events = 0;
+        size_t broken = 0;
+        for (int pass = 0; pass < 4; ++pass)
+        {
+            Profiler::WriteChromeTrace(path);
+            trace = readTrace();
+            const std::string name = "\"name\":\"SelfTestWriter\"";
+            double previous = 0.0;
+            for (size_t pos = trace.find(name); pos != std::string::npos; pos = trace.find(name, pos + 1))
+            {
+                size_t ts = trace.find("\"ts\":", pos);
+                size_t dur = trace.find("\"dur\":", pos);
+                ++events;
+                if (ts == std::string::npos || dur == std::string::npos || trace.compare(dur + 6, 6, "1.000}") != 0)
+                {
+                    ++broken;
+                    continue;
+                }
+                double time = strtod(trace.c_str() + ts + 5, nullptr);
+                if (time < previous)
+                {
+                    ++broken;
+                }
+                previous = time;
+            }
+        }
+        stop = true;
+        writer.join();
+        Profiler::EndCapture();
+        std::filesystem::remove(std::filesystem::path(path));
+
+        log.check(events > 0 && broken == 0,
+            L"書き込み中に書き出しても壊れたイベントを出さない（" + std::to_wstring(events) + L" 個中 " + std::to_wstring(broken) + L" 個）");
+    }
+
+
+    // 終了したスレッドのキューの番号が使い回され、スレッドを作り直し続けても共有キューに落ちないことを確かめる
+    void TestEventBusThreadSlots(SelfTestLog& log)
+    {
+        struct SelfTestEvent { int value; };
+
+        EngineContext context;
+        EngineContext::Scope scope(&context);
+        EventBus::create();
+        EventBus* bus = EventBus::getInstance();
+
+        int received = 0;
+        bus->subscribe<SelfTestEvent>([&received](const SelfTestEvent& e) { received += e.value; });
+
+        // 番号の数の 4 倍のスレッドを順に作って、それぞれから発行する
+        const int threadCount = int(EventChannelBase::MaxPublisherThreads) * 4;
+        size_t maxSlot = 0;
+        for (int i = 0; i < threadCount; ++i)
+        {
+            std::thread([bus, &maxSlot]()
+                {
+                    maxSlot = std::max(maxSlot, EventChannelBase::threadSlot());
+                    bus->publish(SelfTestEvent{ 1 });
+                }).join();
+        }
+        bus->dispatch();
+        EventBus::destroy();
+
+        log.check(maxSlot < EventChannelBase::MaxPublisherThreads,
+            L"終了したスレッドのキューの番号を使い回す（最大の番号 " + std::to_wstring(maxSlot) + L"）");
+        log.check(received == threadCount, L"番号を使い回したスレッドのイベントも配る");
+    }
+
+
+    // 既定のシーンをヘッドレスで動かし、立ち上がった後の固定時間更新でヒープ確保が起きないことを確かめる
+    void TestFixedStepAllocations(SelfTestLog& log)
+    {
+        const std::wstring name = L"定常状態の固定時間更新でヒープ確保をしない";
+        if (!AllocationCounter::isEnabled())
+        {
+            log.skip(name + L"（UNIDX_ENABLE_ALLOCATION_COUNTER なしのビルド）");
+            return;
+        }
+
+        EngineContext context;
+        EngineContext::Scope scope(&context);
+        Engine::create();
+        Engine::getInstance()->InitializeHeadless();
+        Engine::getInstance()->setFixedStepAllocationWarmup(120);
+        Engine::getInstance()->HeadlessLoop(60.0, true, 600);
+
+        uint64_t count = Engine::getInstance()->getFixedStepAllocationCount();
+        log.check(count == 0, name + L"（" + std::to_wstring(count) + L" 回）");
+    }
+}
+
+int RunSelfTest()
+{
+    SelfTestLog log;
+
+    TestCoroutineDestroysOwner(log);
+    TestCoroutineWaits(log);
+    TestObjectOutlivesArena(log);
+    TestNarrowIndices(log);
+    TestProfilerCapture(log);
+    TestEventBusThreadSlots(log);
+    TestFixedStepAllocations(log);
+
+    return log.getFailures() == 0 ? 0 : 1;
+}
+
+
+
+//
+//  関数: StartProfile(LPCWSTR)
+//
+//  目的: -profile=秒数 が指定されていればプロファイラの計測を開始します。
+//        結果は chrome://tracing や Perfetto で開けます。
+//
+void StartProfile(LPCWSTR cmdLine)
+{
+    const wchar_t* profileOption = wcsstr(cmdLine, L"-profile=");
+    if (profileOption == nullptr)
+    {
+        return;
+    }
+
+    double seconds = wcstod(profileOption + wcslen(L"-profile="), nullptr);
+    if (seconds > 0.0)
+    {
+        Profiler::BeginCapture(seconds, L"trace.json");
+    }
+}
+
+
+
+//
+//  関数: SetupSceneFile(LPCWSTR)
+//
+//  目的: シーンファイルの読み込みと書き出しを設定します。
+//        ゲームのコンポーネントはシーンファイルに書き出せるように型を登録します。
+//
+void SetupSceneFile(LPCWSTR cmdLine)
+{
+    SceneSerializer::registerComponent<Player>(L"Player");
+    SceneSerializer::registerComponent<CameraBehaviour>(L"CameraBehaviour");
+
+    SceneManager::setSceneFile(GetOptionValue(cmdLine, L"-load-scene="), GetOptionValue(cmdLine, L"-save-scene="));
+}
+
+
+
+//
+//  関数: GetOptionValue(LPCWSTR, LPCWSTR)
+//
+//  目的: コマンドラインから「オプション=値」の値を取り出します。なければ空文字列を返します。
+//        値は次の空白まで。空白を含むときは "" で囲みます。
+//
+std::wstring GetOptionValue(LPCWSTR cmdLine, LPCWSTR option)
+{
+    const wchar_t* p = wcsstr(cmdLine, option);
+    if (p == nullptr)
+    {
+        return std::wstring();
+    }
+    p += wcslen(option);
+
+    if (*p == L'"')
+    {
+        const wchar_t* end = wcschr(p + 1, L'"');
+        return end != nullptr ? std::wstring(p + 1, end) : std::wstring(p + 1);
+    }
+    const wchar_t* end = p;
+    while (*end != L'\0' && *end != L' ')
+    {
+        ++end;
+    }
+    return std::wstring(p, end);
+}
+
+
+
 //
 //  関数: MyRegisterClass()
 //